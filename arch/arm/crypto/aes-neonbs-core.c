@@ -0,0 +1,403 @@
+/*
+ * Bit sliced AES using NEON instructions
+ *
+ * Eight blocks are processed in parallel.  They are transposed into eight
+ * 128-bit registers, each holding one bit of every byte of all eight
+ * blocks: byte n of register k contains bit k of byte n of the state of
+ * blocks 0-7.  SubBytes then becomes a boolean circuit evaluated on whole
+ * registers, while ShiftRows and MixColumns become byte permutations and
+ * XORs.  There are no table lookups, so the code runs in constant time.
+ *
+ * The S-box circuit is the one by Boyar and Peralta, "A depth-16 circuit
+ * for the AES S-box".
+ *
+ * This file is built with NEON enabled and must not include any kernel
+ * headers.  Callers have to bracket the calls with kernel_neon_begin() and
+ * kernel_neon_end().
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <arm_neon.h>
+#include "aes-neonbs.h"
+
+static const unsigned char shift_rows[16] = {
+	0, 5, 10, 15, 4, 9, 14, 3, 8, 13, 2, 7, 12, 1, 6, 11,
+};
+
+static const unsigned char inv_shift_rows[16] = {
+	0, 13, 10, 7, 4, 1, 14, 11, 8, 5, 2, 15, 12, 9, 6, 3,
+};
+
+#define SWAPMOVE(a, b, n, m) do {					\
+	uint8x16_t __t = vandq_u8(veorq_u8(vshrq_n_u8(a, n), b), m);	\
+	b = veorq_u8(b, __t);						\
+	a = veorq_u8(a, vshlq_n_u8(__t, n));				\
+} while (0)
+
+/* Transpose the 8x8 bit matrices at each byte position; an involution */
+static inline void bitslice(uint8x16_t *q)
+{
+	uint8x16_t m;
+
+	m = vdupq_n_u8(0x55);
+	SWAPMOVE(q[0], q[1], 1, m);
+	SWAPMOVE(q[2], q[3], 1, m);
+	SWAPMOVE(q[4], q[5], 1, m);
+	SWAPMOVE(q[6], q[7], 1, m);
+
+	m = vdupq_n_u8(0x33);
+	SWAPMOVE(q[0], q[2], 2, m);
+	SWAPMOVE(q[1], q[3], 2, m);
+	SWAPMOVE(q[4], q[6], 2, m);
+	SWAPMOVE(q[5], q[7], 2, m);
+
+	m = vdupq_n_u8(0x0f);
+	SWAPMOVE(q[0], q[4], 4, m);
+	SWAPMOVE(q[1], q[5], 4, m);
+	SWAPMOVE(q[2], q[6], 4, m);
+	SWAPMOVE(q[3], q[7], 4, m);
+}
+
+static inline void add_round_key(uint8x16_t *q, const unsigned char *rk)
+{
+	int i;
+
+	for (i = 0; i < 8; i++)
+		q[i] = veorq_u8(q[i], vld1q_u8(rk + 16 * i));
+}
+
+static inline void sub_bytes(uint8x16_t *q)
+{
+	uint8x16_t x0, x1, x2, x3, x4, x5, x6, x7;
+	uint8x16_t y1, y2, y3, y4, y5, y6, y7, y8, y9;
+	uint8x16_t y10, y11, y12, y13, y14, y15, y16, y17, y18, y19;
+	uint8x16_t y20, y21;
+	uint8x16_t z0, z1, z2, z3, z4, z5, z6, z7, z8, z9;
+	uint8x16_t z10, z11, z12, z13, z14, z15, z16, z17;
+	uint8x16_t t0, t1, t2, t3, t4, t5, t6, t7, t8, t9;
+	uint8x16_t t10, t11, t12, t13, t14, t15, t16, t17, t18, t19;
+	uint8x16_t t20, t21, t22, t23, t24, t25, t26, t27, t28, t29;
+	uint8x16_t t30, t31, t32, t33, t34, t35, t36, t37, t38, t39;
+	uint8x16_t t40, t41, t42, t43, t44, t45, t46, t47, t48, t49;
+	uint8x16_t t50, t51, t52, t53, t54, t55, t56, t57, t58, t59;
+	uint8x16_t t60, t61, t62, t63, t64, t65, t66, t67;
+	uint8x16_t s0, s1, s2, s3, s4, s5, s6, s7;
+
+	x0 = q[7];
+	x1 = q[6];
+	x2 = q[5];
+	x3 = q[4];
+	x4 = q[3];
+	x5 = q[2];
+	x6 = q[1];
+	x7 = q[0];
+
+	/* top linear transformation */
+	y14 = veorq_u8(x3, x5);
+	y13 = veorq_u8(x0, x6);
+	y9 = veorq_u8(x0, x3);
+	y8 = veorq_u8(x0, x5);
+	t0 = veorq_u8(x1, x2);
+	y1 = veorq_u8(t0, x7);
+	y4 = veorq_u8(y1, x3);
+	y12 = veorq_u8(y13, y14);
+	y2 = veorq_u8(y1, x0);
+	y5 = veorq_u8(y1, x6);
+	y3 = veorq_u8(y5, y8);
+	t1 = veorq_u8(x4, y12);
+	y15 = veorq_u8(t1, x5);
+	y20 = veorq_u8(t1, x1);
+	y6 = veorq_u8(y15, x7);
+	y10 = veorq_u8(y15, t0);
+	y11 = veorq_u8(y20, y9);
+	y7 = veorq_u8(x7, y11);
+	y17 = veorq_u8(y10, y11);
+	y19 = veorq_u8(y10, y8);
+	y16 = veorq_u8(t0, y11);
+	y21 = veorq_u8(y13, y16);
+	y18 = veorq_u8(x0, y16);
+
+	/* non-linear section */
+	t2 = vandq_u8(y12, y15);
+	t3 = vandq_u8(y3, y6);
+	t4 = veorq_u8(t3, t2);
+	t5 = vandq_u8(y4, x7);
+	t6 = veorq_u8(t5, t2);
+	t7 = vandq_u8(y13, y16);
+	t8 = vandq_u8(y5, y1);
+	t9 = veorq_u8(t8, t7);
+	t10 = vandq_u8(y2, y7);
+	t11 = veorq_u8(t10, t7);
+	t12 = vandq_u8(y9, y11);
+	t13 = vandq_u8(y14, y17);
+	t14 = veorq_u8(t13, t12);
+	t15 = vandq_u8(y8, y10);
+	t16 = veorq_u8(t15, t12);
+	t17 = veorq_u8(t4, t14);
+	t18 = veorq_u8(t6, t16);
+	t19 = veorq_u8(t9, t14);
+	t20 = veorq_u8(t11, t16);
+	t21 = veorq_u8(t17, y20);
+	t22 = veorq_u8(t18, y19);
+	t23 = veorq_u8(t19, y21);
+	t24 = veorq_u8(t20, y18);
+
+	t25 = veorq_u8(t21, t22);
+	t26 = vandq_u8(t21, t23);
+	t27 = veorq_u8(t24, t26);
+	t28 = vandq_u8(t25, t27);
+	t29 = veorq_u8(t28, t22);
+	t30 = veorq_u8(t23, t24);
+	t31 = veorq_u8(t22, t26);
+	t32 = vandq_u8(t31, t30);
+	t33 = veorq_u8(t32, t24);
+	t34 = veorq_u8(t23, t33);
+	t35 = veorq_u8(t27, t33);
+	t36 = vandq_u8(t24, t35);
+	t37 = veorq_u8(t36, t34);
+	t38 = veorq_u8(t27, t36);
+	t39 = vandq_u8(t29, t38);
+	t40 = veorq_u8(t25, t39);
+
+	t41 = veorq_u8(t40, t37);
+	t42 = veorq_u8(t29, t33);
+	t43 = veorq_u8(t29, t40);
+	t44 = veorq_u8(t33, t37);
+	t45 = veorq_u8(t42, t41);
+	z0 = vandq_u8(t44, y15);
+	z1 = vandq_u8(t37, y6);
+	z2 = vandq_u8(t33, x7);
+	z3 = vandq_u8(t43, y16);
+	z4 = vandq_u8(t40, y1);
+	z5 = vandq_u8(t29, y7);
+	z6 = vandq_u8(t42, y11);
+	z7 = vandq_u8(t45, y17);
+	z8 = vandq_u8(t41, y10);
+	z9 = vandq_u8(t44, y12);
+	z10 = vandq_u8(t37, y3);
+	z11 = vandq_u8(t33, y4);
+	z12 = vandq_u8(t43, y13);
+	z13 = vandq_u8(t40, y5);
+	z14 = vandq_u8(t29, y2);
+	z15 = vandq_u8(t42, y9);
+	z16 = vandq_u8(t45, y14);
+	z17 = vandq_u8(t41, y8);
+
+	/* bottom linear transformation */
+	t46 = veorq_u8(z15, z16);
+	t47 = veorq_u8(z10, z11);
+	t48 = veorq_u8(z5, z13);
+	t49 = veorq_u8(z9, z10);
+	t50 = veorq_u8(z2, z12);
+	t51 = veorq_u8(z2, z5);
+	t52 = veorq_u8(z7, z8);
+	t53 = veorq_u8(z0, z3);
+	t54 = veorq_u8(z6, z7);
+	t55 = veorq_u8(z16, z17);
+	t56 = veorq_u8(z12, t48);
+	t57 = veorq_u8(t50, t53);
+	t58 = veorq_u8(z4, t46);
+	t59 = veorq_u8(z3, t54);
+	t60 = veorq_u8(t46, t57);
+	t61 = veorq_u8(z14, t57);
+	t62 = veorq_u8(t52, t58);
+	t63 = veorq_u8(t49, t58);
+	t64 = veorq_u8(z4, t59);
+	t65 = veorq_u8(t61, t62);
+	t66 = veorq_u8(z1, t63);
+	s0 = veorq_u8(t59, t63);
+	s6 = vmvnq_u8(veorq_u8(t56, t62));
+	s7 = vmvnq_u8(veorq_u8(t48, t60));
+	t67 = veorq_u8(t64, t65);
+	s3 = veorq_u8(t53, t66);
+	s4 = veorq_u8(t51, t66);
+	s5 = veorq_u8(t47, t65);
+	s1 = vmvnq_u8(veorq_u8(t64, s3));
+	s2 = vmvnq_u8(veorq_u8(t55, t67));
+
+	q[7] = s0;
+	q[6] = s1;
+	q[5] = s2;
+	q[4] = s3;
+	q[3] = s4;
+	q[2] = s5;
+	q[1] = s6;
+	q[0] = s7;
+}
+
+/*
+ * x -> A^-1 * (x + 0x63), the inverse of the affine transformation of
+ * SubBytes.  Wrapping the forward S-box in it on both sides yields the
+ * inverse S-box, as the GF(2^8) inversion in the middle is an involution.
+ */
+static inline void inv_affine(uint8x16_t *q)
+{
+	uint8x16_t r[8];
+	int i;
+
+	for (i = 0; i < 8; i++)
+		r[i] = veorq_u8(veorq_u8(q[(i + 2) & 7], q[(i + 5) & 7]),
+				q[(i + 7) & 7]);
+
+	q[0] = vmvnq_u8(r[0]);
+	q[1] = r[1];
+	q[2] = vmvnq_u8(r[2]);
+	for (i = 3; i < 8; i++)
+		q[i] = r[i];
+}
+
+static inline void inv_sub_bytes(uint8x16_t *q)
+{
+	inv_affine(q);
+	sub_bytes(q);
+	inv_affine(q);
+}
+
+static inline uint8x16_t shuffle(uint8x16_t x, uint8x8_t lo, uint8x8_t hi)
+{
+	uint8x8x2_t t;
+
+	t.val[0] = vget_low_u8(x);
+	t.val[1] = vget_high_u8(x);
+	return vcombine_u8(vtbl2_u8(t, lo), vtbl2_u8(t, hi));
+}
+
+static inline void permute(uint8x16_t *q, const unsigned char *perm)
+{
+	uint8x8_t lo = vld1_u8(perm);
+	uint8x8_t hi = vld1_u8(perm + 8);
+	int i;
+
+	for (i = 0; i < 8; i++)
+		q[i] = shuffle(q[i], lo, hi);
+}
+
+/* byte r of every column takes the value of byte r + 1 */
+static inline uint8x16_t rot1(uint8x16_t x)
+{
+	uint32x4_t w = vreinterpretq_u32_u8(x);
+
+	return vreinterpretq_u8_u32(vsriq_n_u32(vshlq_n_u32(w, 24), w, 8));
+}
+
+/* byte r of every column takes the value of byte r + 2 */
+static inline uint8x16_t rot2(uint8x16_t x)
+{
+	return vreinterpretq_u8_u16(vrev32q_u16(vreinterpretq_u16_u8(x)));
+}
+
+/* multiplication by x in GF(2^8) */
+static inline void xtime(uint8x16_t *r, const uint8x16_t *q)
+{
+	r[0] = q[7];
+	r[1] = veorq_u8(q[0], q[7]);
+	r[2] = q[1];
+	r[3] = veorq_u8(q[2], q[7]);
+	r[4] = veorq_u8(q[3], q[7]);
+	r[5] = q[4];
+	r[6] = q[5];
+	r[7] = q[6];
+}
+
+/*
+ * out[r] = 2 * a[r] + 3 * a[r + 1] + a[r + 2] + a[r + 3]
+ *        = 2 * (a[r] + a[r + 1]) + a[r + 1] + rot2(a[r] + a[r + 1])
+ */
+static inline void mix_columns(uint8x16_t *q)
+{
+	uint8x16_t b[8], c[8], x[8];
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		b[i] = rot1(q[i]);
+		c[i] = veorq_u8(q[i], b[i]);
+	}
+	xtime(x, c);
+	for (i = 0; i < 8; i++)
+		q[i] = veorq_u8(veorq_u8(x[i], b[i]), rot2(c[i]));
+}
+
+/*
+ * InvMixColumns is MixColumns preceded by a[r] += 4 * (a[r] + a[r + 2]),
+ * see "The Design of Rijndael", section 4.1.3.
+ */
+static inline void inv_mix_columns(uint8x16_t *q)
+{
+	uint8x16_t c[8], x[8];
+	int i;
+
+	for (i = 0; i < 8; i++)
+		c[i] = veorq_u8(q[i], rot2(q[i]));
+	xtime(x, c);
+	xtime(c, x);
+	for (i = 0; i < 8; i++)
+		q[i] = veorq_u8(q[i], c[i]);
+	mix_columns(q);
+}
+
+static inline void load_blocks(uint8x16_t *q, const unsigned char *src,
+			       int blocks)
+{
+	int i;
+
+	for (i = 0; i < AESBS_BLOCKS; i++)
+		q[i] = i < blocks ? vld1q_u8(src + 16 * i) : vdupq_n_u8(0);
+	bitslice(q);
+}
+
+static inline void store_blocks(unsigned char *dst, uint8x16_t *q,
+				int blocks)
+{
+	int i;
+
+	bitslice(q);
+	for (i = 0; i < blocks; i++)
+		vst1q_u8(dst + 16 * i, q[i]);
+}
+
+void aesbs_encrypt(const struct aesbs_key *key, unsigned char *dst,
+		   const unsigned char *src, int blocks)
+{
+	uint8x16_t q[8];
+	int round;
+
+	load_blocks(q, src, blocks);
+
+	add_round_key(q, key->rk[0][0]);
+	for (round = 1; round < key->rounds; round++) {
+		sub_bytes(q);
+		permute(q, shift_rows);
+		mix_columns(q);
+		add_round_key(q, key->rk[round][0]);
+	}
+	sub_bytes(q);
+	permute(q, shift_rows);
+	add_round_key(q, key->rk[round][0]);
+
+	store_blocks(dst, q, blocks);
+}
+
+void aesbs_decrypt(const struct aesbs_key *key, unsigned char *dst,
+		   const unsigned char *src, int blocks)
+{
+	uint8x16_t q[8];
+	int round;
+
+	load_blocks(q, src, blocks);
+
+	add_round_key(q, key->rk[key->rounds][0]);
+	for (round = key->rounds - 1; round > 0; round--) {
+		permute(q, inv_shift_rows);
+		inv_sub_bytes(q);
+		add_round_key(q, key->rk[round][0]);
+		inv_mix_columns(q);
+	}
+	permute(q, inv_shift_rows);
+	inv_sub_bytes(q);
+	add_round_key(q, key->rk[0][0]);
+
+	store_blocks(dst, q, blocks);
+}
@@ -0,0 +1,37 @@
+/*
+ * Bit sliced AES using NEON instructions
+ *
+ * This header is shared between the NEON core, which is built without
+ * the kernel headers, and the glue code, so it only uses plain C types.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef _AES_NEONBS_H
+#define _AES_NEONBS_H
+
+/* Number of blocks processed in parallel by the bit sliced core */
+#define AESBS_BLOCKS		8
+
+/*
+ * Bit sliced key schedule: every round key is expanded into 8 bit planes
+ * of 16 bytes, each byte 0x00 or 0xff depending on the value of the bit
+ * in that byte of the round key.
+ */
+struct aesbs_key {
+	unsigned char	rk[15][8][16];
+	int		rounds;
+};
+
+/*
+ * Encrypt or decrypt @blocks (1 to AESBS_BLOCKS) consecutive blocks from
+ * @src to @dst, which may overlap.  Must be called between
+ * kernel_neon_begin() and kernel_neon_end().
+ */
+void aesbs_encrypt(const struct aesbs_key *key, unsigned char *dst,
+		   const unsigned char *src, int blocks);
+void aesbs_decrypt(const struct aesbs_key *key, unsigned char *dst,
+		   const unsigned char *src, int blocks);
+
+#endif /* _AES_NEONBS_H */
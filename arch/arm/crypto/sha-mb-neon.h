@@ -0,0 +1,30 @@
+/*
+ * Multi-buffer SHA-1 and SHA-256 using NEON instructions
+ *
+ * This header is shared between the NEON cores, which are built without
+ * the kernel headers, and the glue code, so it only uses plain C types.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef _SHA_MB_NEON_H
+#define _SHA_MB_NEON_H
+
+/* Number of messages hashed side by side, one per 32-bit NEON lane */
+#define SHA_MB_LANES		4
+
+/*
+ * Run @blocks 64 byte blocks of each of the SHA_MB_LANES messages at
+ * @data through the compression function.  The chaining values are kept
+ * transposed: state[i][lane] is word i of the state of that lane.  Must
+ * be called between kernel_neon_begin() and kernel_neon_end().
+ */
+void sha1_mb_neon_blocks(unsigned int state[5][SHA_MB_LANES],
+			 const unsigned char * const data[SHA_MB_LANES],
+			 int blocks);
+void sha256_mb_neon_blocks(unsigned int state[8][SHA_MB_LANES],
+			   const unsigned char * const data[SHA_MB_LANES],
+			   int blocks);
+
+#endif /* _SHA_MB_NEON_H */
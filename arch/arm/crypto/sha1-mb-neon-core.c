@@ -0,0 +1,120 @@
+/*
+ * Multi-buffer SHA-1 using NEON instructions
+ *
+ * Four independent messages are hashed at once, each in one 32-bit lane
+ * of the 128-bit registers: every vector operation performs the same
+ * step of the compression function for all four of them.  The message
+ * words of the lanes are gathered into vectors with a 4x4 transpose.
+ *
+ * This file is built with NEON enabled and must not include any kernel
+ * headers.  Callers have to bracket the calls with kernel_neon_begin() and
+ * kernel_neon_end().
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <arm_neon.h>
+#include "sha-mb-neon.h"
+
+#define ROL(x, n)	vsriq_n_u32(vshlq_n_u32(x, n), x, 32 - (n))
+
+/* Ch and Maj are bit selects: b ? c : d and (b ^ c) ? d : c */
+#define F_CH(b, c, d)		vbslq_u32(b, c, d)
+#define F_PARITY(b, c, d)	veorq_u32(veorq_u32(b, c), d)
+#define F_MAJ(b, c, d)		vbslq_u32(veorq_u32(b, c), d, c)
+
+/*
+ * Load 16 bytes at @off of every lane, convert them to big endian words
+ * and transpose, so that w[j] holds word j of all four lanes.
+ */
+static inline void load_words(uint32x4_t *w, const unsigned char * const *p,
+			      int off)
+{
+	uint32x4_t r0, r1, r2, r3;
+	uint32x4x2_t t0, t1;
+
+	r0 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p[0] + off)));
+	r1 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p[1] + off)));
+	r2 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p[2] + off)));
+	r3 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p[3] + off)));
+
+	t0 = vtrnq_u32(r0, r1);
+	t1 = vtrnq_u32(r2, r3);
+
+	w[0] = vcombine_u32(vget_low_u32(t0.val[0]), vget_low_u32(t1.val[0]));
+	w[1] = vcombine_u32(vget_low_u32(t0.val[1]), vget_low_u32(t1.val[1]));
+	w[2] = vcombine_u32(vget_high_u32(t0.val[0]),
+			    vget_high_u32(t1.val[0]));
+	w[3] = vcombine_u32(vget_high_u32(t0.val[1]),
+			    vget_high_u32(t1.val[1]));
+}
+
+#define ROUND(fn, a, b, c, d, e, i) do {				\
+	if ((i) >= 16)							\
+		w[(i) & 15] = ROL(veorq_u32(				\
+				veorq_u32(w[((i) + 13) & 15],		\
+					  w[((i) + 8) & 15]),		\
+				veorq_u32(w[((i) + 2) & 15],		\
+					  w[(i) & 15])), 1);		\
+	e = vaddq_u32(vaddq_u32(e, ROL(a, 5)),				\
+		      vaddq_u32(fn(b, c, d), vaddq_u32(w[(i) & 15], k)));	\
+	b = ROL(b, 30);							\
+} while (0)
+
+#define ROUNDS(fn, k0, first) do {					\
+	k = vdupq_n_u32(k0);						\
+	for (i = first; i < first + 20; i += 5) {			\
+		ROUND(fn, a, b, c, d, e, i + 0);			\
+		ROUND(fn, e, a, b, c, d, i + 1);			\
+		ROUND(fn, d, e, a, b, c, i + 2);			\
+		ROUND(fn, c, d, e, a, b, i + 3);			\
+		ROUND(fn, b, c, d, e, a, i + 4);			\
+	}								\
+} while (0)
+
+void sha1_mb_neon_blocks(unsigned int state[5][SHA_MB_LANES],
+			 const unsigned char * const data[SHA_MB_LANES],
+			 int blocks)
+{
+	const unsigned char *p[SHA_MB_LANES];
+	uint32x4_t a, b, c, d, e, k;
+	uint32x4_t w[16];
+	int i, l;
+
+	for (l = 0; l < SHA_MB_LANES; l++)
+		p[l] = data[l];
+
+	a = vld1q_u32(state[0]);
+	b = vld1q_u32(state[1]);
+	c = vld1q_u32(state[2]);
+	d = vld1q_u32(state[3]);
+	e = vld1q_u32(state[4]);
+
+	while (blocks--) {
+		uint32x4_t a0 = a, b0 = b, c0 = c, d0 = d, e0 = e;
+
+		for (i = 0; i < 4; i++)
+			load_words(w + 4 * i, p, 16 * i);
+		for (l = 0; l < SHA_MB_LANES; l++)
+			p[l] += 64;
+
+		ROUNDS(F_CH, 0x5a827999, 0);
+		ROUNDS(F_PARITY, 0x6ed9eba1, 20);
+		ROUNDS(F_MAJ, 0x8f1bbcdc, 40);
+		ROUNDS(F_PARITY, 0xca62c1d6, 60);
+
+		a = vaddq_u32(a, a0);
+		b = vaddq_u32(b, b0);
+		c = vaddq_u32(c, c0);
+		d = vaddq_u32(d, d0);
+		e = vaddq_u32(e, e0);
+	}
+
+	vst1q_u32(state[0], a);
+	vst1q_u32(state[1], b);
+	vst1q_u32(state[2], c);
+	vst1q_u32(state[3], d);
+	vst1q_u32(state[4], e);
+}
@@ -0,0 +1,298 @@
+/*
+ * Cryptographic API.
+ *
+ * Glue code for the SHA1 Secure Hash Algorithm assembler implementation
+ * for ARM.
+ *
+ * This file is based on sha1_ssse3_glue.c
+ *
+ * Copyright (c) Alan Smithee.
+ * Copyright (c) Andrew McDonald <andrew@mcdonald.org.uk>
+ * Copyright (c) Jean-Francois Dive <jef@linuxbe.org>
+ * Copyright (c) Mathias Krause <minipli@googlemail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ */
+
+#include <crypto/internal/hash.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/cryptohash.h>
+#include <linux/types.h>
+#include <crypto/sha.h>
+#include <asm/byteorder.h>
+#ifdef CONFIG_KERNEL_MODE_NEON
+#include <asm/neon.h>
+#include <asm/unaligned.h>
+#include "sha-mb-neon.h"
+#endif
+
+
+asmlinkage void sha1_block_data_order(u32 *digest, const void *data,
+				      unsigned int rounds);
+
+
+static int sha1_arm_init(struct shash_desc *desc)
+{
+	struct sha1_state *sctx = shash_desc_ctx(desc);
+
+	*sctx = (struct sha1_state){
+		.state = { SHA1_H0, SHA1_H1, SHA1_H2, SHA1_H3, SHA1_H4 },
+	};
+
+	return 0;
+}
+
+static int __sha1_arm_update(struct sha1_state *sctx, const u8 *data,
+			     unsigned int len, unsigned int partial)
+{
+	unsigned int done = 0;
+
+	sctx->count += len;
+
+	if (partial) {
+		done = SHA1_BLOCK_SIZE - partial;
+		memcpy(sctx->buffer + partial, data, done);
+		sha1_block_data_order(sctx->state, sctx->buffer, 1);
+	}
+
+	if (len - done >= SHA1_BLOCK_SIZE) {
+		const unsigned int rounds = (len - done) / SHA1_BLOCK_SIZE;
+
+		sha1_block_data_order(sctx->state, data + done, rounds);
+		done += rounds * SHA1_BLOCK_SIZE;
+	}
+
+	memcpy(sctx->buffer, data + done, len - done);
+
+	return 0;
+}
+
+static int sha1_arm_update(struct shash_desc *desc, const u8 *data,
+			   unsigned int len)
+{
+	struct sha1_state *sctx = shash_desc_ctx(desc);
+	unsigned int partial = sctx->count % SHA1_BLOCK_SIZE;
+
+	/* Handle the fast case right here */
+	if (partial + len < SHA1_BLOCK_SIZE) {
+		sctx->count += len;
+		memcpy(sctx->buffer + partial, data, len);
+
+		return 0;
+	}
+
+	return __sha1_arm_update(sctx, data, len, partial);
+}
+
+
+/* Add padding and return the message digest. */
+static int sha1_arm_final(struct shash_desc *desc, u8 *out)
+{
+	struct sha1_state *sctx = shash_desc_ctx(desc);
+	unsigned int i, index, padlen;
+	__be32 *dst = (__be32 *)out;
+	__be64 bits;
+	static const u8 padding[SHA1_BLOCK_SIZE] = { 0x80, };
+
+	bits = cpu_to_be64(sctx->count << 3);
+
+	/* Pad out to 56 mod 64 and append length */
+	index = sctx->count % SHA1_BLOCK_SIZE;
+	padlen = (index < 56) ? (56 - index) : ((SHA1_BLOCK_SIZE+56) - index);
+	/* We need to fill a whole block for __sha1_arm_update() */
+	if (padlen <= 56) {
+		sctx->count += padlen;
+		memcpy(sctx->buffer + index, padding, padlen);
+	} else {
+		__sha1_arm_update(sctx, padding, padlen, index);
+	}
+	__sha1_arm_update(sctx, (const u8 *)&bits, sizeof(bits), 56);
+
+	/* Store state in digest */
+	for (i = 0; i < 5; i++)
+		dst[i] = cpu_to_be32(sctx->state[i]);
+
+	/* Wipe context */
+	memset(sctx, 0, sizeof(*sctx));
+
+	return 0;
+}
+
+#ifdef CONFIG_KERNEL_MODE_NEON
+/* Blocks per message between kernel_neon_begin() and kernel_neon_end() */
+#define SHA1_MB_CHUNK		64
+
+/*
+ * Finish up to SHA_MB_LANES messages from @sctx in the NEON lanes.  A
+ * block left partial in @sctx is completed lane by lane with the integer
+ * code first, the last bytes and the padding of every lane are laid out
+ * in @tail, so that all lanes run the same number of blocks.  Unused
+ * lanes shadow the first message.
+ */
+static void sha1_mb_neon(const struct sha1_state *sctx,
+			 const u8 * const data[], unsigned int len,
+			 u8 * const outs[], unsigned int num_msgs)
+{
+	u32 state[5][SHA_MB_LANES];
+	u8 tail[SHA_MB_LANES][2 * SHA1_BLOCK_SIZE];
+	const u8 *src[SHA_MB_LANES];
+	unsigned int partial = sctx->count % SHA1_BLOCK_SIZE;
+	unsigned int pre, head, rest, blocks, tail_len, n, i, l;
+	__be64 bits = cpu_to_be64((sctx->count + len) << 3);
+
+	if (partial && partial + len < SHA1_BLOCK_SIZE) {
+		pre = partial;
+		head = 0;
+		blocks = 0;
+		rest = len;
+	} else {
+		pre = 0;
+		head = partial ? SHA1_BLOCK_SIZE - partial : 0;
+		blocks = (len - head) / SHA1_BLOCK_SIZE;
+		rest = (len - head) % SHA1_BLOCK_SIZE;
+	}
+	tail_len = pre + rest < 56 ? SHA1_BLOCK_SIZE : 2 * SHA1_BLOCK_SIZE;
+
+	for (l = 0; l < SHA_MB_LANES; l++) {
+		const u8 *msg = data[l < num_msgs ? l : 0];
+		u32 lane[5];
+		u8 *t = tail[l];
+
+		memcpy(lane, sctx->state, sizeof(lane));
+		if (head) {
+			memcpy(t, sctx->buffer, partial);
+			memcpy(t + partial, msg, head);
+			sha1_block_data_order(lane, t, 1);
+		} else if (pre) {
+			memcpy(t, sctx->buffer, pre);
+		}
+
+		for (i = 0; i < 5; i++)
+			state[i][l] = lane[i];
+		src[l] = msg + head;
+
+		n = pre + rest;
+		memcpy(t + pre, msg + len - rest, rest);
+		t[n++] = 0x80;
+		memset(t + n, 0, tail_len - 8 - n);
+		memcpy(t + tail_len - 8, &bits, sizeof(bits));
+	}
+
+	while (blocks) {
+		n = min_t(unsigned int, blocks, SHA1_MB_CHUNK);
+		kernel_neon_begin();
+		sha1_mb_neon_blocks(state, src, n);
+		kernel_neon_end();
+		for (l = 0; l < SHA_MB_LANES; l++)
+			src[l] += n * SHA1_BLOCK_SIZE;
+		blocks -= n;
+	}
+
+	for (l = 0; l < SHA_MB_LANES; l++)
+		src[l] = tail[l];
+	kernel_neon_begin();
+	sha1_mb_neon_blocks(state, src, tail_len / SHA1_BLOCK_SIZE);
+	kernel_neon_end();
+
+	for (l = 0; l < num_msgs; l++)
+		for (i = 0; i < 5; i++)
+			put_unaligned_be32(state[i][l], outs[l] + 4 * i);
+
+	memset(state, 0, sizeof(state));
+	memset(tail, 0, sizeof(tail));
+}
+
+static int sha1_arm_finup_mb(struct shash_desc *desc,
+			     const u8 * const data[], unsigned int len,
+			     u8 * const outs[], unsigned int num_msgs)
+{
+	struct sha1_state *sctx = shash_desc_ctx(desc);
+	struct {
+		struct shash_desc shash;
+		struct sha1_state sctx;
+	} copy;
+	unsigned int i;
+
+	if (may_use_neon()) {
+		sha1_mb_neon(sctx, data, len, outs, num_msgs);
+		return 0;
+	}
+
+	for (i = 0; i < num_msgs; i++) {
+		copy.shash = *desc;
+		copy.sctx = *sctx;
+		sha1_arm_update(&copy.shash, data[i], len);
+		sha1_arm_final(&copy.shash, outs[i]);
+	}
+
+	return 0;
+}
+#endif
+
+static int sha1_arm_export(struct shash_desc *desc, void *out)
+{
+	struct sha1_state *sctx = shash_desc_ctx(desc);
+
+	memcpy(out, sctx, sizeof(*sctx));
+
+	return 0;
+}
+
+static int sha1_arm_import(struct shash_desc *desc, const void *in)
+{
+	struct sha1_state *sctx = shash_desc_ctx(desc);
+
+	memcpy(sctx, in, sizeof(*sctx));
+
+	return 0;
+}
+
+static struct shash_alg alg = {
+	.digestsize	=	SHA1_DIGEST_SIZE,
+	.init		=	sha1_arm_init,
+	.update		=	sha1_arm_update,
+	.final		=	sha1_arm_final,
+	.export		=	sha1_arm_export,
+	.import		=	sha1_arm_import,
+	.descsize	=	sizeof(struct sha1_state),
+	.statesize	=	sizeof(struct sha1_state),
+	.base		=	{
+		.cra_name	=	"sha1",
+		.cra_driver_name=	"sha1-asm",
+		.cra_priority	=	150,
+		.cra_flags	=	CRYPTO_ALG_TYPE_SHASH,
+		.cra_blocksize	=	SHA1_BLOCK_SIZE,
+		.cra_module	=	THIS_MODULE,
+	}
+};
+
+
+static int __init sha1_mod_init(void)
+{
+#ifdef CONFIG_KERNEL_MODE_NEON
+	if (cpu_has_neon()) {
+		alg.finup_mb = sha1_arm_finup_mb;
+		alg.mb_max_msgs = SHA_MB_LANES;
+	}
+#endif
+	return crypto_register_shash(&alg);
+}
+
+
+static void __exit sha1_mod_fini(void)
+{
+	crypto_unregister_shash(&alg);
+}
+
+
+module_init(sha1_mod_init);
+module_exit(sha1_mod_fini);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("SHA1 Secure Hash Algorithm (ARM)");
+MODULE_ALIAS("sha1");
@@ -0,0 +1,153 @@
+/*
+ * Multi-buffer SHA-256 using NEON instructions
+ *
+ * Four independent messages are hashed at once, each in one 32-bit lane
+ * of the 128-bit registers: every vector operation performs the same
+ * step of the compression function for all four of them.  The message
+ * words of the lanes are gathered into vectors with a 4x4 transpose.
+ *
+ * This file is built with NEON enabled and must not include any kernel
+ * headers.  Callers have to bracket the calls with kernel_neon_begin() and
+ * kernel_neon_end().
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <arm_neon.h>
+#include "sha-mb-neon.h"
+
+static const unsigned int sha256_k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define ROR(x, n)	vsriq_n_u32(vshlq_n_u32(x, 32 - (n)), x, n)
+
+#define S0(x)	veorq_u32(veorq_u32(ROR(x, 2), ROR(x, 13)), ROR(x, 22))
+#define S1(x)	veorq_u32(veorq_u32(ROR(x, 6), ROR(x, 11)), ROR(x, 25))
+#define s0(x)	veorq_u32(veorq_u32(ROR(x, 7), ROR(x, 18)), vshrq_n_u32(x, 3))
+#define s1(x)	veorq_u32(veorq_u32(ROR(x, 17), ROR(x, 19)), vshrq_n_u32(x, 10))
+
+/* Ch and Maj are bit selects: e ? f : g and (a ^ b) ? c : b */
+#define CH(e, f, g)	vbslq_u32(e, f, g)
+#define MAJ(a, b, c)	vbslq_u32(veorq_u32(a, b), c, b)
+
+/*
+ * Load 16 bytes at @off of every lane, convert them to big endian words
+ * and transpose, so that w[j] holds word j of all four lanes.
+ */
+static inline void load_words(uint32x4_t *w, const unsigned char * const *p,
+			      int off)
+{
+	uint32x4_t r0, r1, r2, r3;
+	uint32x4x2_t t0, t1;
+
+	r0 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p[0] + off)));
+	r1 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p[1] + off)));
+	r2 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p[2] + off)));
+	r3 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p[3] + off)));
+
+	t0 = vtrnq_u32(r0, r1);
+	t1 = vtrnq_u32(r2, r3);
+
+	w[0] = vcombine_u32(vget_low_u32(t0.val[0]), vget_low_u32(t1.val[0]));
+	w[1] = vcombine_u32(vget_low_u32(t0.val[1]), vget_low_u32(t1.val[1]));
+	w[2] = vcombine_u32(vget_high_u32(t0.val[0]),
+			    vget_high_u32(t1.val[0]));
+	w[3] = vcombine_u32(vget_high_u32(t0.val[1]),
+			    vget_high_u32(t1.val[1]));
+}
+
+#define ROUND(a, b, c, d, e, f, g, h, i) do {				\
+	uint32x4_t __t1, __t2;						\
+									\
+	if ((i) >= 16)							\
+		w[(i) & 15] = vaddq_u32(vaddq_u32(w[(i) & 15],		\
+						  s0(w[((i) + 1) & 15])),	\
+					vaddq_u32(w[((i) + 9) & 15],	\
+						  s1(w[((i) + 14) & 15])));	\
+	__t1 = vaddq_u32(vaddq_u32(h, S1(e)),				\
+			 vaddq_u32(CH(e, f, g),				\
+				   vaddq_u32(w[(i) & 15],		\
+					     vdupq_n_u32(sha256_k[i]))));	\
+	__t2 = vaddq_u32(S0(a), MAJ(a, b, c));				\
+	d = vaddq_u32(d, __t1);						\
+	h = vaddq_u32(__t1, __t2);					\
+} while (0)
+
+void sha256_mb_neon_blocks(unsigned int state[8][SHA_MB_LANES],
+			   const unsigned char * const data[SHA_MB_LANES],
+			   int blocks)
+{
+	const unsigned char *p[SHA_MB_LANES];
+	uint32x4_t a, b, c, d, e, f, g, h;
+	uint32x4_t w[16];
+	int i, l;
+
+	for (l = 0; l < SHA_MB_LANES; l++)
+		p[l] = data[l];
+
+	a = vld1q_u32(state[0]);
+	b = vld1q_u32(state[1]);
+	c = vld1q_u32(state[2]);
+	d = vld1q_u32(state[3]);
+	e = vld1q_u32(state[4]);
+	f = vld1q_u32(state[5]);
+	g = vld1q_u32(state[6]);
+	h = vld1q_u32(state[7]);
+
+	while (blocks--) {
+		uint32x4_t a0 = a, b0 = b, c0 = c, d0 = d;
+		uint32x4_t e0 = e, f0 = f, g0 = g, h0 = h;
+
+		for (i = 0; i < 4; i++)
+			load_words(w + 4 * i, p, 16 * i);
+		for (l = 0; l < SHA_MB_LANES; l++)
+			p[l] += 64;
+
+		for (i = 0; i < 64; i += 8) {
+			ROUND(a, b, c, d, e, f, g, h, i + 0);
+			ROUND(h, a, b, c, d, e, f, g, i + 1);
+			ROUND(g, h, a, b, c, d, e, f, i + 2);
+			ROUND(f, g, h, a, b, c, d, e, i + 3);
+			ROUND(e, f, g, h, a, b, c, d, i + 4);
+			ROUND(d, e, f, g, h, a, b, c, i + 5);
+			ROUND(c, d, e, f, g, h, a, b, i + 6);
+			ROUND(b, c, d, e, f, g, h, a, i + 7);
+		}
+
+		a = vaddq_u32(a, a0);
+		b = vaddq_u32(b, b0);
+		c = vaddq_u32(c, c0);
+		d = vaddq_u32(d, d0);
+		e = vaddq_u32(e, e0);
+		f = vaddq_u32(f, f0);
+		g = vaddq_u32(g, g0);
+		h = vaddq_u32(h, h0);
+	}
+
+	vst1q_u32(state[0], a);
+	vst1q_u32(state[1], b);
+	vst1q_u32(state[2], c);
+	vst1q_u32(state[3], d);
+	vst1q_u32(state[4], e);
+	vst1q_u32(state[5], f);
+	vst1q_u32(state[6], g);
+	vst1q_u32(state[7], h);
+}
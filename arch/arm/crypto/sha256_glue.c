@@ -0,0 +1,383 @@
+/*
+ * Cryptographic API.
+ *
+ * Glue code for the SHA224/SHA256 Secure Hash Algorithm assembler
+ * implementation for ARM.
+ *
+ * This file is based on sha1_glue.c and sha256_generic.c
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ */
+
+#include <crypto/internal/hash.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/cryptohash.h>
+#include <linux/types.h>
+#include <crypto/sha.h>
+#include <asm/byteorder.h>
+#ifdef CONFIG_KERNEL_MODE_NEON
+#include <asm/neon.h>
+#include <asm/unaligned.h>
+#include "sha-mb-neon.h"
+#endif
+
+
+asmlinkage void sha256_block_data_order(u32 *digest, const void *data,
+					unsigned int rounds);
+
+
+static int sha224_arm_init(struct shash_desc *desc)
+{
+	struct sha256_state *sctx = shash_desc_ctx(desc);
+
+	*sctx = (struct sha256_state){
+		.state = { SHA224_H0, SHA224_H1, SHA224_H2, SHA224_H3,
+			   SHA224_H4, SHA224_H5, SHA224_H6, SHA224_H7 },
+	};
+
+	return 0;
+}
+
+static int sha256_arm_init(struct shash_desc *desc)
+{
+	struct sha256_state *sctx = shash_desc_ctx(desc);
+
+	*sctx = (struct sha256_state){
+		.state = { SHA256_H0, SHA256_H1, SHA256_H2, SHA256_H3,
+			   SHA256_H4, SHA256_H5, SHA256_H6, SHA256_H7 },
+	};
+
+	return 0;
+}
+
+static int __sha256_arm_update(struct sha256_state *sctx, const u8 *data,
+			       unsigned int len, unsigned int partial)
+{
+	unsigned int done = 0;
+
+	sctx->count += len;
+
+	if (partial) {
+		done = SHA256_BLOCK_SIZE - partial;
+		memcpy(sctx->buf + partial, data, done);
+		sha256_block_data_order(sctx->state, sctx->buf, 1);
+	}
+
+	if (len - done >= SHA256_BLOCK_SIZE) {
+		const unsigned int rounds = (len - done) / SHA256_BLOCK_SIZE;
+
+		sha256_block_data_order(sctx->state, data + done, rounds);
+		done += rounds * SHA256_BLOCK_SIZE;
+	}
+
+	memcpy(sctx->buf, data + done, len - done);
+
+	return 0;
+}
+
+static int sha256_arm_update(struct shash_desc *desc, const u8 *data,
+			     unsigned int len)
+{
+	struct sha256_state *sctx = shash_desc_ctx(desc);
+	unsigned int partial = sctx->count % SHA256_BLOCK_SIZE;
+
+	/* Handle the fast case right here */
+	if (partial + len < SHA256_BLOCK_SIZE) {
+		sctx->count += len;
+		memcpy(sctx->buf + partial, data, len);
+
+		return 0;
+	}
+
+	return __sha256_arm_update(sctx, data, len, partial);
+}
+
+static void sha256_arm_pad(struct sha256_state *sctx)
+{
+	unsigned int index, padlen;
+	__be64 bits;
+	static const u8 padding[SHA256_BLOCK_SIZE] = { 0x80, };
+
+	bits = cpu_to_be64(sctx->count << 3);
+
+	/* Pad out to 56 mod 64 and append length */
+	index = sctx->count % SHA256_BLOCK_SIZE;
+	padlen = (index < 56) ? (56 - index) : ((SHA256_BLOCK_SIZE+56) - index);
+	/* We need to fill a whole block for __sha256_arm_update() */
+	if (padlen <= 56) {
+		sctx->count += padlen;
+		memcpy(sctx->buf + index, padding, padlen);
+	} else {
+		__sha256_arm_update(sctx, padding, padlen, index);
+	}
+	__sha256_arm_update(sctx, (const u8 *)&bits, sizeof(bits), 56);
+}
+
+/* Add padding and return the message digest. */
+static int sha256_arm_final(struct shash_desc *desc, u8 *out)
+{
+	struct sha256_state *sctx = shash_desc_ctx(desc);
+	__be32 *dst = (__be32 *)out;
+	unsigned int i;
+
+	sha256_arm_pad(sctx);
+
+	/* Store state in digest */
+	for (i = 0; i < 8; i++)
+		dst[i] = cpu_to_be32(sctx->state[i]);
+
+	/* Wipe context */
+	memset(sctx, 0, sizeof(*sctx));
+
+	return 0;
+}
+
+static int sha224_arm_final(struct shash_desc *desc, u8 *out)
+{
+	struct sha256_state *sctx = shash_desc_ctx(desc);
+	__be32 *dst = (__be32 *)out;
+	unsigned int i;
+
+	sha256_arm_pad(sctx);
+
+	/* Store state in digest */
+	for (i = 0; i < 7; i++)
+		dst[i] = cpu_to_be32(sctx->state[i]);
+
+	/* Wipe context */
+	memset(sctx, 0, sizeof(*sctx));
+
+	return 0;
+}
+
+#ifdef CONFIG_KERNEL_MODE_NEON
+/* Blocks per message between kernel_neon_begin() and kernel_neon_end() */
+#define SHA256_MB_CHUNK		64
+
+/*
+ * Finish up to SHA_MB_LANES messages from @sctx in the NEON lanes.  A
+ * block left partial in @sctx is completed lane by lane with the integer
+ * code first, the last bytes and the padding of every lane are laid out
+ * in @tail, so that all lanes run the same number of blocks.  Unused
+ * lanes shadow the first message.
+ */
+static void sha256_mb_neon(const struct sha256_state *sctx,
+			   const u8 * const data[], unsigned int len,
+			   u8 * const outs[], unsigned int num_msgs,
+			   unsigned int digest_words)
+{
+	u32 state[8][SHA_MB_LANES];
+	u8 tail[SHA_MB_LANES][2 * SHA256_BLOCK_SIZE];
+	const u8 *src[SHA_MB_LANES];
+	unsigned int partial = sctx->count % SHA256_BLOCK_SIZE;
+	unsigned int pre, head, rest, blocks, tail_len, n, i, l;
+	__be64 bits = cpu_to_be64((sctx->count + len) << 3);
+
+	if (partial && partial + len < SHA256_BLOCK_SIZE) {
+		pre = partial;
+		head = 0;
+		blocks = 0;
+		rest = len;
+	} else {
+		pre = 0;
+		head = partial ? SHA256_BLOCK_SIZE - partial : 0;
+		blocks = (len - head) / SHA256_BLOCK_SIZE;
+		rest = (len - head) % SHA256_BLOCK_SIZE;
+	}
+	tail_len = pre + rest < 56 ? SHA256_BLOCK_SIZE : 2 * SHA256_BLOCK_SIZE;
+
+	for (l = 0; l < SHA_MB_LANES; l++) {
+		const u8 *msg = data[l < num_msgs ? l : 0];
+		u32 lane[8];
+		u8 *t = tail[l];
+
+		memcpy(lane, sctx->state, sizeof(lane));
+		if (head) {
+			memcpy(t, sctx->buf, partial);
+			memcpy(t + partial, msg, head);
+			sha256_block_data_order(lane, t, 1);
+		} else if (pre) {
+			memcpy(t, sctx->buf, pre);
+		}
+
+		for (i = 0; i < 8; i++)
+			state[i][l] = lane[i];
+		src[l] = msg + head;
+
+		n = pre + rest;
+		memcpy(t + pre, msg + len - rest, rest);
+		t[n++] = 0x80;
+		memset(t + n, 0, tail_len - 8 - n);
+		memcpy(t + tail_len - 8, &bits, sizeof(bits));
+	}
+
+	while (blocks) {
+		n = min_t(unsigned int, blocks, SHA256_MB_CHUNK);
+		kernel_neon_begin();
+		sha256_mb_neon_blocks(state, src, n);
+		kernel_neon_end();
+		for (l = 0; l < SHA_MB_LANES; l++)
+			src[l] += n * SHA256_BLOCK_SIZE;
+		blocks -= n;
+	}
+
+	for (l = 0; l < SHA_MB_LANES; l++)
+		src[l] = tail[l];
+	kernel_neon_begin();
+	sha256_mb_neon_blocks(state, src, tail_len / SHA256_BLOCK_SIZE);
+	kernel_neon_end();
+
+	for (l = 0; l < num_msgs; l++)
+		for (i = 0; i < digest_words; i++)
+			put_unaligned_be32(state[i][l], outs[l] + 4 * i);
+
+	memset(state, 0, sizeof(state));
+	memset(tail, 0, sizeof(tail));
+}
+
+static int __sha256_arm_finup_mb(struct shash_desc *desc,
+				 const u8 * const data[], unsigned int len,
+				 u8 * const outs[], unsigned int num_msgs,
+				 int (*final)(struct shash_desc *, u8 *))
+{
+	struct sha256_state *sctx = shash_desc_ctx(desc);
+	struct {
+		struct shash_desc shash;
+		struct sha256_state sctx;
+	} copy;
+	unsigned int i;
+
+	if (may_use_neon()) {
+		sha256_mb_neon(sctx, data, len, outs, num_msgs,
+			       crypto_shash_digestsize(desc->tfm) / 4);
+		return 0;
+	}
+
+	for (i = 0; i < num_msgs; i++) {
+		copy.shash = *desc;
+		copy.sctx = *sctx;
+		sha256_arm_update(&copy.shash, data[i], len);
+		final(&copy.shash, outs[i]);
+	}
+
+	return 0;
+}
+
+static int sha256_arm_finup_mb(struct shash_desc *desc,
+			       const u8 * const data[], unsigned int len,
+			       u8 * const outs[], unsigned int num_msgs)
+{
+	return __sha256_arm_finup_mb(desc, data, len, outs, num_msgs,
+				     sha256_arm_final);
+}
+
+static int sha224_arm_finup_mb(struct shash_desc *desc,
+			       const u8 * const data[], unsigned int len,
+			       u8 * const outs[], unsigned int num_msgs)
+{
+	return __sha256_arm_finup_mb(desc, data, len, outs, num_msgs,
+				     sha224_arm_final);
+}
+#endif
+
+static int sha256_arm_export(struct shash_desc *desc, void *out)
+{
+	struct sha256_state *sctx = shash_desc_ctx(desc);
+
+	memcpy(out, sctx, sizeof(*sctx));
+
+	return 0;
+}
+
+static int sha256_arm_import(struct shash_desc *desc, const void *in)
+{
+	struct sha256_state *sctx = shash_desc_ctx(desc);
+
+	memcpy(sctx, in, sizeof(*sctx));
+
+	return 0;
+}
+
+static struct shash_alg sha256_alg = {
+	.digestsize	=	SHA256_DIGEST_SIZE,
+	.init		=	sha256_arm_init,
+	.update		=	sha256_arm_update,
+	.final		=	sha256_arm_final,
+	.export		=	sha256_arm_export,
+	.import		=	sha256_arm_import,
+	.descsize	=	sizeof(struct sha256_state),
+	.statesize	=	sizeof(struct sha256_state),
+	.base		=	{
+		.cra_name	=	"sha256",
+		.cra_driver_name=	"sha256-asm",
+		.cra_priority	=	150,
+		.cra_flags	=	CRYPTO_ALG_TYPE_SHASH,
+		.cra_blocksize	=	SHA256_BLOCK_SIZE,
+		.cra_module	=	THIS_MODULE,
+	}
+};
+
+static struct shash_alg sha224_alg = {
+	.digestsize	=	SHA224_DIGEST_SIZE,
+	.init		=	sha224_arm_init,
+	.update		=	sha256_arm_update,
+	.final		=	sha224_arm_final,
+	.export		=	sha256_arm_export,
+	.import		=	sha256_arm_import,
+	.descsize	=	sizeof(struct sha256_state),
+	.statesize	=	sizeof(struct sha256_state),
+	.base		=	{
+		.cra_name	=	"sha224",
+		.cra_driver_name=	"sha224-asm",
+		.cra_priority	=	150,
+		.cra_flags	=	CRYPTO_ALG_TYPE_SHASH,
+		.cra_blocksize	=	SHA224_BLOCK_SIZE,
+		.cra_module	=	THIS_MODULE,
+	}
+};
+
+
+static int __init sha256_mod_init(void)
+{
+	int ret;
+
+#ifdef CONFIG_KERNEL_MODE_NEON
+	if (cpu_has_neon()) {
+		sha256_alg.finup_mb = sha256_arm_finup_mb;
+		sha256_alg.mb_max_msgs = SHA_MB_LANES;
+		sha224_alg.finup_mb = sha224_arm_finup_mb;
+		sha224_alg.mb_max_msgs = SHA_MB_LANES;
+	}
+#endif
+
+	ret = crypto_register_shash(&sha224_alg);
+	if (ret < 0)
+		return ret;
+
+	ret = crypto_register_shash(&sha256_alg);
+	if (ret < 0)
+		crypto_unregister_shash(&sha224_alg);
+
+	return ret;
+}
+
+
+static void __exit sha256_mod_fini(void)
+{
+	crypto_unregister_shash(&sha224_alg);
+	crypto_unregister_shash(&sha256_alg);
+}
+
+
+module_init(sha256_mod_init);
+module_exit(sha256_mod_fini);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("SHA-224 and SHA-256 Secure Hash Algorithm (ARM)");
+MODULE_ALIAS("sha224");
+MODULE_ALIAS("sha256");
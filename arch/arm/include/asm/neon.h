@@ -0,0 +1,48 @@
+/*
+ * linux/arch/arm/include/asm/neon.h
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef __ASM_NEON_H
+#define __ASM_NEON_H
+
+#include <asm/hwcap.h>
+
+#define cpu_has_neon()		(!!(elf_hwcap & HWCAP_NEON))
+
+/*
+ * NEON code has to live in separate compilation units that are built
+ * with -mfpu=neon, and calls into it have to be bracketed by these.
+ * Neither may be used in interrupt context, and the code in between
+ * runs with preemption disabled.
+ */
+void kernel_neon_begin(void);
+void kernel_neon_end(void);
+bool may_use_neon(void);
+
+#ifdef CONFIG_NEON_MEMOPS
+/*
+ * The string routines branch to the *_neon() wrappers above the boot
+ * time selected size threshold.  The __*_arm() entry points are the
+ * plain integer implementations, the __*_neon() ones the bare NEON
+ * loops that have to be called between kernel_neon_begin() and
+ * kernel_neon_end().
+ */
+extern unsigned int neon_memops_threshold;
+
+void *__memcpy_arm(void *dest, const void *src, size_t n);
+void *__memset_arm(void *s, int c, size_t n);
+void __copy_page_arm(void *to, const void *from);
+
+void __memcpy_neon(void *dest, const void *src, size_t n);
+void __memset_neon(void *s, int c, size_t n);
+void __copy_page_neon(void *to, const void *from);
+
+void *memcpy_neon(void *dest, const void *src, size_t n);
+void *memset_neon(void *s, int c, size_t n);
+void copy_page_neon(void *to, const void *from);
+#endif
+
+#endif /* __ASM_NEON_H */
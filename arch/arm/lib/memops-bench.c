@@ -0,0 +1,149 @@
+/*
+ *  linux/arch/arm/lib/memops-bench.c
+ *
+ *  Throughput of the integer and NEON memcpy, memset and copy_page
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/gfp.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/sched.h>
+#include <asm/neon.h>
+#include <asm/page.h>
+
+#define BENCH_MAX_SIZE	(64 * 1024)
+#define BENCH_ORDER	get_order(BENCH_MAX_SIZE + PAGE_SIZE)
+
+static unsigned int msec = 100;
+module_param(msec, uint, 0);
+MODULE_PARM_DESC(msec, "Time to spend on each size and alignment");
+
+static const unsigned int bench_sizes[] = {
+	64, 256, 512, 1024, 2048, 4096, 16384, 65536
+};
+
+static const struct {
+	unsigned int dst;
+	unsigned int src;
+} bench_align[] = {
+	{ 0, 0 }, { 0, 4 }, { 4, 0 }, { 1, 3 }, { 3, 1 }, { 8, 8 },
+};
+
+struct memops_variant {
+	const char *name;
+	void *(*do_memcpy)(void *, const void *, size_t);
+	void *(*do_memset)(void *, int, size_t);
+	void (*do_copy_page)(void *, const void *);
+};
+
+static const struct memops_variant variants[] = {
+	{ "arm", __memcpy_arm, __memset_arm, __copy_page_arm },
+	{ "neon", memcpy_neon, memset_neon, copy_page_neon },
+};
+
+enum bench_op { BENCH_MEMCPY, BENCH_MEMSET, BENCH_COPY_PAGE };
+
+static u64 bench_one(const struct memops_variant *v, enum bench_op op,
+		     void *dst, void *src, unsigned int size)
+{
+	ktime_t start, end;
+	u64 bytes = 0, ns, limit = (u64)msec * NSEC_PER_MSEC;
+	int i;
+
+	start = ktime_get();
+	do {
+		for (i = 0; i < 16; i++) {
+			switch (op) {
+			case BENCH_MEMCPY:
+				v->do_memcpy(dst, src, size);
+				break;
+			case BENCH_MEMSET:
+				v->do_memset(dst, i, size);
+				break;
+			case BENCH_COPY_PAGE:
+				v->do_copy_page(dst, src);
+				break;
+			}
+		}
+		bytes += 16 * size;
+		end = ktime_get();
+		ns = ktime_to_ns(ktime_sub(end, start));
+		cond_resched();
+	} while (ns < limit);
+
+	/* bytes per ns * 1000 is MB/s */
+	return div64_u64(bytes * 1000, ns);
+}
+
+static void bench_variant(const struct memops_variant *v, u8 *dst, u8 *src)
+{
+	int i, j;
+
+	for (i = 0; i < ARRAY_SIZE(bench_sizes); i++) {
+		for (j = 0; j < ARRAY_SIZE(bench_align); j++) {
+			unsigned int size = bench_sizes[i];
+			u8 *d = dst + bench_align[j].dst;
+			u8 *s = src + bench_align[j].src;
+
+			printk(KERN_INFO "memops: %-4s %6u bytes dst+%u src+%u: "
+			       "memcpy %llu MB/s, memset %llu MB/s\n",
+			       v->name, size, bench_align[j].dst,
+			       bench_align[j].src,
+			       bench_one(v, BENCH_MEMCPY, d, s, size),
+			       bench_one(v, BENCH_MEMSET, d, NULL, size));
+		}
+	}
+
+	printk(KERN_INFO "memops: %-4s copy_page: %llu MB/s\n", v->name,
+	       bench_one(v, BENCH_COPY_PAGE, dst, src, PAGE_SIZE));
+}
+
+static int __init memops_bench_init(void)
+{
+	unsigned long src, dst;
+	int i;
+
+	src = __get_free_pages(GFP_KERNEL, BENCH_ORDER);
+	dst = __get_free_pages(GFP_KERNEL, BENCH_ORDER);
+	if (!src || !dst)
+		goto out;
+
+	memset((void *)src, 0x5a, PAGE_SIZE << BENCH_ORDER);
+	memset((void *)dst, 0, PAGE_SIZE << BENCH_ORDER);
+
+	printk(KERN_INFO "memops: NEON routines %s, threshold %u bytes\n",
+	       neon_memops_threshold == UINT_MAX ? "disabled" : "enabled",
+	       neon_memops_threshold);
+
+	for (i = 0; i < ARRAY_SIZE(variants); i++)
+		bench_variant(&variants[i], (u8 *)dst, (u8 *)src);
+
+out:
+	if (src)
+		free_pages(src, BENCH_ORDER);
+	if (dst)
+		free_pages(dst, BENCH_ORDER);
+
+	/*
+	 * An error return makes the module unload right away, the results
+	 * are in the kernel log.
+	 */
+	return -EAGAIN;
+}
+
+static void __exit memops_bench_exit(void)
+{
+}
+
+module_init(memops_bench_init);
+module_exit(memops_bench_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("memcpy, memset and copy_page throughput");
@@ -0,0 +1,152 @@
+/*
+ *  linux/arch/arm/lib/neon-memops.c
+ *
+ *  Boot time selection of the NEON memcpy, memset and copy_page
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/export.h>
+#include <linux/notifier.h>
+#include <linux/string.h>
+#include <linux/suspend.h>
+#include <asm/cputype.h>
+#include <asm/neon.h>
+
+/*
+ * Below this size the cost of enabling the NEON unit and saving the
+ * user VFP state outweighs the faster loop, so the integer routines
+ * are kept.
+ */
+#define NEON_MEMOPS_DEFAULT_THRESHOLD	1024
+
+/*
+ * memcpy and memset compare their length against this before doing
+ * anything else, copy_page uses NEON when it is at most PAGE_SIZE.
+ * UINT_MAX keeps everything on the integer routines, which is what
+ * runs until the CPU has been identified and across suspend.
+ */
+unsigned int neon_memops_threshold __read_mostly = UINT_MAX;
+
+static unsigned int neon_memops_saved;
+static int neon_memops_param __initdata = -1;
+
+static int __init neon_memops_setup(char *str)
+{
+	unsigned int threshold;
+
+	if (!strcmp(str, "off"))
+		neon_memops_param = 0;
+	else if (!kstrtouint(str, 0, &threshold) && threshold <= INT_MAX)
+		neon_memops_param = max(threshold, 64U);
+	else
+		return 0;
+	return 1;
+}
+__setup("neon_memops=", neon_memops_setup);
+
+void * notrace memcpy_neon(void *dest, const void *src, size_t n)
+{
+	if (!may_use_neon())
+		return __memcpy_arm(dest, src, n);
+
+	kernel_neon_begin();
+	__memcpy_neon(dest, src, n);
+	kernel_neon_end();
+	return dest;
+}
+EXPORT_SYMBOL(memcpy_neon);
+
+void * notrace memset_neon(void *s, int c, size_t n)
+{
+	if (!may_use_neon())
+		return __memset_arm(s, c, n);
+
+	kernel_neon_begin();
+	__memset_neon(s, c, n);
+	kernel_neon_end();
+	return s;
+}
+EXPORT_SYMBOL(memset_neon);
+
+void notrace copy_page_neon(void *to, const void *from)
+{
+	if (!may_use_neon()) {
+		__copy_page_arm(to, from);
+		return;
+	}
+
+	kernel_neon_begin();
+	__copy_page_neon(to, from);
+	kernel_neon_end();
+}
+EXPORT_SYMBOL(copy_page_neon);
+
+EXPORT_SYMBOL(__memcpy_arm);
+EXPORT_SYMBOL(__memset_arm);
+EXPORT_SYMBOL(__copy_page_arm);
+
+static bool __init neon_memops_cpu_is_krait(void)
+{
+	unsigned int cpuid = read_cpuid_id();
+
+	if ((cpuid >> 24) != 0x51)
+		return false;
+
+	switch (cpuid & 0xFFF0) {
+	case 0x0490:
+	case 0x04D0:
+	case 0x06F0:
+		return true;
+	}
+	return false;
+}
+
+/*
+ * The VFP/NEON access and FPEXC state of the CPUs is not valid over the
+ * whole suspend and resume path, so fall back to the integer routines
+ * for its duration.
+ */
+static int neon_memops_pm_event(struct notifier_block *this,
+				unsigned long event, void *ptr)
+{
+	switch (event) {
+	case PM_SUSPEND_PREPARE:
+		neon_memops_saved = neon_memops_threshold;
+		neon_memops_threshold = UINT_MAX;
+		break;
+	case PM_POST_SUSPEND:
+		neon_memops_threshold = neon_memops_saved;
+		break;
+	}
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block neon_memops_pm_notifier = {
+	.notifier_call = neon_memops_pm_event,
+};
+
+static int __init neon_memops_init(void)
+{
+	unsigned int threshold;
+
+	if (!cpu_has_neon() || neon_memops_param == 0)
+		return 0;
+
+	if (neon_memops_param > 0)
+		threshold = neon_memops_param;
+	else if (neon_memops_cpu_is_krait())
+		threshold = NEON_MEMOPS_DEFAULT_THRESHOLD;
+	else
+		return 0;
+
+	register_pm_notifier(&neon_memops_pm_notifier);
+	neon_memops_threshold = threshold;
+	pr_info("NEON memcpy/memset/copy_page enabled above %u bytes\n",
+		threshold);
+	return 0;
+}
+late_initcall(neon_memops_init);
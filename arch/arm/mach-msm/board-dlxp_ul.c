@@ -61,6 +61,7 @@
 #endif
 #include <mach/msm_memtypes.h>
 #include <linux/bootmem.h>
+#include <linux/dma-contiguous.h>
 #include <asm/setup.h>
 #include <mach/dma.h>
 #include <mach/msm_dsps.h>
@@ -442,6 +443,19 @@ static struct ion_co_heap_pdata fw_co_dlxp_ul_ion_pdata = {
 	.mem_is_fmem = FMEM_ENABLED,
 	.fixed_position = FIXED_LOW,
 };
+
+#ifdef CONFIG_CMA
+static struct device ion_qsecom_cma_dev;
+static struct device ion_audio_cma_dev;
+
+static struct ion_cma_heap_pdata cma_qsecom_dlxp_ul_ion_pdata = {
+	.dev = &ion_qsecom_cma_dev,
+};
+
+static struct ion_cma_heap_pdata cma_audio_dlxp_ul_ion_pdata = {
+	.dev = &ion_audio_cma_dev,
+};
+#endif
 #endif
 
 static struct ion_platform_data ion_pdata = {
@@ -492,19 +506,29 @@ static struct ion_platform_data ion_pdata = {
 		},
 		{
 			.id	= ION_QSECOM_HEAP_ID,
-			.type	= ION_HEAP_TYPE_CARVEOUT,
 			.name	= ION_QSECOM_HEAP_NAME,
 			.size	= MSM_ION_QSECOM_SIZE,
 			.memory_type = ION_EBI_TYPE,
+#ifdef CONFIG_CMA
+			.type	= ION_HEAP_TYPE_CMA,
+			.extra_data = (void *) &cma_qsecom_dlxp_ul_ion_pdata,
+#else
+			.type	= ION_HEAP_TYPE_CARVEOUT,
 			.extra_data = (void *) &co_dlxp_ul_ion_pdata,
+#endif
 		},
 		{
 			.id	= ION_AUDIO_HEAP_ID,
-			.type	= ION_HEAP_TYPE_CARVEOUT,
 			.name	= ION_AUDIO_HEAP_NAME,
 			.size	= MSM_ION_AUDIO_SIZE,
 			.memory_type = ION_EBI_TYPE,
+#ifdef CONFIG_CMA
+			.type	= ION_HEAP_TYPE_CMA,
+			.extra_data = (void *) &cma_audio_dlxp_ul_ion_pdata,
+#else
+			.type	= ION_HEAP_TYPE_CARVEOUT,
 			.extra_data = (void *) &co_dlxp_ul_ion_pdata,
+#endif
 		},
 #endif
 	}
@@ -547,6 +571,27 @@ static void __init apq8064_reserve_fixed_area(unsigned long fixed_area_size)
 #endif
 }
 
+static void __init reserve_ion_cma_memory(void)
+{
+#if defined(CONFIG_ION_MSM) && defined(CONFIG_MSM_MULTIMEDIA_USE_ION) && \
+	defined(CONFIG_CMA)
+	unsigned int i;
+
+	for (i = 0; i < ion_pdata.nr; ++i) {
+		const struct ion_platform_heap *heap =
+			&(ion_pdata.heaps[i]);
+		struct ion_cma_heap_pdata *data = heap->extra_data;
+
+		if (heap->type != ION_HEAP_TYPE_CMA)
+			continue;
+
+		if (dma_declare_contiguous(data->dev, heap->size, 0, 0))
+			pr_err("%s: could not reserve CMA area for heap %s\n",
+				__func__, heap->name);
+	}
+#endif
+}
+
 static void __init reserve_ion_memory(void)
 {
 #if defined(CONFIG_ION_MSM) && defined(CONFIG_MSM_MULTIMEDIA_USE_ION)
@@ -586,6 +631,9 @@ static void __init reserve_ion_memory(void)
 		const struct ion_platform_heap *heap =
 			&(ion_pdata.heaps[i]);
 
+		if (heap->type == ION_HEAP_TYPE_CMA)
+			continue;
+
 		if (heap->extra_data) {
 			int fixed_position = NOT_FIXED;
 			int mem_is_fmem = 0;
@@ -826,6 +874,7 @@ static void __init dlxp_ul_reserve(void)
 		return;
 	
 	msm_reserve();
+	reserve_ion_cma_memory();
 	if (apq8064_fmem_pdata.size) {
 #if defined(CONFIG_ION_MSM) && defined(CONFIG_MSM_MULTIMEDIA_USE_ION)
 		if (reserve_info->fixed_area_size) {
@@ -11,6 +11,7 @@
 #include <linux/types.h>
 #include <linux/cpu.h>
 #include <linux/cpu_pm.h>
+#include <linux/export.h>
 #include <linux/hardirq.h>
 #include <linux/kernel.h>
 #include <linux/notifier.h>
@@ -24,6 +25,7 @@
 
 #include <asm/cp15.h>
 #include <asm/cputype.h>
+#include <asm/neon.h>
 #include <asm/system_info.h>
 #include <asm/thread_notify.h>
 #include <asm/vfp.h>
@@ -438,6 +440,66 @@ int vfp_restore_user_hwstate(struct user_vfp __user *ufp,
 	return err ? -EFAULT : 0;
 }
 
+#ifdef CONFIG_KERNEL_MODE_NEON
+
+static DEFINE_PER_CPU(bool, kernel_neon_busy);
+
+/*
+ * Callers that may run in any context, such as the string routines,
+ * have to check this before kernel_neon_begin() and fall back to the
+ * integer code when it fails.
+ */
+bool notrace may_use_neon(void)
+{
+	return cpu_has_neon() && !in_interrupt() &&
+	       !this_cpu_read(kernel_neon_busy) &&
+	       cpu_online(raw_smp_processor_id());
+}
+EXPORT_SYMBOL(may_use_neon);
+
+void kernel_neon_begin(void)
+{
+	struct thread_info *thread = current_thread_info();
+	unsigned int cpu;
+	u32 fpexc;
+
+	/*
+	 * Kernel mode NEON is only allowed outside of interrupt context
+	 * and with preemption disabled, so that the kernel mode register
+	 * contents never have to be preserved.
+	 */
+	BUG_ON(in_interrupt());
+	cpu = get_cpu();
+
+	fpexc = fmrx(FPEXC) | FPEXC_EN;
+	fmxr(FPEXC, fpexc);
+
+	/*
+	 * Save the userland NEON/VFP state.  Under UP the owner could be
+	 * a task other than current.
+	 */
+	if (vfp_state_in_hw(cpu, thread))
+		vfp_save_state(&thread->vfpstate, fpexc);
+#ifndef CONFIG_SMP
+	else if (vfp_current_hw_state[cpu] != NULL)
+		vfp_save_state(vfp_current_hw_state[cpu], fpexc);
+#endif
+	vfp_current_hw_state[cpu] = NULL;
+	__this_cpu_write(kernel_neon_busy, true);
+}
+EXPORT_SYMBOL(kernel_neon_begin);
+
+void kernel_neon_end(void)
+{
+	__this_cpu_write(kernel_neon_busy, false);
+	/* Disable the NEON/VFP unit, the next user access will reload */
+	fmxr(FPEXC, fmrx(FPEXC) & ~FPEXC_EN);
+	put_cpu();
+}
+EXPORT_SYMBOL(kernel_neon_end);
+
+#endif
+
 static int vfp_hotplug(struct notifier_block *b, unsigned long action,
 	void *hcpu)
 {
@@ -358,6 +358,10 @@ struct request_queue *blk_alloc_queue_node(gfp_t gfp_mask, int node_id)
 	if (q->id < 0)
 		goto fail_q;
 
+	q->lock_stats = alloc_percpu(struct blk_queue_lock_stats);
+	if (!q->lock_stats)
+		goto fail_id;
+
 	q->backing_dev_info.ra_pages =
 			(VM_MAX_READAHEAD * 1024) / PAGE_CACHE_SIZE;
 	q->backing_dev_info.state = 0;
@@ -367,10 +371,10 @@ struct request_queue *blk_alloc_queue_node(gfp_t gfp_mask, int node_id)
 
 	err = bdi_init(&q->backing_dev_info);
 	if (err)
-		goto fail_id;
+		goto fail_stats;
 
 	if (blk_throtl_init(q))
-		goto fail_id;
+		goto fail_stats;
 
 	setup_timer(&q->backing_dev_info.laptop_mode_wb_timer,
 		    laptop_mode_timer_fn, (unsigned long) q);
@@ -391,6 +395,8 @@ struct request_queue *blk_alloc_queue_node(gfp_t gfp_mask, int node_id)
 
 	return q;
 
+fail_stats:
+	free_percpu(q->lock_stats);
 fail_id:
 	ida_simple_remove(&blk_queue_ida, q->id);
 fail_q:
@@ -553,6 +559,103 @@ static void freed_request(struct request_queue *q, unsigned int flags)
 		__freed_request(q, sync ^ 1);
 }
 
+static bool blk_plug_can_batch(struct request_queue *q)
+{
+	struct elevator_type *et = q->elevator->type;
+
+	if (blk_queue_dead(q) ||
+	    test_bit(QUEUE_FLAG_ELVSWITCH, &q->queue_flags))
+		return false;
+
+	return !et->icq_cache && !et->ops.elevator_set_req_fn &&
+		!et->ops.elevator_may_queue_fn;
+}
+
+static void blk_plug_put_credits(struct blk_plug *plug)
+{
+	struct request_queue *q = plug->rq_q;
+	struct request_list *rl = &q->rq;
+	int sync;
+
+	for (sync = 0; sync < 2; sync++) {
+		if (!plug->rq_credits[sync])
+			continue;
+
+		rl->count[sync] -= plug->rq_credits[sync];
+		rl->elvpriv -= plug->rq_credits[sync];
+		plug->rq_credits[sync] = 0;
+
+		__freed_request(q, sync);
+		if (unlikely(rl->starved[sync ^ 1]))
+			__freed_request(q, sync ^ 1);
+	}
+	plug->rq_q = NULL;
+}
+
+static struct request *blk_plug_alloc_request(struct request_queue *q,
+					      int rw_flags, struct bio *bio)
+{
+	struct blk_plug *plug = current->plug;
+	const bool is_sync = rw_is_sync(rw_flags) != 0;
+	struct request *rq;
+
+	if (!plug || plug->rq_q != q || !plug->rq_credits[is_sync])
+		return NULL;
+
+	if (unlikely(blk_queue_dead(q)))
+		return NULL;
+
+	plug->rq_credits[is_sync]--;
+
+	rw_flags |= REQ_ELVPRIV;
+	if (blk_queue_io_stat(q))
+		rw_flags |= REQ_IO_STAT;
+
+	rq = blk_alloc_request(q, NULL, rw_flags, GFP_NOIO);
+	if (unlikely(!rq)) {
+		blk_lock_stat_inc(q, lock_acquisitions);
+		spin_lock_irq(q->queue_lock);
+		freed_request(q, rw_flags);
+		spin_unlock_irq(q->queue_lock);
+		return NULL;
+	}
+
+	blk_lock_stat_inc(q, plug_allocs);
+	trace_block_getrq(q, bio, rw_flags & 1);
+	return rq;
+}
+
+static struct request *blk_plug_get_request(struct request_queue *q,
+					    int rw_flags, struct bio *bio)
+{
+	struct blk_plug *plug = current->plug;
+	struct request_list *rl = &q->rq;
+	const bool is_sync = rw_is_sync(rw_flags) != 0;
+	struct request *rq;
+
+	if (!plug || (plug->rq_q && plug->rq_q != q) || !blk_plug_can_batch(q))
+		return NULL;
+
+	if (rl->count[is_sync] + BLK_PLUG_RQ_BATCH >=
+	    queue_congestion_on_threshold(q))
+		return NULL;
+
+	rl->count[is_sync] += BLK_PLUG_RQ_BATCH;
+	rl->elvpriv += BLK_PLUG_RQ_BATCH;
+	rl->starved[is_sync] = 0;
+	plug->rq_q = q;
+	plug->rq_credits[is_sync] += BLK_PLUG_RQ_BATCH;
+	spin_unlock_irq(q->queue_lock);
+
+	rq = blk_plug_alloc_request(q, rw_flags, bio);
+	if (unlikely(!rq)) {
+		blk_lock_stat_inc(q, lock_acquisitions);
+		spin_lock_irq(q->queue_lock);
+	}
+
+	return rq;
+}
+
 static bool blk_rq_should_init_elevator(struct bio *bio)
 {
 	if (!bio)
@@ -681,6 +784,7 @@ static struct request *get_request_wait(struct request_queue *q, int rw_flags,
 		create_io_context(current, GFP_NOIO, q->node);
 		ioc_set_batching(q, current->io_context);
 
+		blk_lock_stat_inc(q, lock_acquisitions);
 		spin_lock_irq(q->queue_lock);
 		finish_wait(&rl->wait[is_sync], &wait);
 
@@ -938,8 +1042,14 @@ void blk_queue_bio(struct request_queue *q, struct bio *bio)
 	unsigned int request_count = 0;
 
 	blk_queue_bounce(q, &bio);
+	blk_lock_stat_inc(q, bios);
+
+	rw_flags = bio_data_dir(bio);
+	if (sync)
+		rw_flags |= REQ_SYNC;
 
 	if (bio->bi_rw & (REQ_FLUSH | REQ_FUA)) {
+		blk_lock_stat_inc(q, lock_acquisitions);
 		spin_lock_irq(q->queue_lock);
 		where = ELEVATOR_INSERT_FLUSH;
 		goto get_rq;
@@ -948,6 +1058,11 @@ void blk_queue_bio(struct request_queue *q, struct bio *bio)
 	if (attempt_plug_merge(q, bio, &request_count))
 		return;
 
+	req = blk_plug_alloc_request(q, rw_flags, bio);
+	if (req)
+		goto init_rq;
+
+	blk_lock_stat_inc(q, lock_acquisitions);
 	spin_lock_irq(q->queue_lock);
 
 	el_ret = elv_merge(q, &req, bio);
@@ -968,16 +1083,17 @@ void blk_queue_bio(struct request_queue *q, struct bio *bio)
 	}
 
 get_rq:
-	rw_flags = bio_data_dir(bio);
-	if (sync)
-		rw_flags |= REQ_SYNC;
-
-	req = get_request_wait(q, rw_flags, bio);
+	req = NULL;
+	if (where != ELEVATOR_INSERT_FLUSH)
+		req = blk_plug_get_request(q, rw_flags, bio);
+	if (!req)
+		req = get_request_wait(q, rw_flags, bio);
 	if (unlikely(!req)) {
 		bio_endio(bio, -ENODEV);	
 		goto out_unlock;
 	}
 
+init_rq:
 	init_request_from_bio(req, bio);
 
 	if (test_bit(QUEUE_FLAG_SAME_COMP, &q->queue_flags))
@@ -992,7 +1108,8 @@ get_rq:
 				struct request *__rq;
 
 				__rq = list_entry_rq(plug->list.prev);
-				if (__rq->q != q)
+				if (__rq->q != q ||
+				    blk_rq_pos(req) < blk_rq_pos(__rq))
 					plug->should_sort = 1;
 			}
 			if (request_count >= BLK_MAX_REQUEST_COUNT) {
@@ -1003,6 +1120,7 @@ get_rq:
 		list_add_tail(&req->queuelist, &plug->list);
 		drive_stat_acct(req, 1);
 	} else {
+		blk_lock_stat_inc(q, lock_acquisitions);
 		spin_lock_irq(q->queue_lock);
 		add_acct_request(q, req, where);
 		__blk_run_queue(q);
@@ -1862,6 +1980,8 @@ void blk_start_plug(struct blk_plug *plug)
 	INIT_LIST_HEAD(&plug->list);
 	INIT_LIST_HEAD(&plug->cb_list);
 	plug->should_sort = 0;
+	plug->rq_q = NULL;
+	plug->rq_credits[0] = plug->rq_credits[1] = 0;
 
 	if (!tsk->plug) {
 		tsk->plug = plug;
@@ -1874,7 +1994,34 @@ static int plug_rq_cmp(void *priv, struct list_head *a, struct list_head *b)
 	struct request *rqa = container_of(a, struct request, queuelist);
 	struct request *rqb = container_of(b, struct request, queuelist);
 
-	return !(rqa->q <= rqb->q);
+	if (rqa->q != rqb->q)
+		return rqa->q > rqb->q;
+
+	return blk_rq_pos(rqa) > blk_rq_pos(rqb);
+}
+
+static void plug_merge_list(struct blk_plug *plug, struct list_head *list)
+{
+	struct request *rq, *next, *tmp;
+	struct request_queue *q;
+
+	rq = NULL;
+	list_for_each_entry_safe(next, tmp, list, queuelist) {
+		q = next->q;
+		if (!rq || rq->q != q || !(next->cmd_flags & REQ_ELVPRIV) ||
+		    (plug->rq_q && plug->rq_q != q) ||
+		    !blk_plug_can_batch(q) ||
+		    !blk_plug_merge_requests(q, rq, next)) {
+			rq = next;
+			continue;
+		}
+
+		list_del_init(&next->queuelist);
+		plug->rq_q = q;
+		plug->rq_credits[rw_is_sync(next->cmd_flags) != 0]++;
+		blk_free_request(q, next);
+		blk_lock_stat_inc(q, plug_merges);
+	}
 }
 
 static void queue_unplugged(struct request_queue *q, unsigned int depth,
@@ -1927,7 +2074,7 @@ void blk_flush_plug_list(struct blk_plug *plug, bool from_schedule)
 	BUG_ON(plug->magic != PLUG_MAGIC);
 
 	flush_plug_callbacks(plug);
-	if (list_empty(&plug->list))
+	if (list_empty(&plug->list) && !plug->rq_q)
 		return;
 
 	list_splice_init(&plug->list, &list);
@@ -1937,6 +2084,8 @@ void blk_flush_plug_list(struct blk_plug *plug, bool from_schedule)
 		plug->should_sort = 0;
 	}
 
+	plug_merge_list(plug, &list);
+
 	q = NULL;
 	depth = 0;
 
@@ -1950,7 +2099,10 @@ void blk_flush_plug_list(struct blk_plug *plug, bool from_schedule)
 				queue_unplugged(q, depth, from_schedule);
 			q = rq->q;
 			depth = 0;
+			blk_lock_stat_inc(q, lock_acquisitions);
 			spin_lock(q->queue_lock);
+			if (plug->rq_q == q)
+				blk_plug_put_credits(plug);
 		}
 
 		if (unlikely(blk_queue_dead(q))) {
@@ -1969,6 +2121,14 @@ void blk_flush_plug_list(struct blk_plug *plug, bool from_schedule)
 	if (q)
 		queue_unplugged(q, depth, from_schedule);
 
+	if (plug->rq_q) {
+		q = plug->rq_q;
+		blk_lock_stat_inc(q, lock_acquisitions);
+		spin_lock(q->queue_lock);
+		blk_plug_put_credits(plug);
+		spin_unlock(q->queue_lock);
+	}
+
 	local_irq_restore(flags);
 }
 
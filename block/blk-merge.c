@@ -307,8 +307,8 @@ static void blk_account_io_merge(struct request *req)
 	}
 }
 
-static int attempt_merge(struct request_queue *q, struct request *req,
-			  struct request *next)
+static int rq_can_merge(struct request_queue *q, struct request *req,
+			struct request *next)
 {
 	if (!rq_mergeable(req) || !rq_mergeable(next))
 		return 0;
@@ -330,9 +330,11 @@ static int attempt_merge(struct request_queue *q, struct request *req,
 	    || next->special)
 		return 0;
 
-	if (!ll_merge_requests_fn(q, req, next))
-		return 0;
+	return ll_merge_requests_fn(q, req, next);
+}
 
+static void rq_merge_bios(struct request *req, struct request *next)
+{
 	if ((req->cmd_flags | next->cmd_flags) & REQ_MIXED_MERGE ||
 	    (req->cmd_flags & REQ_FAILFAST_MASK) !=
 	    (next->cmd_flags & REQ_FAILFAST_MASK)) {
@@ -347,6 +349,15 @@ static int attempt_merge(struct request_queue *q, struct request *req,
 	req->biotail = next->biotail;
 
 	req->__data_len += blk_rq_bytes(next);
+}
+
+static int attempt_merge(struct request_queue *q, struct request *req,
+			  struct request *next)
+{
+	if (!rq_can_merge(q, req, next))
+		return 0;
+
+	rq_merge_bios(req, next);
 
 	elv_merge_requests(q, req, next);
 
@@ -362,6 +373,24 @@ static int attempt_merge(struct request_queue *q, struct request *req,
 	return 1;
 }
 
+int blk_plug_merge_requests(struct request_queue *q, struct request *req,
+			    struct request *next)
+{
+	if (!rq_can_merge(q, req, next))
+		return 0;
+
+	rq_merge_bios(req, next);
+
+	blk_account_io_merge(next);
+
+	req->ioprio = ioprio_best(req->ioprio, next->ioprio);
+	if (blk_rq_cpu_valid(next))
+		req->cpu = next->cpu;
+
+	next->bio = NULL;
+	return 1;
+}
+
 int attempt_back_merge(struct request_queue *q, struct request *rq)
 {
 	struct request *next = elv_latter_request(q, rq);
@@ -270,6 +270,24 @@ queue_rq_affinity_store(struct request_queue *q, const char *page, size_t count)
 	return ret;
 }
 
+static ssize_t queue_lock_stats_show(struct request_queue *q, char *page)
+{
+	struct blk_queue_lock_stats sum = { 0 };
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct blk_queue_lock_stats *st = per_cpu_ptr(q->lock_stats, cpu);
+
+		sum.bios += st->bios;
+		sum.lock_acquisitions += st->lock_acquisitions;
+		sum.plug_allocs += st->plug_allocs;
+		sum.plug_merges += st->plug_merges;
+	}
+
+	return sprintf(page, "%lu %lu %lu %lu\n", sum.bios,
+		       sum.lock_acquisitions, sum.plug_allocs, sum.plug_merges);
+}
+
 static struct queue_sysfs_entry queue_requests_entry = {
 	.attr = {.name = "nr_requests", .mode = S_IRUGO | S_IWUSR },
 	.show = queue_requests_show,
@@ -384,6 +402,11 @@ static struct queue_sysfs_entry queue_random_entry = {
 	.store = queue_store_random,
 };
 
+static struct queue_sysfs_entry queue_lock_stats_entry = {
+	.attr = {.name = "lock_stats", .mode = S_IRUGO },
+	.show = queue_lock_stats_show,
+};
+
 static struct attribute *default_attrs[] = {
 	&queue_requests_entry.attr,
 	&queue_ra_entry.attr,
@@ -406,6 +429,7 @@ static struct attribute *default_attrs[] = {
 	&queue_rq_affinity_entry.attr,
 	&queue_iostats_entry.attr,
 	&queue_random_entry.attr,
+	&queue_lock_stats_entry.attr,
 	NULL,
 };
 
@@ -481,6 +505,7 @@ static void blk_release_queue(struct kobject *kobj)
 
 	bdi_destroy(&q->backing_dev_info);
 
+	free_percpu(q->lock_stats);
 	ida_simple_remove(&blk_queue_ida, q->id);
 	kmem_cache_free(blk_requestq_cachep, q);
 }
@@ -27,6 +27,11 @@ void __blk_queue_free_tags(struct request_queue *q);
 bool __blk_end_bidi_request(struct request *rq, int error,
 			    unsigned int nr_bytes, unsigned int bidi_bytes);
 
+int blk_plug_merge_requests(struct request_queue *q, struct request *req,
+			    struct request *next);
+
+#define blk_lock_stat_inc(q, field)	this_cpu_inc((q)->lock_stats->field)
+
 void blk_rq_timed_out_timer(unsigned long data);
 void blk_delete_timer(struct request *);
 void blk_add_timer(struct request *);
@@ -0,0 +1,473 @@
+/*
+ * acompd: asynchronous compression on a pool of per-CPU workers
+ *
+ * "acompd(alg)" runs a synchronous compression algorithm @alg, such as lzo
+ * or deflate, behind the asynchronous compression interface.  Every CPU
+ * has a queue, a work item and its own instance of @alg with scratch
+ * buffers, shared by all transforms of the template instance.  A single
+ * request is queued on the submitting CPU, a batch is spread over all
+ * online CPUs, so that the pages of one large write are compressed in
+ * parallel and concurrent submitters do not serialize on one compressor.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ */
+
+#include <crypto/internal/acompress.h>
+#include <crypto/scatterwalk.h>
+#include <linux/cpumask.h>
+#include <linux/err.h>
+#include <linux/highmem.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/list.h>
+#include <linux/lzo.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/percpu.h>
+#include <linux/scatterlist.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/vmalloc.h>
+#include <linux/workqueue.h>
+
+/* Largest input and decompressed output handled through the scratch buffers */
+#define ACOMPD_MAX_SIZE		65536
+
+/* LZO does not check the room it is given, size for its worst case */
+#define ACOMPD_DST_SIZE		lzo1x_worst_compress(ACOMPD_MAX_SIZE)
+
+/* Requests handled per run of a worker before it yields to other work */
+#define ACOMPD_BATCH		16
+
+struct acompd_cpu {
+	spinlock_t lock;
+	struct list_head queue;
+	struct work_struct work;
+	int cpu;
+
+	struct crypto_comp *child;
+	u8 *src_buf;
+	u8 *dst_buf;
+};
+
+struct acompd_instance_ctx {
+	struct crypto_spawn spawn;
+
+	struct mutex mutex;
+	unsigned int users;
+	struct acompd_cpu __percpu *pool;
+};
+
+struct acompd_req_ctx {
+	bool decompress;
+};
+
+static struct workqueue_struct *acompd_wq;
+
+/*
+ * Returns the first @len bytes of @sg if they are contiguous in the kernel
+ * mapping, NULL otherwise.  Data in a highmem page is mapped with
+ * kmap_atomic() and released by acompd_unmap().
+ */
+static u8 *acompd_map(struct scatterlist *sg, unsigned int len)
+{
+	struct page *page;
+
+	if (!sg || sg->length < len)
+		return NULL;
+
+	page = sg_page(sg);
+	if (!PageHighMem(page))
+		return sg_virt(sg);
+
+	if (sg->offset + len > PAGE_SIZE)
+		return NULL;
+
+	return (u8 *)kmap_atomic(page) + sg->offset;
+}
+
+static void acompd_unmap(struct scatterlist *sg, u8 *addr)
+{
+	if (PageHighMem(sg_page(sg)))
+		kunmap_atomic(addr);
+}
+
+static int acompd_run(struct acompd_cpu *pc, struct acomp_req *req)
+{
+	struct acompd_req_ctx *rctx = acomp_request_ctx(req);
+	unsigned int slen = req->slen;
+	unsigned int dlen;
+	u8 *src, *dst = NULL;
+	int err;
+
+	if (!slen || slen > ACOMPD_MAX_SIZE)
+		return -EINVAL;
+
+	src = acompd_map(req->src, slen);
+	if (!src) {
+		scatterwalk_map_and_copy(pc->src_buf, req->src, 0, slen, 0);
+		src = pc->src_buf;
+	}
+
+	/*
+	 * Decompressors check the room they are given and may write to the
+	 * destination directly, compression always goes through the scratch
+	 * buffer.
+	 */
+	dlen = req->dlen;
+	if (rctx->decompress)
+		dst = acompd_map(req->dst, dlen);
+	if (!dst) {
+		dst = pc->dst_buf;
+		if (rctx->decompress)
+			dlen = min_t(unsigned int, dlen, ACOMPD_MAX_SIZE);
+		else
+			dlen = ACOMPD_DST_SIZE;
+	}
+
+	if (rctx->decompress)
+		err = crypto_comp_decompress(pc->child, src, slen, dst, &dlen);
+	else
+		err = crypto_comp_compress(pc->child, src, slen, dst, &dlen);
+
+	if (dst != pc->dst_buf)
+		acompd_unmap(req->dst, dst);
+	if (src != pc->src_buf)
+		acompd_unmap(req->src, src);
+
+	if (err)
+		return err;
+	if (dlen > req->dlen)
+		return -ENOSPC;
+
+	if (dst == pc->dst_buf)
+		scatterwalk_map_and_copy(dst, req->dst, 0, dlen, 1);
+	req->dlen = dlen;
+
+	return 0;
+}
+
+static void acompd_worker(struct work_struct *work)
+{
+	struct acompd_cpu *pc = container_of(work, struct acompd_cpu, work);
+	struct crypto_async_request *base;
+	unsigned int n;
+	int err;
+
+	for (n = 0; n < ACOMPD_BATCH; n++) {
+		spin_lock_bh(&pc->lock);
+		if (list_empty(&pc->queue)) {
+			spin_unlock_bh(&pc->lock);
+			return;
+		}
+		base = list_first_entry(&pc->queue, struct crypto_async_request,
+					list);
+		list_del(&base->list);
+		spin_unlock_bh(&pc->lock);
+
+		err = acompd_run(pc, acomp_request_cast(base));
+
+		local_bh_disable();
+		base->complete(base, err);
+		local_bh_enable();
+	}
+
+	queue_work_on(pc->cpu, acompd_wq, &pc->work);
+}
+
+/*
+ * The queues are not bounded: the requests belong to the submitters, who
+ * are throttled by waiting for them.
+ */
+static void acompd_queue(struct acompd_cpu *pc, struct acomp_req **reqs,
+			 unsigned int num_reqs, bool decompress)
+{
+	struct acompd_req_ctx *rctx;
+	unsigned int i;
+
+	for (i = 0; i < num_reqs; i++) {
+		rctx = acomp_request_ctx(reqs[i]);
+		rctx->decompress = decompress;
+	}
+
+	spin_lock_bh(&pc->lock);
+	for (i = 0; i < num_reqs; i++)
+		list_add_tail(&reqs[i]->base.list, &pc->queue);
+	spin_unlock_bh(&pc->lock);
+
+	queue_work_on(pc->cpu, acompd_wq, &pc->work);
+}
+
+static struct acompd_instance_ctx *acompd_ictx(struct acomp_req *req)
+{
+	struct crypto_tfm *tfm = req->base.tfm;
+
+	return crypto_instance_ctx(crypto_tfm_alg_instance(tfm));
+}
+
+static int acompd_enqueue(struct acomp_req *req, bool decompress)
+{
+	struct acompd_instance_ctx *ictx = acompd_ictx(req);
+	int cpu;
+
+	cpu = get_cpu();
+	acompd_queue(per_cpu_ptr(ictx->pool, cpu), &req, 1, decompress);
+	put_cpu();
+
+	return -EINPROGRESS;
+}
+
+static int acompd_enqueue_batch(struct acomp_req **reqs,
+				unsigned int num_reqs, bool decompress)
+{
+	struct acompd_instance_ctx *ictx = acompd_ictx(reqs[0]);
+	unsigned int per_cpu, n;
+	int cpu;
+
+	cpu = get_cpu();
+	per_cpu = DIV_ROUND_UP(num_reqs, num_online_cpus());
+	while (num_reqs) {
+		n = min(per_cpu, num_reqs);
+		acompd_queue(per_cpu_ptr(ictx->pool, cpu), reqs, n,
+			     decompress);
+		reqs += n;
+		num_reqs -= n;
+
+		cpu = cpumask_next(cpu, cpu_online_mask);
+		if (cpu >= nr_cpu_ids)
+			cpu = cpumask_first(cpu_online_mask);
+	}
+	put_cpu();
+
+	return -EINPROGRESS;
+}
+
+static int acompd_compress(struct acomp_req *req)
+{
+	return acompd_enqueue(req, false);
+}
+
+static int acompd_decompress(struct acomp_req *req)
+{
+	return acompd_enqueue(req, true);
+}
+
+static int acompd_compress_batch(struct acomp_req **reqs,
+				 unsigned int num_reqs)
+{
+	return acompd_enqueue_batch(reqs, num_reqs, false);
+}
+
+static int acompd_decompress_batch(struct acomp_req **reqs,
+				   unsigned int num_reqs)
+{
+	return acompd_enqueue_batch(reqs, num_reqs, true);
+}
+
+static void acompd_stop_pool(struct acompd_instance_ctx *ictx)
+{
+	struct acompd_cpu *pc;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		pc = per_cpu_ptr(ictx->pool, cpu);
+		flush_work_sync(&pc->work);
+		BUG_ON(!list_empty(&pc->queue));
+
+		if (pc->child)
+			crypto_free_comp(pc->child);
+		vfree(pc->src_buf);
+		vfree(pc->dst_buf);
+	}
+
+	free_percpu(ictx->pool);
+	ictx->pool = NULL;
+}
+
+static int acompd_start_pool(struct acompd_instance_ctx *ictx)
+{
+	struct crypto_tfm *child;
+	struct acompd_cpu *pc;
+	int cpu;
+
+	ictx->pool = alloc_percpu(struct acompd_cpu);
+	if (!ictx->pool)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		pc = per_cpu_ptr(ictx->pool, cpu);
+		spin_lock_init(&pc->lock);
+		INIT_LIST_HEAD(&pc->queue);
+		INIT_WORK(&pc->work, acompd_worker);
+		pc->cpu = cpu;
+	}
+
+	for_each_possible_cpu(cpu) {
+		pc = per_cpu_ptr(ictx->pool, cpu);
+
+		child = crypto_spawn_tfm(&ictx->spawn, CRYPTO_ALG_TYPE_COMPRESS,
+					 CRYPTO_ALG_TYPE_MASK);
+		if (IS_ERR(child)) {
+			acompd_stop_pool(ictx);
+			return PTR_ERR(child);
+		}
+		pc->child = __crypto_comp_cast(child);
+
+		pc->src_buf = vmalloc(ACOMPD_MAX_SIZE);
+		pc->dst_buf = vmalloc(ACOMPD_DST_SIZE);
+		if (!pc->src_buf || !pc->dst_buf) {
+			acompd_stop_pool(ictx);
+			return -ENOMEM;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * The pool lives as long as there are transforms, so that an instance
+ * nobody uses does not pin the module of the algorithm it runs.
+ */
+static int acompd_init_tfm(struct crypto_tfm *tfm)
+{
+	struct crypto_instance *inst = crypto_tfm_alg_instance(tfm);
+	struct acompd_instance_ctx *ictx = crypto_instance_ctx(inst);
+	int err = 0;
+
+	mutex_lock(&ictx->mutex);
+	if (!ictx->users)
+		err = acompd_start_pool(ictx);
+	if (!err)
+		ictx->users++;
+	mutex_unlock(&ictx->mutex);
+
+	crypto_acomp_set_reqsize(__crypto_acomp_cast(tfm),
+				 sizeof(struct acompd_req_ctx));
+
+	return err;
+}
+
+static void acompd_exit_tfm(struct crypto_tfm *tfm)
+{
+	struct crypto_instance *inst = crypto_tfm_alg_instance(tfm);
+	struct acompd_instance_ctx *ictx = crypto_instance_ctx(inst);
+
+	mutex_lock(&ictx->mutex);
+	if (!--ictx->users)
+		acompd_stop_pool(ictx);
+	mutex_unlock(&ictx->mutex);
+}
+
+static int acompd_create(struct crypto_template *tmpl, struct rtattr **tb)
+{
+	struct acompd_instance_ctx *ictx;
+	struct acomp_instance *inst;
+	struct crypto_attr_type *algt;
+	struct crypto_alg *alg;
+	char *p;
+	int err;
+
+	algt = crypto_get_attr_type(tb);
+	if (IS_ERR(algt))
+		return PTR_ERR(algt);
+
+	if ((algt->type ^ CRYPTO_ALG_TYPE_ACOMPRESS) & algt->mask)
+		return -EINVAL;
+
+	alg = crypto_get_attr_alg(tb, CRYPTO_ALG_TYPE_COMPRESS,
+				  CRYPTO_ALG_TYPE_MASK);
+	if (IS_ERR(alg))
+		return PTR_ERR(alg);
+
+	p = kzalloc(acomp_instance_headroom() + sizeof(struct crypto_instance) +
+		    sizeof(*ictx), GFP_KERNEL);
+	err = -ENOMEM;
+	if (!p)
+		goto out_put_alg;
+
+	inst = (void *)p;
+	ictx = acomp_instance_ctx(inst);
+	mutex_init(&ictx->mutex);
+
+	err = -ENAMETOOLONG;
+	if (snprintf(inst->alg.base.cra_name, CRYPTO_MAX_ALG_NAME,
+		     "acompd(%s)", alg->cra_name) >= CRYPTO_MAX_ALG_NAME)
+		goto out_free_inst;
+	if (snprintf(inst->alg.base.cra_driver_name, CRYPTO_MAX_ALG_NAME,
+		     "acompd(%s)", alg->cra_driver_name) >= CRYPTO_MAX_ALG_NAME)
+		goto out_free_inst;
+
+	err = crypto_init_spawn(&ictx->spawn, alg,
+				acomp_crypto_instance(inst),
+				CRYPTO_ALG_TYPE_MASK);
+	if (err)
+		goto out_free_inst;
+
+	inst->alg.base.cra_flags = CRYPTO_ALG_ASYNC;
+	inst->alg.base.cra_priority = alg->cra_priority;
+	inst->alg.base.cra_init = acompd_init_tfm;
+	inst->alg.base.cra_exit = acompd_exit_tfm;
+
+	inst->alg.compress = acompd_compress;
+	inst->alg.decompress = acompd_decompress;
+	inst->alg.compress_batch = acompd_compress_batch;
+	inst->alg.decompress_batch = acompd_decompress_batch;
+
+	err = acomp_register_instance(tmpl, inst);
+	if (err) {
+		crypto_drop_spawn(&ictx->spawn);
+out_free_inst:
+		kfree(inst);
+	}
+
+out_put_alg:
+	crypto_mod_put(alg);
+	return err;
+}
+
+static void acompd_free(struct crypto_instance *inst)
+{
+	struct acompd_instance_ctx *ictx = crypto_instance_ctx(inst);
+
+	crypto_drop_spawn(&ictx->spawn);
+	kfree(acomp_instance(inst));
+}
+
+static struct crypto_template acompd_tmpl = {
+	.name = "acompd",
+	.create = acompd_create,
+	.free = acompd_free,
+	.module = THIS_MODULE,
+};
+
+static int __init acompd_init(void)
+{
+	int err;
+
+	acompd_wq = alloc_workqueue("acompd",
+				    WQ_MEM_RECLAIM | WQ_CPU_INTENSIVE, 0);
+	if (!acompd_wq)
+		return -ENOMEM;
+
+	err = crypto_register_template(&acompd_tmpl);
+	if (err)
+		destroy_workqueue(acompd_wq);
+
+	return err;
+}
+
+static void __exit acompd_exit(void)
+{
+	crypto_unregister_template(&acompd_tmpl);
+	destroy_workqueue(acompd_wq);
+}
+
+module_init(acompd_init);
+module_exit(acompd_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Asynchronous compression on per-CPU workers");
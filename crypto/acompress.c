@@ -0,0 +1,180 @@
+/*
+ * Asynchronous compression type
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ */
+
+#include <linux/crypto.h>
+#include <linux/errno.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/seq_file.h>
+#include <linux/string.h>
+#include <linux/cryptouser.h>
+#include <net/netlink.h>
+
+#include <crypto/internal/acompress.h>
+
+#include "internal.h"
+
+/*
+ * Requests that finish synchronously, or that are turned away, are
+ * completed here so that a batch always reports through the callbacks.
+ */
+static int acomp_batch(struct acomp_req **reqs, unsigned int num_reqs,
+		       int (*op)(struct acomp_req *req))
+{
+	struct acomp_req *req;
+	unsigned int i;
+	u32 flags;
+	int err;
+
+	for (i = 0; i < num_reqs; i++) {
+		req = reqs[i];
+		flags = req->base.flags;
+		err = op(req);
+		if (err == -EINPROGRESS ||
+		    (err == -EBUSY && (flags & CRYPTO_TFM_REQ_MAY_BACKLOG)))
+			continue;
+		req->base.complete(&req->base, err);
+	}
+
+	return -EINPROGRESS;
+}
+
+static int acomp_def_compress_batch(struct acomp_req **reqs,
+				    unsigned int num_reqs)
+{
+	return acomp_batch(reqs, num_reqs,
+			   crypto_acomp_reqtfm(reqs[0])->compress);
+}
+
+static int acomp_def_decompress_batch(struct acomp_req **reqs,
+				      unsigned int num_reqs)
+{
+	return acomp_batch(reqs, num_reqs,
+			   crypto_acomp_reqtfm(reqs[0])->decompress);
+}
+
+static int crypto_acomp_init_tfm(struct crypto_tfm *tfm)
+{
+	struct crypto_acomp *acomp = __crypto_acomp_cast(tfm);
+	struct acomp_alg *alg = crypto_acomp_alg(acomp);
+
+	acomp->compress = alg->compress;
+	acomp->decompress = alg->decompress;
+	acomp->compress_batch = alg->compress_batch ?:
+				acomp_def_compress_batch;
+	acomp->decompress_batch = alg->decompress_batch ?:
+				  acomp_def_decompress_batch;
+	acomp->reqsize = 0;
+
+	return 0;
+}
+
+static unsigned int crypto_acomp_extsize(struct crypto_alg *alg)
+{
+	return alg->cra_ctxsize;
+}
+
+#ifdef CONFIG_NET
+static int crypto_acomp_report(struct sk_buff *skb, struct crypto_alg *alg)
+{
+	struct crypto_report_comp racomp;
+
+	snprintf(racomp.type, CRYPTO_MAX_ALG_NAME, "%s", "acomp");
+
+	NLA_PUT(skb, CRYPTOCFGA_REPORT_COMPRESS,
+		sizeof(struct crypto_report_comp), &racomp);
+
+	return 0;
+
+nla_put_failure:
+	return -EMSGSIZE;
+}
+#else
+static int crypto_acomp_report(struct sk_buff *skb, struct crypto_alg *alg)
+{
+	return -ENOSYS;
+}
+#endif
+
+static void crypto_acomp_show(struct seq_file *m, struct crypto_alg *alg)
+	__attribute__ ((unused));
+static void crypto_acomp_show(struct seq_file *m, struct crypto_alg *alg)
+{
+	seq_printf(m, "type         : acomp\n");
+	seq_printf(m, "async        : %s\n", alg->cra_flags & CRYPTO_ALG_ASYNC ?
+					     "yes" : "no");
+}
+
+const struct crypto_type crypto_acomp_type = {
+	.extsize = crypto_acomp_extsize,
+	.init_tfm = crypto_acomp_init_tfm,
+#ifdef CONFIG_PROC_FS
+	.show = crypto_acomp_show,
+#endif
+	.report = crypto_acomp_report,
+	.maskclear = ~CRYPTO_ALG_TYPE_MASK,
+	.maskset = CRYPTO_ALG_TYPE_MASK,
+	.type = CRYPTO_ALG_TYPE_ACOMPRESS,
+	.tfmsize = offsetof(struct crypto_acomp, base),
+};
+EXPORT_SYMBOL_GPL(crypto_acomp_type);
+
+struct crypto_acomp *crypto_alloc_acomp(const char *alg_name, u32 type,
+					u32 mask)
+{
+	char name[CRYPTO_MAX_ALG_NAME];
+	struct crypto_acomp *tfm;
+
+	tfm = crypto_alloc_tfm(alg_name, &crypto_acomp_type, type, mask);
+	if (!IS_ERR(tfm) || PTR_ERR(tfm) != -ENOENT)
+		return tfm;
+
+	if (snprintf(name, CRYPTO_MAX_ALG_NAME, "acompd(%s)", alg_name) >=
+	    CRYPTO_MAX_ALG_NAME)
+		return ERR_PTR(-ENAMETOOLONG);
+
+	return crypto_alloc_tfm(name, &crypto_acomp_type, type, mask);
+}
+EXPORT_SYMBOL_GPL(crypto_alloc_acomp);
+
+static void acomp_prepare_alg(struct acomp_alg *alg)
+{
+	struct crypto_alg *base = &alg->base;
+
+	base->cra_type = &crypto_acomp_type;
+	base->cra_flags &= ~CRYPTO_ALG_TYPE_MASK;
+	base->cra_flags |= CRYPTO_ALG_TYPE_ACOMPRESS;
+}
+
+int crypto_register_acomp(struct acomp_alg *alg)
+{
+	acomp_prepare_alg(alg);
+
+	return crypto_register_alg(&alg->base);
+}
+EXPORT_SYMBOL_GPL(crypto_register_acomp);
+
+int crypto_unregister_acomp(struct acomp_alg *alg)
+{
+	return crypto_unregister_alg(&alg->base);
+}
+EXPORT_SYMBOL_GPL(crypto_unregister_acomp);
+
+int acomp_register_instance(struct crypto_template *tmpl,
+			    struct acomp_instance *inst)
+{
+	acomp_prepare_alg(&inst->alg);
+
+	return crypto_register_instance(tmpl, acomp_crypto_instance(inst));
+}
+EXPORT_SYMBOL_GPL(acomp_register_instance);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Asynchronous compression type");
@@ -365,7 +365,8 @@ int af_alg_make_sg(struct af_alg_sgl *sgl, void __user *addr, int len,
 
 	err = 0;
 
-	sg_init_table(sgl->sg, npages);
+	/* The spare entry is where af_alg_link_sg() chains the next list */
+	sg_init_table(sgl->sg, npages + 1);
 
 	for (i = 0; i < npages; i++) {
 		int plen = min_t(int, len, PAGE_SIZE - off);
@@ -377,6 +378,9 @@ int af_alg_make_sg(struct af_alg_sgl *sgl, void __user *addr, int len,
 		err += plen;
 	}
 
+	sg_mark_end(sgl->sg + npages - 1);
+	sgl->npages = npages;
+
 out:
 	return err;
 }
@@ -386,13 +390,23 @@ void af_alg_free_sg(struct af_alg_sgl *sgl)
 {
 	int i;
 
-	i = 0;
-	do {
+	for (i = 0; i < sgl->npages; i++)
 		put_page(sgl->pages[i]);
-	} while (!sg_is_last(sgl->sg + (i++)));
+	sgl->npages = 0;
 }
 EXPORT_SYMBOL_GPL(af_alg_free_sg);
 
+/*
+ * Append @sgl_new to @sgl_prev, so that pages pinned by several calls to
+ * af_alg_make_sg() go to the algorithm as one request.
+ */
+void af_alg_link_sg(struct af_alg_sgl *sgl_prev, struct af_alg_sgl *sgl_new)
+{
+	sg_unmark_end(sgl_prev->sg + sgl_prev->npages - 1);
+	sg_chain(sgl_prev->sg, sgl_prev->npages + 1, sgl_new->sg);
+}
+EXPORT_SYMBOL_GPL(af_alg_link_sg);
+
 int af_alg_cmsg_send(struct msghdr *msg, struct af_alg_control *con)
 {
 	struct cmsghdr *cmsg;
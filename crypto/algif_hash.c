@@ -22,7 +22,9 @@
 #include <net/sock.h>
 
 struct hash_ctx {
-	struct af_alg_sgl sgl;
+	struct af_alg_sgl sgl[ALG_MAX_SGLS];
+	unsigned int nsgl;
+	unsigned int pending;
 
 	u8 *result;
 
@@ -34,6 +36,44 @@ struct hash_ctx {
 	struct ahash_request req;
 };
 
+static void hash_free_sgl(struct hash_ctx *ctx)
+{
+	int i;
+
+	for (i = 0; i < ctx->nsgl; i++)
+		af_alg_free_sg(&ctx->sgl[i]);
+
+	ctx->nsgl = 0;
+	ctx->pending = 0;
+}
+
+/*
+ * Hash the pages collected in ctx->sgl, finishing the hash if @final, as
+ * one request.
+ */
+static int hash_flush(struct hash_ctx *ctx, bool final)
+{
+	struct scatterlist *sg = ctx->nsgl ? ctx->sgl[0].sg : NULL;
+	int err;
+
+	if (!final && !ctx->pending)
+		return 0;
+
+	ahash_request_set_crypt(&ctx->req, sg, ctx->result, ctx->pending);
+
+	if (!final)
+		err = crypto_ahash_update(&ctx->req);
+	else if (ctx->pending)
+		err = crypto_ahash_finup(&ctx->req);
+	else
+		err = crypto_ahash_final(&ctx->req);
+
+	err = af_alg_wait_for_completion(err, &ctx->completion);
+	hash_free_sgl(ctx);
+
+	return err;
+}
+
 static int hash_sendmsg(struct kiocb *unused, struct socket *sock,
 			struct msghdr *msg, size_t ignored)
 {
@@ -54,10 +94,18 @@ static int hash_sendmsg(struct kiocb *unused, struct socket *sock,
 		err = crypto_ahash_init(&ctx->req);
 		if (err)
 			goto unlock;
+	} else {
+		err = hash_flush(ctx, false);
+		if (err)
+			goto unlock;
 	}
 
 	ctx->more = 0;
 
+	/*
+	 * Pinned user pages are hashed before returning, but up to
+	 * ALG_MAX_SGLS of them, across iovecs, go in one update.
+	 */
 	for (iov = msg->msg_iov, iovlen = msg->msg_iovlen; iovlen > 0;
 	     iovlen--, iov++) {
 		unsigned long seglen = iov->iov_len;
@@ -65,25 +113,26 @@ static int hash_sendmsg(struct kiocb *unused, struct socket *sock,
 
 		while (seglen) {
 			int len = min_t(unsigned long, seglen, limit);
+			struct af_alg_sgl *sgl;
 			int newlen;
 
-			newlen = af_alg_make_sg(&ctx->sgl, from, len, 0);
+			if (ctx->nsgl == ALG_MAX_SGLS) {
+				err = hash_flush(ctx, false);
+				if (err)
+					goto unlock;
+			}
+
+			sgl = &ctx->sgl[ctx->nsgl];
+			newlen = af_alg_make_sg(sgl, from, len, 0);
 			if (newlen < 0) {
-				err = copied ? 0 : newlen;
+				err = copied ? hash_flush(ctx, false) : newlen;
 				goto unlock;
 			}
 
-			ahash_request_set_crypt(&ctx->req, ctx->sgl.sg, NULL,
-						newlen);
-
-			err = af_alg_wait_for_completion(
-				crypto_ahash_update(&ctx->req),
-				&ctx->completion);
-
-			af_alg_free_sg(&ctx->sgl);
-
-			if (err)
-				goto unlock;
+			if (ctx->nsgl)
+				af_alg_link_sg(sgl - 1, sgl);
+			ctx->nsgl++;
+			ctx->pending += newlen;
 
 			seglen -= newlen;
 			from += newlen;
@@ -91,57 +140,73 @@ static int hash_sendmsg(struct kiocb *unused, struct socket *sock,
 		}
 	}
 
-	err = 0;
-
 	ctx->more = msg->msg_flags & MSG_MORE;
-	if (!ctx->more) {
-		ahash_request_set_crypt(&ctx->req, NULL, ctx->result, 0);
-		err = af_alg_wait_for_completion(crypto_ahash_final(&ctx->req),
-						 &ctx->completion);
-	}
+	err = hash_flush(ctx, !ctx->more);
 
 unlock:
+	hash_free_sgl(ctx);
 	release_sock(sk);
 
 	return err ?: copied;
 }
 
+/*
+ * Pages spliced in with more to follow are only collected, and hashed
+ * ALG_MAX_SGLS * ALG_MAX_PAGES at a time, like skcipher_sendpage() which
+ * also holds on to them until they are processed.
+ */
 static ssize_t hash_sendpage(struct socket *sock, struct page *page,
 			     int offset, size_t size, int flags)
 {
 	struct sock *sk = sock->sk;
 	struct alg_sock *ask = alg_sk(sk);
 	struct hash_ctx *ctx = ask->private;
+	struct af_alg_sgl *sgl;
 	int err;
 
 	lock_sock(sk);
-	sg_init_table(ctx->sgl.sg, 1);
-	sg_set_page(ctx->sgl.sg, page, size, offset);
-
-	ahash_request_set_crypt(&ctx->req, ctx->sgl.sg, ctx->result, size);
+	if (!ctx->more) {
+		err = crypto_ahash_init(&ctx->req);
+		if (err)
+			goto unlock;
+	}
 
-	if (!(flags & MSG_MORE)) {
-		if (ctx->more)
-			err = crypto_ahash_finup(&ctx->req);
-		else
-			err = crypto_ahash_digest(&ctx->req);
-	} else {
-		if (!ctx->more) {
-			err = crypto_ahash_init(&ctx->req);
+	sgl = ctx->nsgl ? &ctx->sgl[ctx->nsgl - 1] : NULL;
+	if (!sgl || sgl->npages == ALG_MAX_PAGES) {
+		if (ctx->nsgl == ALG_MAX_SGLS) {
+			err = hash_flush(ctx, false);
 			if (err)
 				goto unlock;
 		}
 
-		err = crypto_ahash_update(&ctx->req);
+		sgl = &ctx->sgl[ctx->nsgl];
+		sg_init_table(sgl->sg, ALG_MAX_PAGES + 1);
+		sgl->npages = 0;
+		if (ctx->nsgl)
+			af_alg_link_sg(sgl - 1, sgl);
+		ctx->nsgl++;
+	} else {
+		sg_unmark_end(sgl->sg + sgl->npages - 1);
 	}
 
-	err = af_alg_wait_for_completion(err, &ctx->completion);
+	get_page(page);
+	sgl->pages[sgl->npages] = page;
+	sg_set_page(sgl->sg + sgl->npages, page, size, offset);
+	sg_mark_end(sgl->sg + sgl->npages);
+	sgl->npages++;
+	ctx->pending += size;
+
+	err = 0;
+	if (!(flags & MSG_MORE))
+		err = hash_flush(ctx, true);
 	if (err)
 		goto unlock;
 
 	ctx->more = flags & MSG_MORE;
 
 unlock:
+	if (err)
+		hash_free_sgl(ctx);
 	release_sock(sk);
 
 	return err ?: size;
@@ -164,9 +229,7 @@ static int hash_recvmsg(struct kiocb *unused, struct socket *sock,
 	lock_sock(sk);
 	if (ctx->more) {
 		ctx->more = 0;
-		ahash_request_set_crypt(&ctx->req, NULL, ctx->result, 0);
-		err = af_alg_wait_for_completion(crypto_ahash_final(&ctx->req),
-						 &ctx->completion);
+		err = hash_flush(ctx, true);
 		if (err)
 			goto unlock;
 	}
@@ -191,7 +254,11 @@ static int hash_accept(struct socket *sock, struct socket *newsock, int flags)
 	struct hash_ctx *ctx2;
 	int err;
 
-	err = crypto_ahash_export(req, state);
+	lock_sock(sk);
+	err = hash_flush(ctx, false);
+	if (!err)
+		err = crypto_ahash_export(req, state);
+	release_sock(sk);
 	if (err)
 		return err;
 
@@ -255,6 +322,7 @@ static void hash_sock_destruct(struct sock *sk)
 	struct alg_sock *ask = alg_sk(sk);
 	struct hash_ctx *ctx = ask->private;
 
+	hash_free_sgl(ctx);
 	sock_kfree_s(sk, ctx->result,
 		     crypto_ahash_digestsize(crypto_ahash_reqtfm(&ctx->req)));
 	sock_kfree_s(sk, ctx, ctx->len);
@@ -281,6 +349,8 @@ static int hash_accept_parent(void *private, struct sock *sk)
 	memset(ctx->result, 0, ds);
 
 	ctx->len = len;
+	ctx->nsgl = 0;
+	ctx->pending = 0;
 	ctx->more = 0;
 	af_alg_init_completion(&ctx->completion);
 
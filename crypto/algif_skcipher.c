@@ -33,7 +33,7 @@ struct skcipher_sg_list {
 
 struct skcipher_ctx {
 	struct list_head tsgl;
-	struct af_alg_sgl rsgl;
+	struct af_alg_sgl rsgl[ALG_MAX_SGLS];
 
 	void *iv;
 
@@ -415,6 +415,50 @@ unlock:
 	return err ?: size;
 }
 
+/*
+ * Pin the user buffer at @off into @iov onwards, as far as there is data
+ * queued and across iovec boundaries, into the chained ctx->rsgl lists.
+ */
+static int skcipher_make_rsgl(struct skcipher_ctx *ctx, struct iovec *iov,
+			      unsigned long iovlen, unsigned long off,
+			      int *nsgl)
+{
+	int used = 0;
+	int n = 0;
+	int err;
+
+	while (iovlen && used < ctx->used && n < ALG_MAX_SGLS) {
+		unsigned long seglen = iov->iov_len - off;
+		char __user *from = iov->iov_base;
+
+		if (!seglen) {
+			iov++;
+			iovlen--;
+			off = 0;
+			continue;
+		}
+
+		err = af_alg_make_sg(&ctx->rsgl[n], from + off,
+				     min_t(unsigned long, seglen,
+					   ctx->used - used), 1);
+		if (err < 0) {
+			if (!n)
+				return err;
+			break;
+		}
+
+		if (n)
+			af_alg_link_sg(&ctx->rsgl[n - 1], &ctx->rsgl[n]);
+
+		n++;
+		used += err;
+		off += err;
+	}
+
+	*nsgl = n;
+	return used;
+}
+
 static int skcipher_recvmsg(struct kiocb *unused, struct socket *sock,
 			    struct msghdr *msg, size_t ignored, int flags)
 {
@@ -426,66 +470,83 @@ static int skcipher_recvmsg(struct kiocb *unused, struct socket *sock,
 	struct skcipher_sg_list *sgl;
 	struct scatterlist *sg;
 	unsigned long iovlen;
+	unsigned long off;
 	struct iovec *iov;
 	int err = -EAGAIN;
 	int used;
+	int nsgl;
+	int i;
 	long copied = 0;
 
 	lock_sock(sk);
-	for (iov = msg->msg_iov, iovlen = msg->msg_iovlen; iovlen > 0;
-	     iovlen--, iov++) {
-		unsigned long seglen = iov->iov_len;
-		char __user *from = iov->iov_base;
-
-		while (seglen) {
-			sgl = list_first_entry(&ctx->tsgl,
-					       struct skcipher_sg_list, list);
-			sg = sgl->sg;
+	for (iov = msg->msg_iov, iovlen = msg->msg_iovlen, off = 0;
+	     iovlen > 0;) {
+		if (off == iov->iov_len) {
+			iov++;
+			iovlen--;
+			off = 0;
+			continue;
+		}
 
-			while (!sg->length)
-				sg++;
+		if (!ctx->used) {
+			err = skcipher_wait_for_data(sk, flags);
+			if (err)
+				goto unlock;
+		}
 
-			used = ctx->used;
-			if (!used) {
-				err = skcipher_wait_for_data(sk, flags);
-				if (err)
-					goto unlock;
-			}
+		sgl = list_first_entry(&ctx->tsgl, struct skcipher_sg_list,
+				       list);
+		sg = sgl->sg;
 
-			used = min_t(unsigned long, used, seglen);
+		while (!sg->length)
+			sg++;
 
-			used = af_alg_make_sg(&ctx->rsgl, from, used, 1);
-			err = used;
-			if (err < 0)
-				goto unlock;
+		/*
+		 * One request covers all the queued data that fits the
+		 * iovec, rather than one per iovec and ALG_MAX_PAGES.
+		 */
+		used = skcipher_make_rsgl(ctx, iov, iovlen, off, &nsgl);
+		err = used;
+		if (err < 0)
+			goto unlock;
 
-			if (ctx->more || used < ctx->used)
-				used -= used % bs;
+		if (ctx->more || used < ctx->used)
+			used -= used % bs;
 
-			err = -EINVAL;
-			if (!used)
-				goto free;
+		err = -EINVAL;
+		if (!used)
+			goto free;
 
-			ablkcipher_request_set_crypt(&ctx->req, sg,
-						     ctx->rsgl.sg, used,
-						     ctx->iv);
+		ablkcipher_request_set_crypt(&ctx->req, sg, ctx->rsgl[0].sg,
+					     used, ctx->iv);
 
-			err = af_alg_wait_for_completion(
-				ctx->enc ?
-					crypto_ablkcipher_encrypt(&ctx->req) :
-					crypto_ablkcipher_decrypt(&ctx->req),
-				&ctx->completion);
+		err = af_alg_wait_for_completion(
+			ctx->enc ?
+				crypto_ablkcipher_encrypt(&ctx->req) :
+				crypto_ablkcipher_decrypt(&ctx->req),
+			&ctx->completion);
 
 free:
-			af_alg_free_sg(&ctx->rsgl);
+		for (i = 0; i < nsgl; i++)
+			af_alg_free_sg(&ctx->rsgl[i]);
 
-			if (err)
-				goto unlock;
+		if (err)
+			goto unlock;
+
+		copied += used;
+		skcipher_pull_sgl(sk, used);
+
+		while (used) {
+			unsigned long plen = min_t(unsigned long, used,
+						   iov->iov_len - off);
 
-			copied += used;
-			from += used;
-			seglen -= used;
-			skcipher_pull_sgl(sk, used);
+			off += plen;
+			used -= plen;
+			if (off == iov->iov_len && used) {
+				iov++;
+				iovlen--;
+				off = 0;
+			}
 		}
 	}
 
@@ -44,6 +44,7 @@
 
 #define CHKSUM_BLOCK_SIZE	1
 #define CHKSUM_DIGEST_SIZE	4
+#define CHKSUM_MB_MAX_MSGS	8
 
 struct chksum_ctx {
 	u32 key;
@@ -116,6 +117,24 @@ static int chksum_digest(struct shash_desc *desc, const u8 *data,
 	return __chksum_finup(&mctx->key, data, length, out);
 }
 
+static int chksum_finup_mb(struct shash_desc *desc, const u8 * const data[],
+			   unsigned int len, u8 * const outs[],
+			   unsigned int num_msgs)
+{
+	struct chksum_desc_ctx *ctx = shash_desc_ctx(desc);
+	u32 crcs[CHKSUM_MB_MAX_MSGS];
+	unsigned int i;
+
+	for (i = 0; i < num_msgs; i++)
+		crcs[i] = ctx->crc;
+
+	__crc32c_le_mb(crcs, data, len, num_msgs);
+
+	for (i = 0; i < num_msgs; i++)
+		*(__le32 *)outs[i] = ~cpu_to_le32(crcs[i]);
+	return 0;
+}
+
 static int crc32c_cra_init(struct crypto_tfm *tfm)
 {
 	struct chksum_ctx *mctx = crypto_tfm_ctx(tfm);
@@ -132,6 +151,8 @@ static struct shash_alg alg = {
 	.final		=	chksum_final,
 	.finup		=	chksum_finup,
 	.digest		=	chksum_digest,
+	.finup_mb	=	chksum_finup_mb,
+	.mb_max_msgs	=	CHKSUM_MB_MAX_MSGS,
 	.descsize		=	sizeof(struct chksum_desc_ctx),
 	.base			=	{
 		.cra_name		=	"crc32c",
@@ -0,0 +1,476 @@
+/*
+ * dispatch: route cipher requests between a hardware engine and the CPU
+ *
+ * "dispatch(hw,sw)" wraps two implementations of the same algorithm, an
+ * asynchronous engine @hw and a synchronous software @sw, and sends every
+ * request to whichever is expected to complete it first.  The expectation
+ * comes from the latency measured for earlier requests of a similar size
+ * on each side, with the engine latency scaled by the number of requests
+ * that are already queued on it.
+ *
+ * Small requests are usually cheaper on the CPU than the descriptor setup
+ * and completion interrupt of an engine, large ones are faster on the
+ * engine, and where the cross-over lies depends on the engine and on how
+ * busy it is, which is why it is learned instead of configured.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ */
+
+#include <crypto/algapi.h>
+#include <crypto/internal/skcipher.h>
+#include <linux/debugfs.h>
+#include <linux/err.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+
+/* Request sizes are bucketed by powers of two from 64 bytes to 64KB */
+#define DISPATCH_MIN_SHIFT	6
+#define DISPATCH_BUCKETS	12
+
+/* Every Nth request of a bucket goes to the other side to re-measure it */
+#define DISPATCH_PROBE_INTERVAL	64
+
+/* Weight of a new latency sample is 1/2^DISPATCH_EWMA_SHIFT */
+#define DISPATCH_EWMA_SHIFT	3
+
+struct dispatch_bucket {
+	u32 hw_ns;
+	u32 sw_ns;
+	unsigned int seq;
+	unsigned long hw_reqs;
+	unsigned long sw_reqs;
+};
+
+struct dispatch_instance_ctx {
+	struct crypto_skcipher_spawn hw;
+	struct crypto_skcipher_spawn sw;
+
+	spinlock_t lock;
+	atomic_t inflight;
+	struct dispatch_bucket buckets[DISPATCH_BUCKETS];
+	unsigned long probes;
+	unsigned long errors;
+
+	struct dentry *dent;
+};
+
+struct dispatch_ctx {
+	struct crypto_ablkcipher *hw;
+	struct crypto_ablkcipher *sw;
+};
+
+struct dispatch_req_ctx {
+	ktime_t start;
+	unsigned int depth;
+	bool hw;
+	struct ablkcipher_request subreq;
+};
+
+static struct dentry *dispatch_debugfs;
+
+static unsigned int dispatch_bucket_idx(unsigned int nbytes)
+{
+	int idx = fls(nbytes >> DISPATCH_MIN_SHIFT);
+
+	return min(idx, DISPATCH_BUCKETS - 1);
+}
+
+static void dispatch_ewma(u32 *avg, u32 sample)
+{
+	sample = max_t(u32, sample, 1);
+	if (!*avg)
+		*avg = sample;
+	else
+		*avg = *avg - (*avg >> DISPATCH_EWMA_SHIFT) +
+		       (sample >> DISPATCH_EWMA_SHIFT);
+}
+
+/*
+ * Pick a side for a request of @nbytes.  A side that has not completed a
+ * request of this size yet is tried first, after that the engine is used
+ * while its per-request latency times the queue in front of it is no
+ * worse than the CPU latency.
+ */
+static bool dispatch_choose(struct dispatch_instance_ctx *ictx,
+			    unsigned int nbytes, unsigned int depth)
+{
+	struct dispatch_bucket *b = &ictx->buckets[dispatch_bucket_idx(nbytes)];
+	unsigned long flags;
+	bool hw;
+
+	spin_lock_irqsave(&ictx->lock, flags);
+	if (!b->hw_ns) {
+		hw = true;
+	} else if (!b->sw_ns) {
+		hw = false;
+	} else {
+		hw = (u64)b->hw_ns * (depth + 1) <= b->sw_ns;
+		if (++b->seq % DISPATCH_PROBE_INTERVAL == 0) {
+			hw = !hw;
+			ictx->probes++;
+		}
+	}
+	if (hw)
+		b->hw_reqs++;
+	else
+		b->sw_reqs++;
+	spin_unlock_irqrestore(&ictx->lock, flags);
+
+	return hw;
+}
+
+static void dispatch_account(struct dispatch_instance_ctx *ictx,
+			     struct ablkcipher_request *req, int err)
+{
+	struct dispatch_req_ctx *rctx = ablkcipher_request_ctx(req);
+	struct dispatch_bucket *b;
+	unsigned long flags;
+	s64 ns;
+
+	if (rctx->hw)
+		atomic_dec(&ictx->inflight);
+
+	ns = ktime_to_ns(ktime_sub(ktime_get(), rctx->start));
+	b = &ictx->buckets[dispatch_bucket_idx(req->nbytes)];
+
+	spin_lock_irqsave(&ictx->lock, flags);
+	if (err)
+		ictx->errors++;
+	else if (rctx->hw)
+		dispatch_ewma(&b->hw_ns, min_t(s64, div_s64(ns, rctx->depth + 1),
+					       UINT_MAX));
+	else
+		dispatch_ewma(&b->sw_ns, min_t(s64, ns, UINT_MAX));
+	spin_unlock_irqrestore(&ictx->lock, flags);
+}
+
+static struct dispatch_instance_ctx *dispatch_ictx(struct crypto_tfm *tfm)
+{
+	return crypto_instance_ctx(crypto_tfm_alg_instance(tfm));
+}
+
+static void dispatch_done(struct crypto_async_request *areq, int err)
+{
+	struct ablkcipher_request *req = areq->data;
+
+	if (err != -EINPROGRESS)
+		dispatch_account(dispatch_ictx(req->base.tfm), req, err);
+
+	ablkcipher_request_complete(req, err);
+}
+
+static int dispatch_crypt(struct ablkcipher_request *req, bool enc)
+{
+	struct crypto_ablkcipher *tfm = crypto_ablkcipher_reqtfm(req);
+	struct dispatch_instance_ctx *ictx = dispatch_ictx(&tfm->base);
+	struct dispatch_ctx *ctx = crypto_ablkcipher_ctx(tfm);
+	struct dispatch_req_ctx *rctx = ablkcipher_request_ctx(req);
+	struct ablkcipher_request *subreq = &rctx->subreq;
+	int err;
+
+	rctx->depth = atomic_read(&ictx->inflight);
+	rctx->hw = dispatch_choose(ictx, req->nbytes, rctx->depth);
+	if (rctx->hw)
+		atomic_inc(&ictx->inflight);
+
+	ablkcipher_request_set_tfm(subreq, rctx->hw ? ctx->hw : ctx->sw);
+	ablkcipher_request_set_callback(subreq, req->base.flags,
+					dispatch_done, req);
+	ablkcipher_request_set_crypt(subreq, req->src, req->dst, req->nbytes,
+				     req->info);
+
+	rctx->start = ktime_get();
+	err = enc ? crypto_ablkcipher_encrypt(subreq) :
+		    crypto_ablkcipher_decrypt(subreq);
+
+	if (err == -EINPROGRESS ||
+	    (err == -EBUSY &&
+	     (req->base.flags & CRYPTO_TFM_REQ_MAY_BACKLOG)))
+		return err;
+
+	dispatch_account(ictx, req, err);
+	return err;
+}
+
+static int dispatch_encrypt(struct ablkcipher_request *req)
+{
+	return dispatch_crypt(req, true);
+}
+
+static int dispatch_decrypt(struct ablkcipher_request *req)
+{
+	return dispatch_crypt(req, false);
+}
+
+static int dispatch_setkey(struct crypto_ablkcipher *parent, const u8 *key,
+			   unsigned int keylen)
+{
+	struct dispatch_ctx *ctx = crypto_ablkcipher_ctx(parent);
+	struct crypto_ablkcipher *children[] = { ctx->hw, ctx->sw };
+	int i, err = 0;
+
+	for (i = 0; i < ARRAY_SIZE(children) && !err; i++) {
+		struct crypto_ablkcipher *child = children[i];
+
+		crypto_ablkcipher_clear_flags(child, CRYPTO_TFM_REQ_MASK);
+		crypto_ablkcipher_set_flags(child,
+					    crypto_ablkcipher_get_flags(parent) &
+					    CRYPTO_TFM_REQ_MASK);
+		err = crypto_ablkcipher_setkey(child, key, keylen);
+		crypto_ablkcipher_set_flags(parent,
+					    crypto_ablkcipher_get_flags(child) &
+					    CRYPTO_TFM_RES_MASK);
+	}
+
+	return err;
+}
+
+static int dispatch_init_tfm(struct crypto_tfm *tfm)
+{
+	struct dispatch_instance_ctx *ictx = dispatch_ictx(tfm);
+	struct dispatch_ctx *ctx = crypto_tfm_ctx(tfm);
+	struct crypto_ablkcipher *hw;
+	struct crypto_ablkcipher *sw;
+
+	hw = crypto_spawn_skcipher(&ictx->hw);
+	if (IS_ERR(hw))
+		return PTR_ERR(hw);
+
+	sw = crypto_spawn_skcipher(&ictx->sw);
+	if (IS_ERR(sw)) {
+		crypto_free_ablkcipher(hw);
+		return PTR_ERR(sw);
+	}
+
+	ctx->hw = hw;
+	ctx->sw = sw;
+	tfm->crt_ablkcipher.reqsize = sizeof(struct dispatch_req_ctx) +
+		max(crypto_ablkcipher_reqsize(hw),
+		    crypto_ablkcipher_reqsize(sw));
+
+	return 0;
+}
+
+static void dispatch_exit_tfm(struct crypto_tfm *tfm)
+{
+	struct dispatch_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	crypto_free_ablkcipher(ctx->hw);
+	crypto_free_ablkcipher(ctx->sw);
+}
+
+static int dispatch_stats_show(struct seq_file *m, void *v)
+{
+	struct dispatch_instance_ctx *ictx = m->private;
+	struct dispatch_bucket buckets[DISPATCH_BUCKETS];
+	unsigned long probes, errors;
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&ictx->lock, flags);
+	memcpy(buckets, ictx->buckets, sizeof(buckets));
+	probes = ictx->probes;
+	errors = ictx->errors;
+	spin_unlock_irqrestore(&ictx->lock, flags);
+
+	seq_printf(m, "inflight: %d\nprobes: %lu\nerrors: %lu\n",
+		   atomic_read(&ictx->inflight), probes, errors);
+	seq_printf(m, "%8s %12s %12s %10s %10s\n",
+		   "size", "hw_reqs", "sw_reqs", "hw_ns", "sw_ns");
+	for (i = 0; i < DISPATCH_BUCKETS; i++) {
+		if (i < DISPATCH_BUCKETS - 1)
+			seq_printf(m, "<%7u", 1U << (DISPATCH_MIN_SHIFT + i));
+		else
+			seq_printf(m, ">=%6u", 1U << (DISPATCH_MIN_SHIFT + i - 1));
+		seq_printf(m, " %12lu %12lu %10u %10u\n",
+			   buckets[i].hw_reqs, buckets[i].sw_reqs,
+			   buckets[i].hw_ns, buckets[i].sw_ns);
+	}
+
+	return 0;
+}
+
+static int dispatch_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, dispatch_stats_show, inode->i_private);
+}
+
+static const struct file_operations dispatch_stats_fops = {
+	.open		= dispatch_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void dispatch_alg_sizes(struct crypto_alg *alg, unsigned int *min,
+			       unsigned int *max, unsigned int *ivsize)
+{
+	if ((alg->cra_flags & CRYPTO_ALG_TYPE_MASK) ==
+	    CRYPTO_ALG_TYPE_BLKCIPHER) {
+		*min = alg->cra_blkcipher.min_keysize;
+		*max = alg->cra_blkcipher.max_keysize;
+		*ivsize = alg->cra_blkcipher.ivsize;
+	} else {
+		*min = alg->cra_ablkcipher.min_keysize;
+		*max = alg->cra_ablkcipher.max_keysize;
+		*ivsize = alg->cra_ablkcipher.ivsize;
+	}
+}
+
+static struct crypto_instance *dispatch_alloc(struct rtattr **tb)
+{
+	struct crypto_attr_type *algt;
+	struct dispatch_instance_ctx *ictx;
+	struct crypto_instance *inst;
+	struct crypto_alg *hw, *sw;
+	unsigned int hw_min, hw_max, hw_iv;
+	unsigned int sw_min, sw_max, sw_iv;
+	const char *hw_name, *sw_name;
+	int err;
+
+	algt = crypto_get_attr_type(tb);
+	if (IS_ERR(algt))
+		return ERR_CAST(algt);
+
+	if ((algt->type ^ CRYPTO_ALG_TYPE_ABLKCIPHER) & algt->mask)
+		return ERR_PTR(-EINVAL);
+
+	hw_name = crypto_attr_alg_name(tb[1]);
+	if (IS_ERR(hw_name))
+		return ERR_CAST(hw_name);
+
+	sw_name = crypto_attr_alg_name(tb[2]);
+	if (IS_ERR(sw_name))
+		return ERR_CAST(sw_name);
+
+	inst = kzalloc(sizeof(*inst) + sizeof(*ictx), GFP_KERNEL);
+	if (!inst)
+		return ERR_PTR(-ENOMEM);
+
+	ictx = crypto_instance_ctx(inst);
+	spin_lock_init(&ictx->lock);
+	atomic_set(&ictx->inflight, 0);
+
+	crypto_set_skcipher_spawn(&ictx->hw, inst);
+	err = crypto_grab_skcipher(&ictx->hw, hw_name, 0, 0);
+	if (err)
+		goto err_free_inst;
+
+	/* The CPU side is called inline, so it has to be synchronous */
+	crypto_set_skcipher_spawn(&ictx->sw, inst);
+	err = crypto_grab_skcipher(&ictx->sw, sw_name, 0, CRYPTO_ALG_ASYNC);
+	if (err)
+		goto err_drop_hw;
+
+	hw = crypto_skcipher_spawn_alg(&ictx->hw);
+	sw = crypto_skcipher_spawn_alg(&ictx->sw);
+
+	err = -EINVAL;
+	if (strcmp(hw->cra_name, sw->cra_name) ||
+	    hw->cra_blocksize != sw->cra_blocksize)
+		goto err_drop_sw;
+
+	dispatch_alg_sizes(hw, &hw_min, &hw_max, &hw_iv);
+	dispatch_alg_sizes(sw, &sw_min, &sw_max, &sw_iv);
+	if (hw_iv != sw_iv)
+		goto err_drop_sw;
+
+	err = -ENAMETOOLONG;
+	if (snprintf(inst->alg.cra_driver_name, CRYPTO_MAX_ALG_NAME,
+		     "dispatch(%s,%s)", hw->cra_driver_name,
+		     sw->cra_driver_name) >= CRYPTO_MAX_ALG_NAME)
+		goto err_drop_sw;
+
+	/*
+	 * The instance implements the same algorithm under the same name and
+	 * takes over from the engine driver it wraps.
+	 */
+	memcpy(inst->alg.cra_name, hw->cra_name, CRYPTO_MAX_ALG_NAME);
+	inst->alg.cra_flags = CRYPTO_ALG_TYPE_ABLKCIPHER | CRYPTO_ALG_ASYNC;
+	inst->alg.cra_priority = hw->cra_priority + 1;
+	inst->alg.cra_blocksize = hw->cra_blocksize;
+	inst->alg.cra_alignmask = hw->cra_alignmask | sw->cra_alignmask;
+	inst->alg.cra_type = &crypto_ablkcipher_type;
+
+	inst->alg.cra_ablkcipher.ivsize = hw_iv;
+	inst->alg.cra_ablkcipher.min_keysize = max(hw_min, sw_min);
+	inst->alg.cra_ablkcipher.max_keysize = min(hw_max, sw_max);
+
+	inst->alg.cra_ctxsize = sizeof(struct dispatch_ctx);
+
+	inst->alg.cra_init = dispatch_init_tfm;
+	inst->alg.cra_exit = dispatch_exit_tfm;
+
+	inst->alg.cra_ablkcipher.setkey = dispatch_setkey;
+	inst->alg.cra_ablkcipher.encrypt = dispatch_encrypt;
+	inst->alg.cra_ablkcipher.decrypt = dispatch_decrypt;
+
+	if (dispatch_debugfs)
+		ictx->dent = debugfs_create_file(inst->alg.cra_driver_name,
+						 0444, dispatch_debugfs, ictx,
+						 &dispatch_stats_fops);
+
+	return inst;
+
+err_drop_sw:
+	crypto_drop_skcipher(&ictx->sw);
+err_drop_hw:
+	crypto_drop_skcipher(&ictx->hw);
+err_free_inst:
+	kfree(inst);
+	return ERR_PTR(err);
+}
+
+static void dispatch_free(struct crypto_instance *inst)
+{
+	struct dispatch_instance_ctx *ictx = crypto_instance_ctx(inst);
+
+	debugfs_remove(ictx->dent);
+	crypto_drop_skcipher(&ictx->sw);
+	crypto_drop_skcipher(&ictx->hw);
+	kfree(inst);
+}
+
+static struct crypto_template dispatch_tmpl = {
+	.name = "dispatch",
+	.alloc = dispatch_alloc,
+	.free = dispatch_free,
+	.module = THIS_MODULE,
+};
+
+static int __init dispatch_module_init(void)
+{
+	int err;
+
+	dispatch_debugfs = debugfs_create_dir("crypto_dispatch", NULL);
+	if (IS_ERR(dispatch_debugfs))
+		dispatch_debugfs = NULL;
+
+	err = crypto_register_template(&dispatch_tmpl);
+	if (err)
+		debugfs_remove(dispatch_debugfs);
+
+	return err;
+}
+
+static void __exit dispatch_module_exit(void)
+{
+	crypto_unregister_template(&dispatch_tmpl);
+	debugfs_remove(dispatch_debugfs);
+}
+
+module_init(dispatch_module_init);
+module_exit(dispatch_module_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Latency based hardware/software cipher dispatcher");
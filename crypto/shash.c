@@ -185,6 +185,71 @@ int crypto_shash_digest(struct shash_desc *desc, const u8 *data,
 }
 EXPORT_SYMBOL_GPL(crypto_shash_digest);
 
+static int shash_finup_mb_serial(struct shash_desc *desc,
+				 const u8 * const data[], unsigned int len,
+				 u8 * const outs[], unsigned int num_msgs)
+{
+	struct crypto_shash *tfm = desc->tfm;
+	unsigned int size = sizeof(*desc) + crypto_shash_descsize(tfm);
+	struct {
+		struct shash_desc shash;
+		char ctx[crypto_shash_descsize(tfm)];
+	} copy;
+	unsigned int i;
+	int err = 0;
+
+	for (i = 0; i < num_msgs && !err; i++) {
+		memcpy(&copy, desc, size);
+		err = crypto_shash_finup(&copy.shash, data[i], len, outs[i]);
+	}
+
+	memset(&copy, 0, size);
+	return err;
+}
+
+int crypto_shash_finup_mb(struct shash_desc *desc, const u8 * const data[],
+			  unsigned int len, u8 * const outs[],
+			  unsigned int num_msgs)
+{
+	struct crypto_shash *tfm = desc->tfm;
+	struct shash_alg *shash = crypto_shash_alg(tfm);
+	unsigned long alignmask = crypto_shash_alignmask(tfm);
+	unsigned long addrs;
+	unsigned int i, n;
+	int err;
+
+	while (num_msgs) {
+		n = min(num_msgs, shash->mb_max_msgs);
+
+		addrs = 0;
+		for (i = 0; i < n; i++)
+			addrs |= (unsigned long)data[i] | (unsigned long)outs[i];
+
+		if (n == 1 || (addrs & alignmask))
+			err = shash_finup_mb_serial(desc, data, len, outs, n);
+		else
+			err = shash->finup_mb(desc, data, len, outs, n);
+		if (err)
+			return err;
+
+		data += n;
+		outs += n;
+		num_msgs -= n;
+	}
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(crypto_shash_finup_mb);
+
+int crypto_shash_digest_mb(struct shash_desc *desc, const u8 * const data[],
+			   unsigned int len, u8 * const outs[],
+			   unsigned int num_msgs)
+{
+	return crypto_shash_init(desc) ?:
+	       crypto_shash_finup_mb(desc, data, len, outs, num_msgs);
+}
+EXPORT_SYMBOL_GPL(crypto_shash_digest_mb);
+
 static int shash_default_export(struct shash_desc *desc, void *out)
 {
 	memcpy(out, shash_desc_ctx(desc), crypto_shash_descsize(desc->tfm));
@@ -558,6 +623,7 @@ static void crypto_shash_show(struct seq_file *m, struct crypto_alg *alg)
 	seq_printf(m, "type         : shash\n");
 	seq_printf(m, "blocksize    : %u\n", alg->cra_blocksize);
 	seq_printf(m, "digestsize   : %u\n", salg->digestsize);
+	seq_printf(m, "mb_max_msgs  : %u\n", salg->mb_max_msgs);
 }
 
 static const struct crypto_type crypto_shash_type = {
@@ -599,6 +665,10 @@ static int shash_prepare_alg(struct shash_alg *alg)
 		alg->finup = shash_finup_unaligned;
 	if (!alg->digest)
 		alg->digest = shash_digest_unaligned;
+	if (!alg->finup_mb)
+		alg->mb_max_msgs = 1;
+	else if (!alg->mb_max_msgs)
+		return -EINVAL;
 	if (!alg->export) {
 		alg->export = shash_default_export;
 		alg->import = shash_default_import;
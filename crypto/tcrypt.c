@@ -22,6 +22,7 @@
  *
  */
 
+#include <crypto/acompress.h>
 #include <crypto/hash.h>
 #include <linux/err.h>
 #include <linux/init.h>
@@ -33,6 +34,8 @@
 #include <linux/jiffies.h>
 #include <linux/timex.h>
 #include <linux/interrupt.h>
+#include <linux/slab.h>
+#include <asm/unaligned.h>
 #include "tcrypt.h"
 #include "internal.h"
 
@@ -47,6 +50,25 @@
 #define ENCRYPT 1
 #define DECRYPT 0
 
+/*
+ * Used by test_mb_acipher_speed()
+ */
+#define MB_WIDTH	8
+#define MB_BUF_SIZE	8192
+
+/*
+ * Used by test_acomp_speed()
+ */
+#define ACOMP_DST_SIZE	(2 * PAGE_SIZE)
+#define ACOMP_MAX_DEPTH	32
+
+static const unsigned int acomp_depths[] = { 1, 2, 4, 8, 16, ACOMP_MAX_DEPTH };
+
+/*
+ * Used by test_mb_hash_speed()
+ */
+static const unsigned int mb_hash_lanes[] = { 1, 2, 4, MB_WIDTH };
+
 /*
  * Used by test_cipher_speed()
  */
@@ -475,6 +497,177 @@ out:
 	crypto_free_hash(tfm);
 }
 
+/*
+ * Every message has to hash to the same digest as when it is hashed on
+ * its own.
+ */
+static int test_mb_hash_check(struct shash_desc *desc, const u8 **data,
+			      int blen, u8 **outs, u8 *check, u32 num_mb)
+{
+	unsigned int i;
+	int ret;
+
+	ret = crypto_shash_digest_mb(desc, data, blen, outs, num_mb);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < num_mb; i++) {
+		ret = crypto_shash_digest(desc, data[i], blen, check);
+		if (ret)
+			return ret;
+		if (memcmp(check, outs[i], crypto_shash_digestsize(desc->tfm))) {
+			pr_cont("message %u does not match its serial digest\n",
+				i);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+static int test_mb_hash_jiffies(struct shash_desc *desc, const u8 **data,
+				int blen, u8 **outs, u32 num_mb, int sec)
+{
+	unsigned long start, end;
+	int bcount;
+	int ret;
+
+	for (start = jiffies, end = start + sec * HZ, bcount = 0;
+	     time_before(jiffies, end); bcount++) {
+		ret = crypto_shash_digest_mb(desc, data, blen, outs, num_mb);
+		if (ret)
+			return ret;
+	}
+
+	pr_cont("%d operations in %d seconds (%ld bytes)\n",
+		bcount * num_mb, sec, (long)bcount * blen * num_mb);
+	return 0;
+}
+
+/*
+ * Unlike test_hash_cycles(), this runs with bottom halves enabled, as
+ * SIMD implementations fall back to the serial code in softirq context.
+ */
+static int test_mb_hash_cycles(struct shash_desc *desc, const u8 **data,
+			       int blen, u8 **outs, u32 num_mb)
+{
+	unsigned long cycles = 0;
+	int ret = 0;
+	int i;
+
+	/* Warm-up run. */
+	for (i = 0; i < 4; i++) {
+		ret = crypto_shash_digest_mb(desc, data, blen, outs, num_mb);
+		if (ret)
+			goto out;
+	}
+
+	/* The real thing. */
+	for (i = 0; i < 8; i++) {
+		cycles_t start, end;
+
+		start = get_cycles();
+		ret = crypto_shash_digest_mb(desc, data, blen, outs, num_mb);
+		end = get_cycles();
+
+		if (ret)
+			goto out;
+
+		cycles += end - start;
+	}
+
+out:
+	if (ret == 0)
+		pr_cont("1 operation in %lu cycles (%d bytes)\n",
+			(cycles + 4) / (8 * num_mb), blen);
+
+	return ret;
+}
+
+static void test_mb_hash_speed(const char *algo, unsigned int sec,
+			       struct hash_speed *speed)
+{
+	struct crypto_shash *tfm;
+	struct shash_desc *desc = NULL;
+	const u8 *data[MB_WIDTH];
+	u8 *bufs[MB_WIDTH] = { NULL };
+	u8 *outs[MB_WIDTH] = { NULL };
+	u8 *check = NULL;
+	unsigned int i, j, k, num_mb, ds;
+	int ret;
+
+	tfm = crypto_alloc_shash(algo, 0, 0);
+	if (IS_ERR(tfm)) {
+		pr_err("failed to load transform for %s: %ld\n", algo,
+		       PTR_ERR(tfm));
+		return;
+	}
+
+	ds = crypto_shash_digestsize(tfm);
+	desc = kmalloc(sizeof(*desc) + crypto_shash_descsize(tfm),
+		       GFP_KERNEL);
+	check = kmalloc(ds, GFP_KERNEL);
+	if (!desc || !check)
+		goto out;
+
+	for (i = 0; i < MB_WIDTH; i++) {
+		bufs[i] = kmalloc(MB_BUF_SIZE, GFP_KERNEL);
+		outs[i] = kmalloc(ds, GFP_KERNEL);
+		if (!bufs[i] || !outs[i])
+			goto out;
+		memset(bufs[i], 0xff - i, MB_BUF_SIZE);
+		data[i] = bufs[i];
+	}
+
+	desc->tfm = tfm;
+	desc->flags = 0;
+
+	pr_info("\ntesting speed of multibuffer %s (%s), %u messages per pass\n",
+		algo, crypto_tfm_alg_driver_name(crypto_shash_tfm(tfm)),
+		crypto_shash_mb_max_msgs(tfm));
+
+	k = 0;
+	for (i = 0; i < ARRAY_SIZE(mb_hash_lanes); i++) {
+		num_mb = mb_hash_lanes[i];
+
+		for (j = 0; speed[j].blen != 0; j++, k++) {
+			if (speed[j].blen > MB_BUF_SIZE) {
+				pr_err("template (%u) too big for buffer (%u)\n",
+				       speed[j].blen, MB_BUF_SIZE);
+				goto out;
+			}
+
+			pr_info("test %u (%5u byte blocks, %u messages): ", k,
+				speed[j].blen, num_mb);
+
+			ret = test_mb_hash_check(desc, data, speed[j].blen,
+						 outs, check, num_mb);
+			if (!ret && sec)
+				ret = test_mb_hash_jiffies(desc, data,
+							   speed[j].blen, outs,
+							   num_mb, sec);
+			else if (!ret)
+				ret = test_mb_hash_cycles(desc, data,
+							  speed[j].blen, outs,
+							  num_mb);
+
+			if (ret) {
+				pr_err("hashing failed ret=%d\n", ret);
+				goto out;
+			}
+		}
+	}
+
+out:
+	for (i = 0; i < MB_WIDTH; i++) {
+		kfree(outs[i]);
+		kfree(bufs[i]);
+	}
+	kfree(check);
+	kfree(desc);
+	crypto_free_shash(tfm);
+}
+
 struct tcrypt_result {
 	struct completion completion;
 	int err;
@@ -920,6 +1113,426 @@ out:
 	crypto_free_ablkcipher(tfm);
 }
 
+struct mb_acipher_data {
+	struct ablkcipher_request *req;
+	struct tcrypt_result res;
+	struct scatterlist sg;
+	char *buf;
+	u8 iv[128];
+};
+
+/*
+ * Submit all requests before waiting for any of them, so that the driver
+ * sees num_mb requests in flight at once.
+ */
+static int do_mult_acipher_op(struct mb_acipher_data *data, int enc,
+			      u32 num_mb)
+{
+	int rc[MB_WIDTH];
+	int ret = 0;
+	int i;
+
+	for (i = 0; i < num_mb; i++) {
+		if (enc == ENCRYPT)
+			rc[i] = crypto_ablkcipher_encrypt(data[i].req);
+		else
+			rc[i] = crypto_ablkcipher_decrypt(data[i].req);
+	}
+
+	for (i = 0; i < num_mb; i++) {
+		rc[i] = do_one_acipher_op(data[i].req, rc[i]);
+		if (rc[i]) {
+			pr_info("concurrent request %d error %d\n", i, rc[i]);
+			ret = rc[i];
+		}
+	}
+
+	return ret;
+}
+
+static int test_mb_acipher_jiffies(struct mb_acipher_data *data, int enc,
+				   int blen, int sec, u32 num_mb)
+{
+	unsigned long start, end;
+	int bcount;
+	int ret;
+
+	for (start = jiffies, end = start + sec * HZ, bcount = 0;
+	     time_before(jiffies, end); bcount++) {
+		ret = do_mult_acipher_op(data, enc, num_mb);
+		if (ret)
+			return ret;
+	}
+
+	pr_cont("%d operations in %d seconds (%ld bytes)\n",
+		bcount * num_mb, sec, (long)bcount * blen * num_mb);
+	return 0;
+}
+
+static int test_mb_acipher_cycles(struct mb_acipher_data *data, int enc,
+				  int blen, u32 num_mb)
+{
+	unsigned long cycles = 0;
+	int ret = 0;
+	int i;
+
+	/* Warm-up run. */
+	for (i = 0; i < 4; i++) {
+		ret = do_mult_acipher_op(data, enc, num_mb);
+		if (ret)
+			goto out;
+	}
+
+	/* The real thing. */
+	for (i = 0; i < 8; i++) {
+		cycles_t start, end;
+
+		start = get_cycles();
+		ret = do_mult_acipher_op(data, enc, num_mb);
+		end = get_cycles();
+
+		if (ret)
+			goto out;
+
+		cycles += end - start;
+	}
+
+out:
+	if (ret == 0)
+		pr_cont("1 operation in %lu cycles (%d bytes)\n",
+			(cycles + 4) / (8 * num_mb), blen);
+
+	return ret;
+}
+
+static void test_mb_acipher_speed(const char *algo, int enc, unsigned int sec,
+				  u8 *keysize, u32 num_mb)
+{
+	struct mb_acipher_data *data;
+	struct crypto_ablkcipher *tfm;
+	unsigned int i, j, iv_len;
+	const char *e;
+	u32 *b_size;
+	int ret;
+
+	if (enc == ENCRYPT)
+		e = "encryption";
+	else
+		e = "decryption";
+
+	data = kcalloc(num_mb, sizeof(*data), GFP_KERNEL);
+	if (!data)
+		return;
+
+	tfm = crypto_alloc_ablkcipher(algo, 0, 0);
+	if (IS_ERR(tfm)) {
+		pr_err("failed to load transform for %s: %ld\n", algo,
+		       PTR_ERR(tfm));
+		goto out_free_data;
+	}
+
+	for (i = 0; i < num_mb; i++) {
+		data[i].buf = kmalloc(MB_BUF_SIZE, GFP_KERNEL);
+		data[i].req = ablkcipher_request_alloc(tfm, GFP_KERNEL);
+		if (!data[i].buf || !data[i].req) {
+			pr_err("tcrypt: skcipher: Failed to allocate request "
+			       "for %s\n", algo);
+			goto out_free_req;
+		}
+
+		init_completion(&data[i].res.completion);
+		ablkcipher_request_set_callback(data[i].req,
+						CRYPTO_TFM_REQ_MAY_BACKLOG,
+						tcrypt_complete, &data[i].res);
+	}
+
+	pr_info("\ntesting speed of multibuffer async %s (%s) %s\n", algo,
+		crypto_tfm_alg_driver_name(crypto_ablkcipher_tfm(tfm)), e);
+
+	i = 0;
+	do {
+		b_size = block_sizes;
+
+		do {
+			if (*b_size > MB_BUF_SIZE) {
+				pr_err("template (%u) too big for buffer (%u)\n",
+				       *b_size, MB_BUF_SIZE);
+				goto out_free_req;
+			}
+
+			pr_info("test %u (%d bit key, %d byte blocks, "
+				"%u requests in flight): ", i, *keysize * 8,
+				*b_size, num_mb);
+
+			memset(tvmem[0], 0xff, PAGE_SIZE);
+
+			crypto_ablkcipher_clear_flags(tfm, ~0);
+
+			ret = crypto_ablkcipher_setkey(tfm, tvmem[0], *keysize);
+			if (ret) {
+				pr_err("setkey() failed flags=%x\n",
+					crypto_ablkcipher_get_flags(tfm));
+				goto out_free_req;
+			}
+
+			/*
+			 * Number the requests like consecutive sectors, so
+			 * that drivers which merge contiguous requests with
+			 * sector based IVs get the chance to do so.
+			 */
+			iv_len = crypto_ablkcipher_ivsize(tfm);
+			for (j = 0; j < num_mb; j++) {
+				memset(data[j].buf, 0xff, *b_size);
+				sg_init_one(&data[j].sg, data[j].buf, *b_size);
+				memset(data[j].iv, 0, sizeof(data[j].iv));
+				if (iv_len >= sizeof(u64))
+					put_unaligned_le64(j, data[j].iv);
+				ablkcipher_request_set_crypt(data[j].req,
+							     &data[j].sg,
+							     &data[j].sg,
+							     *b_size,
+							     data[j].iv);
+			}
+
+			if (sec)
+				ret = test_mb_acipher_jiffies(data, enc,
+							      *b_size, sec,
+							      num_mb);
+			else
+				ret = test_mb_acipher_cycles(data, enc,
+							     *b_size, num_mb);
+
+			if (ret) {
+				pr_err("%s() failed flags=%x\n", e,
+					crypto_ablkcipher_get_flags(tfm));
+				break;
+			}
+			b_size++;
+			i++;
+		} while (*b_size);
+		keysize++;
+	} while (*keysize);
+
+out_free_req:
+	for (i = 0; i < num_mb; i++) {
+		ablkcipher_request_free(data[i].req);
+		kfree(data[i].buf);
+	}
+	crypto_free_ablkcipher(tfm);
+out_free_data:
+	kfree(data);
+}
+
+struct acomp_speed_data {
+	struct tcrypt_result res;
+	struct scatterlist src;
+	struct scatterlist dst;
+	char *page;
+	char *comp;
+	unsigned int clen;
+};
+
+/*
+ * Run one batch of @depth pages, compressing the pages into comp or
+ * decompressing comp back into the pages.
+ */
+static int do_acomp_batch_op(struct acomp_req **reqs,
+			     struct acomp_speed_data *data, int enc, u32 depth)
+{
+	int ret = 0;
+	int i;
+
+	for (i = 0; i < depth; i++) {
+		if (enc == ENCRYPT) {
+			sg_init_one(&data[i].src, data[i].page, PAGE_SIZE);
+			sg_init_one(&data[i].dst, data[i].comp, ACOMP_DST_SIZE);
+			acomp_request_set_params(reqs[i], &data[i].src,
+						 &data[i].dst, PAGE_SIZE,
+						 ACOMP_DST_SIZE);
+		} else {
+			sg_init_one(&data[i].src, data[i].comp, data[i].clen);
+			sg_init_one(&data[i].dst, data[i].page, PAGE_SIZE);
+			acomp_request_set_params(reqs[i], &data[i].src,
+						 &data[i].dst, data[i].clen,
+						 PAGE_SIZE);
+		}
+	}
+
+	if (enc == ENCRYPT)
+		crypto_acomp_compress_batch(reqs, depth);
+	else
+		crypto_acomp_decompress_batch(reqs, depth);
+
+	for (i = 0; i < depth; i++) {
+		wait_for_completion(&data[i].res.completion);
+		INIT_COMPLETION(data[i].res.completion);
+		if (data[i].res.err) {
+			pr_info("batched request %d error %d\n", i,
+				data[i].res.err);
+			ret = data[i].res.err;
+		} else if (enc == ENCRYPT) {
+			data[i].clen = reqs[i]->dlen;
+		}
+	}
+
+	return ret;
+}
+
+static int test_acomp_jiffies(struct acomp_req **reqs,
+			      struct acomp_speed_data *data, int enc, int sec,
+			      u32 depth)
+{
+	unsigned long start, end;
+	int bcount;
+	int ret;
+
+	for (start = jiffies, end = start + sec * HZ, bcount = 0;
+	     time_before(jiffies, end); bcount++) {
+		ret = do_acomp_batch_op(reqs, data, enc, depth);
+		if (ret)
+			return ret;
+	}
+
+	pr_cont("%d operations in %d seconds (%ld bytes)\n",
+		bcount * depth, sec, (long)bcount * PAGE_SIZE * depth);
+	return 0;
+}
+
+static int test_acomp_cycles(struct acomp_req **reqs,
+			     struct acomp_speed_data *data, int enc, u32 depth)
+{
+	unsigned long cycles = 0;
+	int ret = 0;
+	int i;
+
+	/* Warm-up run. */
+	for (i = 0; i < 4; i++) {
+		ret = do_acomp_batch_op(reqs, data, enc, depth);
+		if (ret)
+			goto out;
+	}
+
+	/* The real thing. */
+	for (i = 0; i < 8; i++) {
+		cycles_t start, end;
+
+		start = get_cycles();
+		ret = do_acomp_batch_op(reqs, data, enc, depth);
+		end = get_cycles();
+
+		if (ret)
+			goto out;
+
+		cycles += end - start;
+	}
+
+out:
+	if (ret == 0)
+		pr_cont("1 operation in %lu cycles (%lu bytes)\n",
+			(cycles + 4) / (8 * depth), PAGE_SIZE);
+
+	return ret;
+}
+
+/*
+ * Fill a page with text-like data that compresses to somewhere around a
+ * third of its size, as typical anonymous memory does.
+ */
+static void acomp_fill_page(char *page, unsigned int seed)
+{
+	static const char words[] = "the quick brown fox jumps over a lazy "
+				    "dog while zram swaps anonymous pages ";
+	unsigned int i;
+
+	for (i = 0; i < PAGE_SIZE; i++) {
+		if (i % 61 == 0)
+			seed = seed * 1103515245 + 12345;
+		page[i] = words[(i + (seed >> 16)) % (sizeof(words) - 1)];
+	}
+}
+
+static void test_acomp_speed(const char *algo, int enc, unsigned int sec)
+{
+	struct acomp_speed_data *data;
+	struct acomp_req **reqs;
+	struct crypto_acomp *tfm;
+	unsigned int i;
+	const char *e;
+	int ret;
+
+	if (enc == ENCRYPT)
+		e = "compression";
+	else
+		e = "decompression";
+
+	data = kcalloc(ACOMP_MAX_DEPTH, sizeof(*data), GFP_KERNEL);
+	reqs = kcalloc(ACOMP_MAX_DEPTH, sizeof(*reqs), GFP_KERNEL);
+	if (!data || !reqs)
+		goto out_free_data;
+
+	tfm = crypto_alloc_acomp(algo, 0, 0);
+	if (IS_ERR(tfm)) {
+		pr_err("failed to load transform for %s: %ld\n", algo,
+		       PTR_ERR(tfm));
+		goto out_free_data;
+	}
+
+	for (i = 0; i < ACOMP_MAX_DEPTH; i++) {
+		data[i].page = (char *)__get_free_page(GFP_KERNEL);
+		data[i].comp = kmalloc(ACOMP_DST_SIZE, GFP_KERNEL);
+		reqs[i] = acomp_request_alloc(tfm, GFP_KERNEL);
+		if (!data[i].page || !data[i].comp || !reqs[i]) {
+			pr_err("tcrypt: acomp: Failed to allocate request "
+			       "for %s\n", algo);
+			goto out_free_req;
+		}
+
+		acomp_fill_page(data[i].page, i);
+		init_completion(&data[i].res.completion);
+		acomp_request_set_callback(reqs[i], CRYPTO_TFM_REQ_MAY_BACKLOG,
+					   tcrypt_complete, &data[i].res);
+	}
+
+	pr_info("\ntesting speed of async %s (%s) %s\n", algo,
+		crypto_tfm_alg_driver_name(crypto_acomp_tfm(tfm)), e);
+
+	/* Decompression needs something to decompress. */
+	ret = do_acomp_batch_op(reqs, data, ENCRYPT, ACOMP_MAX_DEPTH);
+	if (ret) {
+		pr_err("compression failed\n");
+		goto out_free_req;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(acomp_depths); i++) {
+		pr_info("test %u (%lu byte pages, %u requests in flight): ", i,
+			PAGE_SIZE, acomp_depths[i]);
+
+		if (sec)
+			ret = test_acomp_jiffies(reqs, data, enc, sec,
+						 acomp_depths[i]);
+		else
+			ret = test_acomp_cycles(reqs, data, enc,
+						acomp_depths[i]);
+
+		if (ret) {
+			pr_err("%s() failed\n", e);
+			break;
+		}
+	}
+
+out_free_req:
+	for (i = 0; i < ACOMP_MAX_DEPTH; i++) {
+		if (reqs[i])
+			acomp_request_free(reqs[i]);
+		kfree(data[i].comp);
+		free_page((unsigned long)data[i].page);
+	}
+	crypto_free_acomp(tfm);
+out_free_data:
+	kfree(reqs);
+	kfree(data);
+}
+
 static void test_available(void)
 {
 	char **name = check;
@@ -1414,6 +2027,18 @@ static int do_test(int m)
 		test_hash_speed("ghash-generic", sec, hash_speed_template_16);
 		if (mode > 300 && mode < 400) break;
 
+	case 319:
+		test_mb_hash_speed("sha1", sec, mb_hash_speed_template);
+		if (mode > 300 && mode < 400) break;
+
+	case 320:
+		test_mb_hash_speed("sha256", sec, mb_hash_speed_template);
+		if (mode > 300 && mode < 400) break;
+
+	case 321:
+		test_mb_hash_speed("crc32c", sec, mb_hash_speed_template);
+		if (mode > 300 && mode < 400) break;
+
 	case 399:
 		break;
 
@@ -1563,6 +2188,50 @@ static int do_test(int m)
 				   speed_template_32_64);
 		break;
 
+	case 504:
+		test_acipher_speed("dispatch(cryptd(cbc(aes-generic)),"
+				   "cbc(aes-generic))", ENCRYPT, sec, NULL, 0,
+				   speed_template_16_24_32);
+		test_acipher_speed("dispatch(cryptd(cbc(aes-generic)),"
+				   "cbc(aes-generic))", DECRYPT, sec, NULL, 0,
+				   speed_template_16_24_32);
+		test_acipher_speed("dispatch(ecb(aes-generic),"
+				   "ecb(aes-generic))", ENCRYPT, sec, NULL, 0,
+				   speed_template_16_24_32);
+		test_acipher_speed("dispatch(ecb(aes-generic),"
+				   "ecb(aes-generic))", DECRYPT, sec, NULL, 0,
+				   speed_template_16_24_32);
+		break;
+
+	case 505:
+		test_mb_acipher_speed("ecb(aes)", ENCRYPT, sec,
+				      speed_template_16_24_32, MB_WIDTH);
+		test_mb_acipher_speed("ecb(aes)", DECRYPT, sec,
+				      speed_template_16_24_32, MB_WIDTH);
+		test_mb_acipher_speed("cbc(aes)", ENCRYPT, sec,
+				      speed_template_16_24_32, MB_WIDTH);
+		test_mb_acipher_speed("cbc(aes)", DECRYPT, sec,
+				      speed_template_16_24_32, MB_WIDTH);
+		test_mb_acipher_speed("ctr(aes)", ENCRYPT, sec,
+				      speed_template_16_24_32, MB_WIDTH);
+		test_mb_acipher_speed("ctr(aes)", DECRYPT, sec,
+				      speed_template_16_24_32, MB_WIDTH);
+		test_mb_acipher_speed("xts(aes)", ENCRYPT, sec,
+				      speed_template_32_64, MB_WIDTH);
+		test_mb_acipher_speed("xts(aes)", DECRYPT, sec,
+				      speed_template_32_64, MB_WIDTH);
+		break;
+
+	case 600:
+		test_acomp_speed("lzo", ENCRYPT, sec);
+		test_acomp_speed("lzo", DECRYPT, sec);
+		break;
+
+	case 601:
+		test_acomp_speed("deflate", ENCRYPT, sec);
+		test_acomp_speed("deflate", DECRYPT, sec);
+		break;
+
 	case 1000:
 		test_available();
 		break;
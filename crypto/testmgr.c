@@ -20,6 +20,7 @@
  *
  */
 
+#include <crypto/acompress.h>
 #include <crypto/hash.h>
 #include <linux/err.h>
 #include <linux/module.h>
@@ -1051,6 +1052,126 @@ out:
 	return ret;
 }
 
+/*
+ * The compression vectors go in as batches and the decompression vectors
+ * one at a time, so that both ways of submitting are covered.
+ */
+static int test_acomp(struct crypto_acomp *tfm, struct comp_testvec *ctemplate,
+		      struct comp_testvec *dtemplate, int ctcount, int dtcount)
+{
+	const char *algo = crypto_tfm_alg_driver_name(crypto_acomp_tfm(tfm));
+	struct acomp_req *reqs[XBUFSIZE];
+	struct tcrypt_result result[XBUFSIZE];
+	struct scatterlist src[XBUFSIZE], dst[XBUFSIZE];
+	char *xbuf[XBUFSIZE], *obuf[XBUFSIZE];
+	unsigned int i, j, n;
+	int ret = -ENOMEM;
+
+	if (testmgr_alloc_buf(xbuf))
+		goto out_nobuf;
+	if (testmgr_alloc_buf(obuf))
+		goto out_noobuf;
+
+	memset(reqs, 0, sizeof(reqs));
+	for (j = 0; j < XBUFSIZE; j++) {
+		reqs[j] = acomp_request_alloc(tfm, GFP_KERNEL);
+		if (!reqs[j]) {
+			printk(KERN_ERR "alg: acomp: Failed to allocate "
+			       "request for %s\n", algo);
+			goto out;
+		}
+		init_completion(&result[j].completion);
+		acomp_request_set_callback(reqs[j], CRYPTO_TFM_REQ_MAY_BACKLOG,
+					   tcrypt_complete, &result[j]);
+	}
+
+	for (i = 0; i < ctcount; i += n) {
+		n = min_t(unsigned int, ctcount - i, XBUFSIZE);
+
+		for (j = 0; j < n; j++) {
+			memcpy(xbuf[j], ctemplate[i + j].input,
+			       ctemplate[i + j].inlen);
+			memset(obuf[j], 0, COMP_BUF_SIZE);
+			sg_init_one(&src[j], xbuf[j], ctemplate[i + j].inlen);
+			sg_init_one(&dst[j], obuf[j], COMP_BUF_SIZE);
+			acomp_request_set_params(reqs[j], &src[j], &dst[j],
+						 ctemplate[i + j].inlen,
+						 COMP_BUF_SIZE);
+		}
+
+		crypto_acomp_compress_batch(reqs, n);
+		for (j = 0; j < n; j++) {
+			wait_for_completion(&result[j].completion);
+			INIT_COMPLETION(result[j].completion);
+		}
+
+		for (j = 0; j < n; j++) {
+			ret = result[j].err;
+			if (ret) {
+				printk(KERN_ERR "alg: acomp: compression "
+				       "failed on test %d for %s: ret=%d\n",
+				       i + j + 1, algo, -ret);
+				goto out;
+			}
+
+			if (reqs[j]->dlen != ctemplate[i + j].outlen ||
+			    memcmp(obuf[j], ctemplate[i + j].output,
+				   reqs[j]->dlen)) {
+				printk(KERN_ERR "alg: acomp: Compression test "
+				       "%d failed for %s: output len = %u\n",
+				       i + j + 1, algo, reqs[j]->dlen);
+				hexdump(obuf[j], reqs[j]->dlen);
+				ret = -EINVAL;
+				goto out;
+			}
+		}
+	}
+
+	for (i = 0; i < dtcount; i++) {
+		memcpy(xbuf[0], dtemplate[i].input, dtemplate[i].inlen);
+		memset(obuf[0], 0, COMP_BUF_SIZE);
+		sg_init_one(&src[0], xbuf[0], dtemplate[i].inlen);
+		sg_init_one(&dst[0], obuf[0], COMP_BUF_SIZE);
+		acomp_request_set_params(reqs[0], &src[0], &dst[0],
+					 dtemplate[i].inlen, COMP_BUF_SIZE);
+
+		ret = crypto_acomp_decompress(reqs[0]);
+		if (ret == -EINPROGRESS || ret == -EBUSY) {
+			wait_for_completion(&result[0].completion);
+			INIT_COMPLETION(result[0].completion);
+			ret = result[0].err;
+		}
+		if (ret) {
+			printk(KERN_ERR "alg: acomp: decompression failed "
+			       "on test %d for %s: ret=%d\n", i + 1, algo,
+			       -ret);
+			goto out;
+		}
+
+		if (reqs[0]->dlen != dtemplate[i].outlen ||
+		    memcmp(obuf[0], dtemplate[i].output, reqs[0]->dlen)) {
+			printk(KERN_ERR "alg: acomp: Decompression test %d "
+			       "failed for %s: output len = %u\n", i + 1, algo,
+			       reqs[0]->dlen);
+			hexdump(obuf[0], reqs[0]->dlen);
+			ret = -EINVAL;
+			goto out;
+		}
+	}
+
+	ret = 0;
+
+out:
+	for (j = 0; j < XBUFSIZE; j++)
+		if (reqs[j])
+			acomp_request_free(reqs[j]);
+	testmgr_free_buf(obuf);
+out_noobuf:
+	testmgr_free_buf(xbuf);
+out_nobuf:
+	return ret;
+}
+
 static int test_pcomp(struct crypto_pcomp *tfm,
 		      struct pcomp_testvec *ctemplate,
 		      struct pcomp_testvec *dtemplate, int ctcount,
@@ -1398,6 +1519,28 @@ static int alg_test_comp(const struct alg_test_desc *desc, const char *driver,
 	return err;
 }
 
+static int alg_test_acomp(const struct alg_test_desc *desc, const char *driver,
+			  u32 type, u32 mask)
+{
+	struct crypto_acomp *tfm;
+	int err;
+
+	tfm = crypto_alloc_acomp(driver, type, mask);
+	if (IS_ERR(tfm)) {
+		printk(KERN_ERR "alg: acomp: Failed to load transform for %s: "
+		       "%ld\n", driver, PTR_ERR(tfm));
+		return PTR_ERR(tfm);
+	}
+
+	err = test_acomp(tfm, desc->suite.comp.comp.vecs,
+			 desc->suite.comp.decomp.vecs,
+			 desc->suite.comp.comp.count,
+			 desc->suite.comp.decomp.count);
+
+	crypto_free_acomp(tfm);
+	return err;
+}
+
 static int alg_test_pcomp(const struct alg_test_desc *desc, const char *driver,
 			  u32 type, u32 mask)
 {
@@ -1549,6 +1692,21 @@ static const struct alg_test_desc alg_test_descs[] = {
 				}
 			}
 		}
+	}, {
+		.alg = "__driver-cbc-aes-neonbs",
+		.test = alg_test_null,
+		.suite = {
+			.cipher = {
+				.enc = {
+					.vecs = NULL,
+					.count = 0
+				},
+				.dec = {
+					.vecs = NULL,
+					.count = 0
+				}
+			}
+		}
 	}, {
 		.alg = "__driver-cbc-serpent-sse2",
 		.test = alg_test_null,
@@ -1564,6 +1722,21 @@ static const struct alg_test_desc alg_test_descs[] = {
 				}
 			}
 		}
+	}, {
+		.alg = "__driver-ctr-aes-neonbs",
+		.test = alg_test_null,
+		.suite = {
+			.cipher = {
+				.enc = {
+					.vecs = NULL,
+					.count = 0
+				},
+				.dec = {
+					.vecs = NULL,
+					.count = 0
+				}
+			}
+		}
 	}, {
 		.alg = "__driver-ecb-aes-aesni",
 		.test = alg_test_null,
@@ -1579,6 +1752,21 @@ static const struct alg_test_desc alg_test_descs[] = {
 				}
 			}
 		}
+	}, {
+		.alg = "__driver-ecb-aes-neonbs",
+		.test = alg_test_null,
+		.suite = {
+			.cipher = {
+				.enc = {
+					.vecs = NULL,
+					.count = 0
+				},
+				.dec = {
+					.vecs = NULL,
+					.count = 0
+				}
+			}
+		}
 	}, {
 		.alg = "__driver-ecb-serpent-sse2",
 		.test = alg_test_null,
@@ -1594,6 +1782,21 @@ static const struct alg_test_desc alg_test_descs[] = {
 				}
 			}
 		}
+	}, {
+		.alg = "__driver-xts-aes-neonbs",
+		.test = alg_test_null,
+		.suite = {
+			.cipher = {
+				.enc = {
+					.vecs = NULL,
+					.count = 0
+				},
+				.dec = {
+					.vecs = NULL,
+					.count = 0
+				}
+			}
+		}
 	}, {
 		.alg = "__ghash-pclmulqdqni",
 		.test = alg_test_null,
@@ -1603,6 +1806,36 @@ static const struct alg_test_desc alg_test_descs[] = {
 				.count = 0
 			}
 		}
+	}, {
+		.alg = "acompd(deflate)",
+		.test = alg_test_acomp,
+		.suite = {
+			.comp = {
+				.comp = {
+					.vecs = deflate_comp_tv_template,
+					.count = DEFLATE_COMP_TEST_VECTORS
+				},
+				.decomp = {
+					.vecs = deflate_decomp_tv_template,
+					.count = DEFLATE_DECOMP_TEST_VECTORS
+				}
+			}
+		}
+	}, {
+		.alg = "acompd(lzo)",
+		.test = alg_test_acomp,
+		.suite = {
+			.comp = {
+				.comp = {
+					.vecs = lzo_comp_tv_template,
+					.count = LZO_COMP_TEST_VECTORS
+				},
+				.decomp = {
+					.vecs = lzo_decomp_tv_template,
+					.count = LZO_DECOMP_TEST_VECTORS
+				}
+			}
+		}
 	}, {
 		.alg = "ansi_cprng",
 		.test = alg_test_cprng,
@@ -1761,6 +1994,36 @@ static const struct alg_test_desc alg_test_descs[] = {
 				.count = CRC32C_TEST_VECTORS
 			}
 		}
+	}, {
+		.alg = "cryptd(__driver-cbc-aes-neonbs)",
+		.test = alg_test_null,
+		.suite = {
+			.cipher = {
+				.enc = {
+					.vecs = NULL,
+					.count = 0
+				},
+				.dec = {
+					.vecs = NULL,
+					.count = 0
+				}
+			}
+		}
+	}, {
+		.alg = "cryptd(__driver-ctr-aes-neonbs)",
+		.test = alg_test_null,
+		.suite = {
+			.cipher = {
+				.enc = {
+					.vecs = NULL,
+					.count = 0
+				},
+				.dec = {
+					.vecs = NULL,
+					.count = 0
+				}
+			}
+		}
 	}, {
 		.alg = "cryptd(__driver-ecb-aes-aesni)",
 		.test = alg_test_null,
@@ -1776,6 +2039,21 @@ static const struct alg_test_desc alg_test_descs[] = {
 				}
 			}
 		}
+	}, {
+		.alg = "cryptd(__driver-ecb-aes-neonbs)",
+		.test = alg_test_null,
+		.suite = {
+			.cipher = {
+				.enc = {
+					.vecs = NULL,
+					.count = 0
+				},
+				.dec = {
+					.vecs = NULL,
+					.count = 0
+				}
+			}
+		}
 	}, {
 		.alg = "cryptd(__driver-ecb-serpent-sse2)",
 		.test = alg_test_null,
@@ -1791,6 +2069,21 @@ static const struct alg_test_desc alg_test_descs[] = {
 				}
 			}
 		}
+	}, {
+		.alg = "cryptd(__driver-xts-aes-neonbs)",
+		.test = alg_test_null,
+		.suite = {
+			.cipher = {
+				.enc = {
+					.vecs = NULL,
+					.count = 0
+				},
+				.dec = {
+					.vecs = NULL,
+					.count = 0
+				}
+			}
+		}
 	}, {
 		.alg = "cryptd(__ghash-pclmulqdqni)",
 		.test = alg_test_null,
@@ -0,0 +1,482 @@
+/*
+ * Memory-less block device for benchmarking the block layer.
+ *
+ * Every bio or request submitted to a nullb device is completed without
+ * touching any data, either inline in the submission path, from the block
+ * softirq or from a high resolution timer that models device latency and
+ * bandwidth.  This gives a reproducible target for measuring submission
+ * overhead and I/O scheduler behaviour independent of real storage.
+ *
+ * See Documentation/block/null_blk.txt for the module parameters.
+ */
+
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/init.h>
+#include <linux/blkdev.h>
+#include <linux/bio.h>
+#include <linux/fs.h>
+#include <linux/slab.h>
+#include <linux/bitops.h>
+#include <linux/log2.h>
+#include <linux/wait.h>
+#include <linux/sched.h>
+#include <linux/hrtimer.h>
+#include <linux/ktime.h>
+
+enum {
+	NULL_Q_BIO		= 0,
+	NULL_Q_RQ		= 1,
+};
+
+enum {
+	NULL_IRQ_NONE		= 0,
+	NULL_IRQ_SOFTIRQ	= 1,
+	NULL_IRQ_TIMER		= 2,
+};
+
+struct nullb;
+
+struct nullb_cmd {
+	struct nullb *nullb;
+	struct request *rq;
+	struct bio *bio;
+	unsigned int tag;
+	struct hrtimer timer;
+};
+
+struct nullb {
+	struct list_head list;
+	unsigned int index;
+	struct request_queue *q;
+	struct gendisk *disk;
+	spinlock_t lock;
+
+	unsigned int queue_depth;
+	struct nullb_cmd *cmds;
+	unsigned long *tag_map;
+	wait_queue_head_t wait;
+
+	/* Time at which the emulated media finishes its current transfer. */
+	spinlock_t bw_lock;
+	ktime_t bw_next;
+};
+
+static LIST_HEAD(nullb_list);
+static DEFINE_MUTEX(nullb_lock);
+static int null_major;
+static int nullb_indexes;
+
+static int queue_mode = NULL_Q_RQ;
+module_param(queue_mode, int, S_IRUGO);
+MODULE_PARM_DESC(queue_mode, "Block interface to use (0=bio,1=rq)");
+
+static int irqmode = NULL_IRQ_SOFTIRQ;
+module_param(irqmode, int, S_IRUGO);
+MODULE_PARM_DESC(irqmode, "IRQ completion handler. 0-none, 1-softirq, 2-timer");
+
+static unsigned long completion_nsec = 10000;
+module_param(completion_nsec, ulong, S_IRUGO);
+MODULE_PARM_DESC(completion_nsec, "Time in ns to complete a request in hardware. Default: 10,000ns");
+
+static unsigned int mbps;
+module_param(mbps, uint, S_IRUGO);
+MODULE_PARM_DESC(mbps, "Emulated media bandwidth in MB/s for timer completions. 0 means unlimited");
+
+static int hw_queue_depth = 64;
+module_param(hw_queue_depth, int, S_IRUGO);
+MODULE_PARM_DESC(hw_queue_depth, "Queue depth for each device. Default: 64");
+
+static int nr_devices = 2;
+module_param(nr_devices, int, S_IRUGO);
+MODULE_PARM_DESC(nr_devices, "Number of devices to register");
+
+static int gb = 250;
+module_param(gb, int, S_IRUGO);
+MODULE_PARM_DESC(gb, "Size in GB");
+
+static int bs = 512;
+module_param(bs, int, S_IRUGO);
+MODULE_PARM_DESC(bs, "Block size (in bytes)");
+
+static int home_node = NUMA_NO_NODE;
+module_param(home_node, int, S_IRUGO);
+MODULE_PARM_DESC(home_node, "Home node for the device");
+
+static unsigned int get_tag(struct nullb *nullb)
+{
+	unsigned int tag;
+
+	do {
+		tag = find_first_zero_bit(nullb->tag_map, nullb->queue_depth);
+		if (tag >= nullb->queue_depth)
+			return -1U;
+	} while (test_and_set_bit_lock(tag, nullb->tag_map));
+
+	return tag;
+}
+
+static struct nullb_cmd *alloc_cmd(struct nullb *nullb, int can_wait)
+{
+	struct nullb_cmd *cmd;
+	unsigned int tag;
+	DEFINE_WAIT(wait);
+
+	tag = get_tag(nullb);
+	if (tag == -1U && can_wait) {
+		do {
+			prepare_to_wait(&nullb->wait, &wait,
+					TASK_UNINTERRUPTIBLE);
+			tag = get_tag(nullb);
+			if (tag != -1U)
+				break;
+			io_schedule();
+		} while (1);
+		finish_wait(&nullb->wait, &wait);
+	}
+
+	if (tag == -1U)
+		return NULL;
+
+	cmd = &nullb->cmds[tag];
+	cmd->rq = NULL;
+	cmd->bio = NULL;
+	return cmd;
+}
+
+static void free_cmd(struct nullb_cmd *cmd)
+{
+	struct nullb *nullb = cmd->nullb;
+	struct request_queue *q = nullb->q;
+	unsigned long flags;
+
+	clear_bit_unlock(cmd->tag, nullb->tag_map);
+	smp_mb__after_clear_bit();
+
+	if (waitqueue_active(&nullb->wait))
+		wake_up(&nullb->wait);
+
+	/* The request_fn stops the queue when it runs out of tags. */
+	if (queue_mode == NULL_Q_RQ && blk_queue_stopped(q)) {
+		spin_lock_irqsave(q->queue_lock, flags);
+		if (blk_queue_stopped(q))
+			blk_start_queue(q);
+		spin_unlock_irqrestore(q->queue_lock, flags);
+	}
+}
+
+static void end_cmd(struct nullb_cmd *cmd)
+{
+	if (cmd->rq)
+		blk_end_request_all(cmd->rq, 0);
+	else
+		bio_endio(cmd->bio, 0);
+
+	free_cmd(cmd);
+}
+
+static enum hrtimer_restart null_cmd_timer_expired(struct hrtimer *timer)
+{
+	end_cmd(container_of(timer, struct nullb_cmd, timer));
+
+	return HRTIMER_NORESTART;
+}
+
+/*
+ * Work out when the emulated device finishes transferring @bytes, given
+ * that it serves one transfer at a time at 'mbps' megabytes per second.
+ */
+static ktime_t null_cmd_deadline(struct nullb *nullb, unsigned int bytes)
+{
+	ktime_t now = ktime_get();
+	ktime_t done;
+
+	if (!mbps)
+		return ktime_add_ns(now, completion_nsec);
+
+	spin_lock(&nullb->bw_lock);
+	if (ktime_to_ns(nullb->bw_next) < ktime_to_ns(now))
+		nullb->bw_next = now;
+	nullb->bw_next = ktime_add_ns(nullb->bw_next,
+				      div_u64((u64)bytes * 1000, mbps));
+	done = nullb->bw_next;
+	spin_unlock(&nullb->bw_lock);
+
+	return ktime_add_ns(done, completion_nsec);
+}
+
+static void null_cmd_end_timer(struct nullb_cmd *cmd, unsigned int bytes)
+{
+	hrtimer_start(&cmd->timer, null_cmd_deadline(cmd->nullb, bytes),
+		      HRTIMER_MODE_ABS);
+}
+
+static void null_softirq_done_fn(struct request *rq)
+{
+	end_cmd(rq->special);
+}
+
+static void null_bio_make_request(struct request_queue *q, struct bio *bio)
+{
+	struct nullb *nullb = q->queuedata;
+	struct nullb_cmd *cmd;
+
+	cmd = alloc_cmd(nullb, 1);
+	cmd->bio = bio;
+
+	/*
+	 * Bios never go through the softirq completion path, so anything
+	 * other than timer completion ends them in the submitter's context.
+	 */
+	if (irqmode == NULL_IRQ_TIMER)
+		null_cmd_end_timer(cmd, bio->bi_size);
+	else
+		end_cmd(cmd);
+}
+
+static void null_request_fn(struct request_queue *q)
+{
+	struct nullb *nullb = q->queuedata;
+	struct nullb_cmd *cmd;
+	struct request *rq;
+
+	while ((rq = blk_peek_request(q)) != NULL) {
+		cmd = alloc_cmd(nullb, 0);
+		if (!cmd) {
+			/*
+			 * Stop the queue and look again, so a tag released
+			 * before free_cmd() could see the stopped flag is not
+			 * missed.
+			 */
+			blk_stop_queue(q);
+			smp_mb();
+			cmd = alloc_cmd(nullb, 0);
+			if (!cmd)
+				break;
+			queue_flag_clear(QUEUE_FLAG_STOPPED, q);
+		}
+
+		blk_start_request(rq);
+		cmd->rq = rq;
+		rq->special = cmd;
+
+		switch (irqmode) {
+		case NULL_IRQ_NONE:
+			/* Called with the queue lock held. */
+			__blk_end_request_all(rq, 0);
+			free_cmd(cmd);
+			break;
+		case NULL_IRQ_SOFTIRQ:
+			blk_complete_request(rq);
+			break;
+		case NULL_IRQ_TIMER:
+			null_cmd_end_timer(cmd, blk_rq_bytes(rq));
+			break;
+		}
+	}
+}
+
+static int null_open(struct block_device *bdev, fmode_t mode)
+{
+	return 0;
+}
+
+static int null_release(struct gendisk *disk, fmode_t mode)
+{
+	return 0;
+}
+
+static const struct block_device_operations null_fops = {
+	.owner =	THIS_MODULE,
+	.open =		null_open,
+	.release =	null_release,
+};
+
+static int setup_commands(struct nullb *nullb)
+{
+	struct nullb_cmd *cmd;
+	int i, tag_size;
+
+	nullb->cmds = kzalloc_node(nullb->queue_depth * sizeof(*cmd),
+				   GFP_KERNEL, home_node);
+	if (!nullb->cmds)
+		return -ENOMEM;
+
+	tag_size = ALIGN(nullb->queue_depth, BITS_PER_LONG) / BITS_PER_LONG;
+	nullb->tag_map = kzalloc_node(tag_size * sizeof(unsigned long),
+				      GFP_KERNEL, home_node);
+	if (!nullb->tag_map) {
+		kfree(nullb->cmds);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < nullb->queue_depth; i++) {
+		cmd = &nullb->cmds[i];
+		cmd->nullb = nullb;
+		cmd->tag = i;
+		hrtimer_init(&cmd->timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+		cmd->timer.function = null_cmd_timer_expired;
+	}
+
+	return 0;
+}
+
+static void cleanup_commands(struct nullb *nullb)
+{
+	int i;
+
+	for (i = 0; i < nullb->queue_depth; i++)
+		hrtimer_cancel(&nullb->cmds[i].timer);
+
+	kfree(nullb->tag_map);
+	kfree(nullb->cmds);
+}
+
+static void null_del_dev(struct nullb *nullb)
+{
+	list_del_init(&nullb->list);
+
+	del_gendisk(nullb->disk);
+	blk_cleanup_queue(nullb->q);
+	put_disk(nullb->disk);
+	cleanup_commands(nullb);
+	kfree(nullb);
+}
+
+static int null_add_dev(void)
+{
+	struct gendisk *disk;
+	struct nullb *nullb;
+	sector_t size;
+
+	nullb = kzalloc_node(sizeof(*nullb), GFP_KERNEL, home_node);
+	if (!nullb)
+		return -ENOMEM;
+
+	spin_lock_init(&nullb->lock);
+	spin_lock_init(&nullb->bw_lock);
+	init_waitqueue_head(&nullb->wait);
+	nullb->queue_depth = hw_queue_depth;
+	nullb->bw_next = ktime_set(0, 0);
+
+	if (setup_commands(nullb))
+		goto out_free_nullb;
+
+	if (queue_mode == NULL_Q_BIO) {
+		nullb->q = blk_alloc_queue_node(GFP_KERNEL, home_node);
+		if (!nullb->q)
+			goto out_cleanup_cmds;
+		blk_queue_make_request(nullb->q, null_bio_make_request);
+	} else {
+		nullb->q = blk_init_queue_node(null_request_fn, &nullb->lock,
+					       home_node);
+		if (!nullb->q)
+			goto out_cleanup_cmds;
+		blk_queue_softirq_done(nullb->q, null_softirq_done_fn);
+		blk_queue_max_hw_sectors(nullb->q, BLK_DEF_MAX_SECTORS);
+	}
+
+	nullb->q->queuedata = nullb;
+	queue_flag_set_unlocked(QUEUE_FLAG_NONROT, nullb->q);
+	blk_queue_bounce_limit(nullb->q, BLK_BOUNCE_ANY);
+	blk_queue_logical_block_size(nullb->q, bs);
+	blk_queue_physical_block_size(nullb->q, bs);
+
+	disk = nullb->disk = alloc_disk_node(1, home_node);
+	if (!disk)
+		goto out_cleanup_queue;
+
+	mutex_lock(&nullb_lock);
+	list_add_tail(&nullb->list, &nullb_list);
+	nullb->index = nullb_indexes++;
+	mutex_unlock(&nullb_lock);
+
+	size = gb * 1024 * 1024 * 1024ULL;
+	sector_div(size, bs);
+	set_capacity(disk, size * (bs >> 9));
+
+	disk->flags |= GENHD_FL_EXT_DEVT;
+	disk->major = null_major;
+	disk->first_minor = nullb->index;
+	disk->fops = &null_fops;
+	disk->private_data = nullb;
+	disk->queue = nullb->q;
+	sprintf(disk->disk_name, "nullb%d", nullb->index);
+	add_disk(disk);
+	return 0;
+
+out_cleanup_queue:
+	blk_cleanup_queue(nullb->q);
+out_cleanup_cmds:
+	cleanup_commands(nullb);
+out_free_nullb:
+	kfree(nullb);
+	return -ENOMEM;
+}
+
+static int __init null_init(void)
+{
+	struct nullb *nullb;
+	unsigned int i;
+
+	if (bs > PAGE_SIZE || bs < 512 || !is_power_of_2(bs)) {
+		pr_warn("null_blk: invalid block size %d, using 512\n", bs);
+		bs = 512;
+	}
+
+	if (queue_mode != NULL_Q_BIO && queue_mode != NULL_Q_RQ) {
+		pr_warn("null_blk: invalid queue_mode %d, using rq\n",
+			queue_mode);
+		queue_mode = NULL_Q_RQ;
+	}
+
+	if (irqmode < NULL_IRQ_NONE || irqmode > NULL_IRQ_TIMER) {
+		pr_warn("null_blk: invalid irqmode %d, using softirq\n",
+			irqmode);
+		irqmode = NULL_IRQ_SOFTIRQ;
+	}
+
+	if (hw_queue_depth < 1)
+		hw_queue_depth = 1;
+
+	null_major = register_blkdev(0, "nullb");
+	if (null_major < 0)
+		return null_major;
+
+	for (i = 0; i < nr_devices; i++) {
+		if (null_add_dev())
+			goto err_dev;
+	}
+
+	pr_info("null_blk: module loaded\n");
+	return 0;
+
+err_dev:
+	mutex_lock(&nullb_lock);
+	while (!list_empty(&nullb_list)) {
+		nullb = list_entry(nullb_list.next, struct nullb, list);
+		null_del_dev(nullb);
+	}
+	mutex_unlock(&nullb_lock);
+	unregister_blkdev(null_major, "nullb");
+	return -EINVAL;
+}
+
+static void __exit null_exit(void)
+{
+	struct nullb *nullb;
+
+	unregister_blkdev(null_major, "nullb");
+
+	mutex_lock(&nullb_lock);
+	while (!list_empty(&nullb_list)) {
+		nullb = list_entry(nullb_list.next, struct nullb, list);
+		null_del_dev(nullb);
+	}
+	mutex_unlock(&nullb_lock);
+}
+
+module_init(null_init);
+module_exit(null_exit);
+
+MODULE_LICENSE("GPL");
@@ -134,6 +134,7 @@ struct qce_req {
 	unsigned char *iv;		
 	unsigned int ivsize;		
 	unsigned int cryptlen;		
+	unsigned int xts_du_size;	
 	unsigned int use_pmem;		
 	struct qcedev_pmem_info *pmem;	
 };
@@ -567,7 +567,11 @@ static int _ce_setup_cipher(struct qce_device *pce_dev, struct qce_req *creq,
 		if (creq->mode ==  QCE_MODE_XTS) {
 			memcpy(buffer->encr_xts_key, (creq->enckey +
 					creq->encklen/2), creq->encklen/2);
-			*((uint32_t *)(buffer->encr_xts_du_size)) =
+			if (creq->xts_du_size)
+				*((uint32_t *)(buffer->encr_xts_du_size)) =
+							creq->xts_du_size;
+			else
+				*((uint32_t *)(buffer->encr_xts_du_size)) =
 							creq->cryptlen;
 
 		}
@@ -505,6 +505,7 @@ static int start_cipher_req(struct qcedev_control *podev)
 	creq.encklen = qcedev_areq->cipher_op_req.encklen;
 
 	creq.cryptlen = qcedev_areq->cipher_op_req.data_len;
+	creq.xts_du_size = 0;
 
 	if (qcedev_areq->cipher_op_req.encklen == 0) {
 		if ((qcedev_areq->cipher_op_req.op == QCEDEV_OPER_ENC_NO_KEY)
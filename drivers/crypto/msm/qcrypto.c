@@ -24,6 +24,11 @@
 #include <linux/interrupt.h>
 #include <linux/spinlock.h>
 #include <linux/debugfs.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/rcupdate.h>
+#include <linux/workqueue.h>
+#include <asm/unaligned.h>
 
 #include <crypto/ctr.h>
 #include <crypto/des.h>
@@ -44,7 +49,16 @@
 
 #define MAX_CRYPTO_DEVICE 3
 #define DEBUG_MAX_FNAME  16
-#define DEBUG_MAX_RW_BUF 1024
+#define DEBUG_MAX_RW_BUF 2048
+
+#define QCRYPTO_MAX_BATCH	16
+#define QCRYPTO_BATCH_MAX_SG	64
+#define QCRYPTO_BATCH_MAX_BYTES	(32 * 1024)
+
+static bool _qcrypto_dispatch;
+module_param_named(dispatch, _qcrypto_dispatch, bool, 0444);
+MODULE_PARM_DESC(dispatch,
+	"Route each cipher request to the engine or the CPU by latency");
 
 struct crypto_stat {
 	u32 aead_sha1_aes_enc;
@@ -71,6 +85,11 @@ struct crypto_stat {
 	u32 sha256_hmac_digest;
 	u32 sha_hmac_op_success;
 	u32 sha_hmac_op_fail;
+	u32 ablk_cipher_batches;
+	u32 ablk_cipher_batched_reqs;
+	u32 engine_reqs;
+	u64 engine_bytes;
+	u64 engine_busy_us;
 };
 static struct crypto_stat _qcrypto_stat[MAX_CRYPTO_DEVICE];
 static struct dentry *_debug_dent;
@@ -108,17 +127,36 @@ struct crypto_priv {
 
 	struct work_struct unlock_ce_ws;
 
+	bool foreign_bw;
+	unsigned long foreign_last;
+	struct work_struct foreign_bw_up_ws;
+	struct delayed_work foreign_bw_down_ws;
+
 	struct tasklet_struct done_tasklet;
+
+	
+	ktime_t busy_since;
+
+	
+	struct crypto_async_request *batch[QCRYPTO_MAX_BATCH];
+	int batch_cnt;
+	struct ablkcipher_request *batch_req;
+	struct scatterlist batch_src[QCRYPTO_BATCH_MAX_SG];
+	struct scatterlist batch_dst[QCRYPTO_BATCH_MAX_SG];
 };
 
+static struct crypto_priv *_qcrypto_engines[MAX_CRYPTO_DEVICE];
+
 
 #define QCRYPTO_CMD_ID				1
 #define QCRYPTO_CE_LOCK_CMD			1
 #define QCRYPTO_CE_UNLOCK_CMD			0
 #define NUM_RETRY				1000
 #define CE_BUSY				        55
+#define QCRYPTO_FOREIGN_BW_HOLD			(HZ / 2)
 
 static DEFINE_MUTEX(sent_bw_req);
+static DEFINE_MUTEX(qcrypto_engines_lock);
 
 static int qcrypto_scm_cmd(int resource, int cmd, int *response)
 {
@@ -211,6 +249,7 @@ struct qcrypto_cipher_ctx {
 	unsigned int auth_key_len;
 
 	struct crypto_priv *cp;
+	unsigned long engines;
 };
 
 struct qcrypto_cipher_req_ctx {
@@ -224,6 +263,7 @@ struct qcrypto_cipher_req_ctx {
 	enum qce_cipher_alg_enum alg;
 	enum qce_cipher_dir_enum dir;
 	enum qce_cipher_mode_enum mode;
+	struct crypto_priv *cp;
 };
 
 #define SHA_MAX_BLOCK_SIZE      SHA256_BLOCK_SIZE
@@ -350,6 +390,45 @@ static void qcrypto_ce_high_bw_req(struct crypto_priv *cp, bool high_bw_req)
 	mutex_unlock(&sent_bw_req);
 }
 
+static void qcrypto_foreign_bw_up(struct work_struct *work)
+{
+	struct crypto_priv *cp = container_of(work, struct crypto_priv,
+							foreign_bw_up_ws);
+	unsigned long flags;
+
+	if (ACCESS_ONCE(cp->foreign_bw))
+		return;
+	qcrypto_ce_high_bw_req(cp, true);
+	spin_lock_irqsave(&cp->lock, flags);
+	cp->foreign_bw = true;
+	cp->foreign_last = jiffies;
+	spin_unlock_irqrestore(&cp->lock, flags);
+	queue_delayed_work(system_nrt_wq, &cp->foreign_bw_down_ws,
+					QCRYPTO_FOREIGN_BW_HOLD);
+}
+
+static void qcrypto_foreign_bw_down(struct work_struct *work)
+{
+	struct crypto_priv *cp = container_of(to_delayed_work(work),
+					struct crypto_priv, foreign_bw_down_ws);
+	unsigned long flags;
+	bool idle;
+
+	spin_lock_irqsave(&cp->lock, flags);
+	idle = (cp->req == NULL) && (cp->queue.qlen == 0) &&
+		time_after_eq(jiffies,
+				cp->foreign_last + QCRYPTO_FOREIGN_BW_HOLD);
+	if (idle)
+		cp->foreign_bw = false;
+	spin_unlock_irqrestore(&cp->lock, flags);
+
+	if (idle)
+		qcrypto_ce_high_bw_req(cp, false);
+	else
+		queue_delayed_work(system_nrt_wq, &cp->foreign_bw_down_ws,
+					QCRYPTO_FOREIGN_BW_HOLD);
+}
+
 static void _start_qcrypto_process(struct crypto_priv *cp);
 
 static struct qcrypto_alg *_qcrypto_sha_alg_alloc(struct crypto_priv *cp,
@@ -498,10 +577,43 @@ static int _qcrypto_ahash_hmac_cra_init(struct crypto_tfm *tfm)
 	return 0;
 };
 
+static bool _qcrypto_engine_compatible(struct crypto_priv *cp,
+					struct crypto_priv *other)
+{
+	if ((other == NULL) || (other == cp))
+		return false;
+	if (cp->platform_support.ce_shared ||
+				other->platform_support.ce_shared)
+		return false;
+	if (cp->platform_support.hw_key_support !=
+				other->platform_support.hw_key_support)
+		return false;
+	return memcmp(&cp->ce_support, &other->ce_support,
+					sizeof(cp->ce_support)) == 0;
+}
+
 static int _qcrypto_cra_ablkcipher_init(struct crypto_tfm *tfm)
 {
+	struct qcrypto_cipher_ctx *ctx = crypto_tfm_ctx(tfm);
+	struct crypto_priv *other;
+	int ret;
+	int i;
+
 	tfm->crt_ablkcipher.reqsize = sizeof(struct qcrypto_cipher_req_ctx);
-	return _qcrypto_cipher_cra_init(tfm);
+	ret = _qcrypto_cipher_cra_init(tfm);
+	if (ret)
+		return ret;
+
+	
+	ctx->engines = BIT(ctx->cp->pdev->id);
+	mutex_lock(&qcrypto_engines_lock);
+	for (i = 0; i < MAX_CRYPTO_DEVICE; i++) {
+		other = _qcrypto_engines[i];
+		if (_qcrypto_engine_compatible(ctx->cp, other))
+			ctx->engines |= BIT(i);
+	}
+	mutex_unlock(&qcrypto_engines_lock);
+	return 0;
 };
 
 static int _qcrypto_cra_aead_init(struct crypto_tfm *tfm)
@@ -616,6 +728,26 @@ static int _disp_stats(int id)
 	len += snprintf(_debug_read_buf + len, DEBUG_MAX_RW_BUF - len - 1,
 			"   SHA HMAC operation success          : %d\n",
 					pstat->sha_hmac_op_success);
+	len += snprintf(_debug_read_buf + len, DEBUG_MAX_RW_BUF - len - 1,
+			"   ABLK CIPHER batches          : %d\n",
+					pstat->ablk_cipher_batches);
+	len += snprintf(_debug_read_buf + len, DEBUG_MAX_RW_BUF - len - 1,
+			"   ABLK CIPHER batched requests : %d\n",
+					pstat->ablk_cipher_batched_reqs);
+	len += snprintf(_debug_read_buf + len, DEBUG_MAX_RW_BUF - len - 1,
+			"   Engine requests              : %d\n",
+					pstat->engine_reqs);
+	len += snprintf(_debug_read_buf + len, DEBUG_MAX_RW_BUF - len - 1,
+			"   Engine bytes                 : %llu\n",
+					pstat->engine_bytes);
+	len += snprintf(_debug_read_buf + len, DEBUG_MAX_RW_BUF - len - 1,
+			"   Engine busy time (us)        : %llu\n",
+					pstat->engine_busy_us);
+	len += snprintf(_debug_read_buf + len, DEBUG_MAX_RW_BUF - len - 1,
+			"   Engine throughput (KB/s)     : %llu\n",
+			pstat->engine_busy_us ?
+			div64_u64((pstat->engine_bytes >> 10) * USEC_PER_SEC,
+					pstat->engine_busy_us) : 0);
 	return len;
 }
 
@@ -630,6 +762,15 @@ static int _qcrypto_remove(struct platform_device *pdev)
 	if (!cp)
 		return 0;
 
+	mutex_lock(&qcrypto_engines_lock);
+	if (_qcrypto_engines[pdev->id] == cp)
+		rcu_assign_pointer(_qcrypto_engines[pdev->id], NULL);
+	mutex_unlock(&qcrypto_engines_lock);
+	synchronize_rcu();
+
+	cancel_work_sync(&cp->foreign_bw_up_ws);
+	cancel_delayed_work_sync(&cp->foreign_bw_down_ws);
+
 	if (cp->platform_support.bus_scale_table != NULL)
 		msm_bus_scale_unregister_client(cp->bus_scale_handle);
 
@@ -645,6 +786,7 @@ static int _qcrypto_remove(struct platform_device *pdev)
 	if (cp->qce)
 		qce_close(cp->qce);
 	tasklet_kill(&cp->done_tasklet);
+	kfree(cp->batch_req);
 	kfree(cp);
 	return 0;
 };
@@ -713,16 +855,32 @@ static int _qcrypto_setkey_3des(struct crypto_ablkcipher *cipher, const u8 *key,
 static void req_done(unsigned long data)
 {
 	struct crypto_async_request *areq;
+	struct crypto_async_request *batch[QCRYPTO_MAX_BATCH];
 	struct crypto_priv *cp = (struct crypto_priv *)data;
+	struct crypto_stat *pstat;
 	unsigned long flags;
+	int res;
+	int n;
+	int i;
+
+	pstat = &_qcrypto_stat[cp->pdev->id];
 
 	spin_lock_irqsave(&cp->lock, flags);
 	areq = cp->req;
 	cp->req = NULL;
+	res = cp->res;
+	n = cp->batch_cnt;
+	memcpy(batch, cp->batch, n * sizeof(batch[0]));
+	cp->batch_cnt = 0;
 	spin_unlock_irqrestore(&cp->lock, flags);
 
-	if (areq)
-		areq->complete(areq, cp->res);
+	if (areq) {
+		pstat->engine_busy_us += ktime_us_delta(ktime_get(),
+							cp->busy_since);
+		areq->complete(areq, res);
+	}
+	for (i = 0; i < n; i++)
+		batch[i]->complete(batch[i], res);
 	_start_qcrypto_process(cp);
 };
 
@@ -826,7 +984,8 @@ static void _qce_ablk_cipher_complete(void *cookie, unsigned char *icb,
 	struct ablkcipher_request *areq = (struct ablkcipher_request *) cookie;
 	struct crypto_ablkcipher *ablk = crypto_ablkcipher_reqtfm(areq);
 	struct qcrypto_cipher_ctx *ctx = crypto_tfm_ctx(areq->base.tfm);
-	struct crypto_priv *cp = ctx->cp;
+	struct qcrypto_cipher_req_ctx *rctx = ablkcipher_request_ctx(areq);
+	struct crypto_priv *cp = rctx->cp;
 	struct crypto_stat *pstat;
 
 	pstat = &_qcrypto_stat[cp->pdev->id];
@@ -984,14 +1143,193 @@ static int qcrypto_aead_ccm_format_adata(struct qce_req *qreq, uint32_t alen,
 	return 0;
 }
 
+static int _qcrypto_sg_count(struct scatterlist *sg, unsigned int nbytes)
+{
+	int nents = 0;
+
+	while ((nbytes > 0) && sg) {
+		nents++;
+		nbytes -= min(nbytes, sg->length);
+		sg = sg_next(sg);
+	}
+	return nents;
+}
+
+static int _qcrypto_batch_sg(struct scatterlist *tbl, int n,
+			struct scatterlist *sg, unsigned int nbytes)
+{
+	unsigned int len;
+
+	while (nbytes > 0) {
+		len = min(nbytes, sg->length);
+		sg_set_page(&tbl[n++], sg_page(sg), len, sg->offset);
+		nbytes -= len;
+		sg = sg_next(sg);
+	}
+	return n;
+}
+
+static bool _qcrypto_iv_follows(struct ablkcipher_request *prev,
+				struct ablkcipher_request *req,
+				enum qce_cipher_mode_enum mode)
+{
+	u8 *piv = prev->info;
+	u8 *iv = req->info;
+	u32 blocks;
+	u32 ctr;
+	u64 tweak;
+
+	switch (mode) {
+	case QCE_MODE_ECB:
+		return true;
+	case QCE_MODE_CTR:
+		
+		if (memcmp(piv, iv, AES_BLOCK_SIZE - sizeof(u32)))
+			return false;
+		blocks = prev->nbytes / AES_BLOCK_SIZE;
+		ctr = get_unaligned_be32(piv + AES_BLOCK_SIZE - sizeof(u32));
+		if (ctr + blocks < ctr)
+			return false;
+		return get_unaligned_be32(iv + AES_BLOCK_SIZE - sizeof(u32)) ==
+							ctr + blocks;
+	case QCE_MODE_XTS:
+		
+		if (req->nbytes != prev->nbytes)
+			return false;
+		if (memcmp(piv + sizeof(u64), iv + sizeof(u64),
+					AES_BLOCK_SIZE - sizeof(u64)))
+			return false;
+		tweak = get_unaligned_le64(piv);
+		if (tweak + 1 == 0)
+			return false;
+		return get_unaligned_le64(iv) == tweak + 1;
+	default:
+		return false;
+	}
+}
+
+static int _qcrypto_batch_collect(struct crypto_priv *cp,
+			struct ablkcipher_request *lead,
+			struct crypto_async_request **backlogs)
+{
+	struct qcrypto_cipher_req_ctx *lrctx = ablkcipher_request_ctx(lead);
+	struct qcrypto_cipher_req_ctx *rctx;
+	struct ablkcipher_request *prev = lead;
+	struct ablkcipher_request *req;
+	struct crypto_async_request *next;
+	struct crypto_async_request *backlog;
+	unsigned int bs = crypto_tfm_alg_blocksize(lead->base.tfm);
+	unsigned int total = lead->nbytes;
+	bool inplace = (lead->src == lead->dst);
+	int nsrc, ndst, n, m;
+	int nbl = 0;
+
+	switch (lrctx->mode) {
+	case QCE_MODE_ECB:
+	case QCE_MODE_CTR:
+		break;
+	case QCE_MODE_XTS:
+		if (lead->nbytes % AES_BLOCK_SIZE)
+			return 0;
+		break;
+	default:
+		return 0;
+	}
+
+	nsrc = _qcrypto_sg_count(lead->src, lead->nbytes);
+	ndst = inplace ? 0 : _qcrypto_sg_count(lead->dst, lead->nbytes);
+
+	while ((cp->batch_cnt < QCRYPTO_MAX_BATCH) &&
+				!list_empty(&cp->queue.list)) {
+		next = list_first_entry(&cp->queue.list,
+				struct crypto_async_request, list);
+		if (next->tfm != lead->base.tfm)
+			break;
+		req = ablkcipher_request_cast(next);
+		rctx = ablkcipher_request_ctx(req);
+		if ((rctx->dir != lrctx->dir) || (rctx->mode != lrctx->mode))
+			break;
+		if ((req->src == req->dst) != inplace)
+			break;
+		if ((prev->nbytes % bs) ||
+			(total + req->nbytes > QCRYPTO_BATCH_MAX_BYTES))
+			break;
+		if (!_qcrypto_iv_follows(prev, req, lrctx->mode))
+			break;
+		n = _qcrypto_sg_count(req->src, req->nbytes);
+		m = inplace ? 0 : _qcrypto_sg_count(req->dst, req->nbytes);
+		if ((nsrc + n > QCRYPTO_BATCH_MAX_SG) ||
+				(ndst + m > QCRYPTO_BATCH_MAX_SG))
+			break;
+
+		backlog = crypto_get_backlog(&cp->queue);
+		crypto_dequeue_request(&cp->queue);
+		if (backlog)
+			backlogs[nbl++] = backlog;
+		cp->batch[cp->batch_cnt++] = next;
+		nsrc += n;
+		ndst += m;
+		total += req->nbytes;
+		prev = req;
+	}
+	return nbl;
+}
+
+static struct ablkcipher_request *_qcrypto_batch_prepare(
+			struct crypto_priv *cp, struct ablkcipher_request *lead)
+{
+	struct ablkcipher_request *breq = cp->batch_req;
+	struct ablkcipher_request *req;
+	bool inplace = (lead->src == lead->dst);
+	int nsrc;
+	int ndst = 0;
+	int i;
+
+	sg_init_table(cp->batch_src, QCRYPTO_BATCH_MAX_SG);
+	nsrc = _qcrypto_batch_sg(cp->batch_src, 0, lead->src, lead->nbytes);
+	if (!inplace) {
+		sg_init_table(cp->batch_dst, QCRYPTO_BATCH_MAX_SG);
+		ndst = _qcrypto_batch_sg(cp->batch_dst, 0, lead->dst,
+							lead->nbytes);
+	}
+	breq->nbytes = lead->nbytes;
+
+	for (i = 0; i < cp->batch_cnt; i++) {
+		req = ablkcipher_request_cast(cp->batch[i]);
+		nsrc = _qcrypto_batch_sg(cp->batch_src, nsrc, req->src,
+							req->nbytes);
+		if (!inplace)
+			ndst = _qcrypto_batch_sg(cp->batch_dst, ndst,
+						req->dst, req->nbytes);
+		breq->nbytes += req->nbytes;
+	}
+
+	sg_mark_end(&cp->batch_src[nsrc - 1]);
+	breq->src = cp->batch_src;
+	if (inplace) {
+		breq->dst = cp->batch_src;
+	} else {
+		sg_mark_end(&cp->batch_dst[ndst - 1]);
+		breq->dst = cp->batch_dst;
+	}
+	breq->info = lead->info;
+	breq->base.tfm = lead->base.tfm;
+	breq->base.flags = lead->base.flags;
+	return breq;
+}
+
 static void _start_qcrypto_process(struct crypto_priv *cp)
 {
 	struct crypto_async_request *async_req = NULL;
 	struct crypto_async_request *backlog = NULL;
+	struct crypto_async_request *batch[QCRYPTO_MAX_BATCH];
 	unsigned long flags;
 	u32 type;
 	struct qce_req qreq;
 	int ret;
+	int nbl = 0;
+	int n;
+	int i;
 	struct qcrypto_cipher_req_ctx *rctx;
 	struct qcrypto_cipher_ctx *cipher_ctx;
 	struct qcrypto_sha_ctx *sha_ctx;
@@ -1000,18 +1338,30 @@ static void _start_qcrypto_process(struct crypto_priv *cp)
 	pstat = &_qcrypto_stat[cp->pdev->id];
 
 again:
+	async_req = NULL;
+	backlog = NULL;
 	spin_lock_irqsave(&cp->lock, flags);
 	if (cp->req == NULL) {
 		backlog = crypto_get_backlog(&cp->queue);
 		async_req = crypto_dequeue_request(&cp->queue);
 		cp->req = async_req;
+		cp->batch_cnt = 0;
+		if (async_req && (crypto_tfm_alg_type(async_req->tfm) ==
+					CRYPTO_ALG_TYPE_ABLKCIPHER))
+			nbl = _qcrypto_batch_collect(cp,
+					ablkcipher_request_cast(async_req),
+					batch);
 	}
 	spin_unlock_irqrestore(&cp->lock, flags);
 	if (!async_req)
 		return;
 	if (backlog)
 		backlog->complete(backlog, -EINPROGRESS);
+	for (i = 0; i < nbl; i++)
+		batch[i]->complete(batch[i], -EINPROGRESS);
+	nbl = 0;
 	type = crypto_tfm_alg_type(async_req->tfm);
+	cp->busy_since = ktime_get();
 
 	if (type == CRYPTO_ALG_TYPE_ABLKCIPHER) {
 		struct ablkcipher_request *req;
@@ -1033,8 +1383,22 @@ again:
 		qreq.iv = req->info;
 		qreq.ivsize = crypto_ablkcipher_ivsize(tfm);
 		qreq.cryptlen = req->nbytes;
+		qreq.xts_du_size = 0;
 		qreq.use_pmem = 0;
 
+		if (cp->batch_cnt) {
+			
+			if (rctx->mode == QCE_MODE_XTS)
+				qreq.xts_du_size = req->nbytes;
+			req = _qcrypto_batch_prepare(cp, req);
+			qreq.areq = req;
+			qreq.cryptlen = req->nbytes;
+			pstat->ablk_cipher_batches++;
+			pstat->ablk_cipher_batched_reqs += cp->batch_cnt + 1;
+		}
+		pstat->engine_reqs += cp->batch_cnt + 1;
+		pstat->engine_bytes += qreq.cryptlen;
+
 		if ((cipher_ctx->enc_key_len == 0) &&
 				(cp->platform_support.hw_key_support == 0))
 			ret = -EINVAL;
@@ -1061,6 +1425,8 @@ again:
 			sreq.last_blk = sha_ctx->last_blk;
 			sreq.size = req->nbytes;
 			sreq.areq = req;
+			pstat->engine_reqs++;
+			pstat->engine_bytes += req->nbytes;
 
 			switch (sha_ctx->alg) {
 			case QCE_HASH_SHA1:
@@ -1132,6 +1498,8 @@ again:
 							req->assoclen);
 				sg_mark_end(req->assoc);
 			}
+			pstat->engine_reqs++;
+			pstat->engine_bytes += req->cryptlen;
 			ret =  qce_aead_req(cp->qce, &qreq);
 		}
 	};
@@ -1140,6 +1508,9 @@ done:
 
 		spin_lock_irqsave(&cp->lock, flags);
 		cp->req = NULL;
+		n = cp->batch_cnt;
+		memcpy(batch, cp->batch, n * sizeof(batch[0]));
+		cp->batch_cnt = 0;
 		spin_unlock_irqrestore(&cp->lock, flags);
 
 		if (type == CRYPTO_ALG_TYPE_ABLKCIPHER)
@@ -1151,16 +1522,81 @@ done:
 				pstat->aead_op_fail++;
 
 		async_req->complete(async_req, ret);
+		for (i = 0; i < n; i++)
+			batch[i]->complete(batch[i], ret);
 		goto again;
 	};
 };
 
+static unsigned int _qcrypto_engine_load(struct crypto_priv *cp)
+{
+	return ACCESS_ONCE(cp->queue.qlen) +
+			(ACCESS_ONCE(cp->req) != NULL ? 1 : 0);
+}
+
+static struct crypto_priv *_qcrypto_select_engine(
+					struct qcrypto_cipher_ctx *ctx)
+{
+	struct crypto_priv *best = ctx->cp;
+	struct crypto_priv *cp;
+	unsigned int best_load;
+	unsigned int load;
+	int i;
+
+	
+	if ((ctx->engines == BIT(ctx->cp->pdev->id)) ||
+					(ctx->enc_key_len == 0))
+		return ctx->cp;
+
+	best_load = _qcrypto_engine_load(best);
+	for_each_set_bit(i, &ctx->engines, MAX_CRYPTO_DEVICE) {
+		cp = rcu_dereference(_qcrypto_engines[i]);
+		if ((cp == NULL) || (cp == ctx->cp))
+			continue;
+		if (!ACCESS_ONCE(cp->foreign_bw)) {
+			queue_work(system_nrt_wq, &cp->foreign_bw_up_ws);
+			continue;
+		}
+		load = _qcrypto_engine_load(cp);
+		if (load < best_load) {
+			best = cp;
+			best_load = load;
+		}
+	}
+	return best;
+}
+
 static int _qcrypto_queue_req(struct crypto_priv *cp,
 				struct crypto_async_request *req)
 {
 	int ret;
 	unsigned long flags;
 
+	if (crypto_tfm_alg_type(req->tfm) == CRYPTO_ALG_TYPE_ABLKCIPHER) {
+		struct qcrypto_cipher_ctx *ctx = crypto_tfm_ctx(req->tfm);
+		struct qcrypto_cipher_req_ctx *rctx;
+
+		rctx = ablkcipher_request_ctx(ablkcipher_request_cast(req));
+		rcu_read_lock();
+		cp = _qcrypto_select_engine(ctx);
+		if (cp != ctx->cp) {
+			spin_lock_irqsave(&cp->lock, flags);
+			if (cp->foreign_bw) {
+				cp->foreign_last = jiffies;
+				rctx->cp = cp;
+				ret = crypto_enqueue_request(&cp->queue, req);
+				spin_unlock_irqrestore(&cp->lock, flags);
+				_start_qcrypto_process(cp);
+				rcu_read_unlock();
+				return ret;
+			}
+			spin_unlock_irqrestore(&cp->lock, flags);
+			cp = ctx->cp;
+		}
+		rcu_read_unlock();
+		rctx->cp = cp;
+	}
+
 	if (cp->platform_support.ce_shared) {
 		ret = qcrypto_lock_ce(cp);
 		if (ret)
@@ -3020,6 +3456,41 @@ static struct crypto_alg _qcrypto_aead_ccm_algo = {
 	}
 };
 
+static void _qcrypto_dispatch_init(struct crypto_priv *cp)
+{
+	char name[CRYPTO_MAX_ALG_NAME];
+	struct qcrypto_alg *q_alg;
+
+	list_for_each_entry(q_alg, &cp->alg_list, entry) {
+		struct crypto_alg *alg = &q_alg->cipher_alg;
+		struct crypto_ablkcipher *tfm;
+
+		if (q_alg->alg_type != QCRYPTO_ALG_CIPHER ||
+		    (alg->cra_flags & CRYPTO_ALG_TYPE_MASK) !=
+					CRYPTO_ALG_TYPE_ABLKCIPHER)
+			continue;
+
+		
+		tfm = crypto_alloc_ablkcipher(alg->cra_name, 0,
+					      CRYPTO_ALG_ASYNC);
+		if (IS_ERR(tfm))
+			continue;
+		snprintf(name, sizeof(name), "dispatch(%s,%s)",
+			 alg->cra_driver_name,
+			 crypto_tfm_alg_driver_name(crypto_ablkcipher_tfm(tfm)));
+		crypto_free_ablkcipher(tfm);
+
+		
+		tfm = crypto_alloc_ablkcipher(name, 0, 0);
+		if (IS_ERR(tfm)) {
+			dev_warn(&cp->pdev->dev, "%s instantiation failed %ld\n",
+					name, PTR_ERR(tfm));
+			continue;
+		}
+		crypto_free_ablkcipher(tfm);
+		dev_info(&cp->pdev->dev, "%s\n", name);
+	}
+}
 
 static int  _qcrypto_probe(struct platform_device *pdev)
 {
@@ -3028,6 +3499,7 @@ static int  _qcrypto_probe(struct platform_device *pdev)
 	struct crypto_priv *cp;
 	int i;
 	struct msm_ce_hw_support *platform_support;
+	struct qcrypto_cipher_req_ctx *batch_rctx;
 
 	if (pdev->id >= MAX_CRYPTO_DEVICE) {
 		pr_err("%s: device id %d  exceeds allowed %d\n",
@@ -3053,6 +3525,8 @@ static int  _qcrypto_probe(struct platform_device *pdev)
 	INIT_LIST_HEAD(&cp->alg_list);
 	platform_set_drvdata(pdev, cp);
 	spin_lock_init(&cp->lock);
+	INIT_WORK(&cp->foreign_bw_up_ws, qcrypto_foreign_bw_up);
+	INIT_DELAYED_WORK(&cp->foreign_bw_down_ws, qcrypto_foreign_bw_down);
 	tasklet_init(&cp->done_tasklet, req_done, (unsigned long)cp);
 	crypto_init_queue(&cp->queue, 50);
 	cp->qce = handle;
@@ -3066,6 +3540,7 @@ static int  _qcrypto_probe(struct platform_device *pdev)
 				platform_support->hw_key_support;
 	cp->platform_support.bus_scale_table =
 				platform_support->bus_scale_table;
+	cp->foreign_bw = (cp->platform_support.bus_scale_table == NULL);
 	cp->high_bw_req_count = 0;
 	cp->ce_lock_count = 0;
 	cp->platform_support.sha_hmac = platform_support->sha_hmac;
@@ -3073,6 +3548,15 @@ static int  _qcrypto_probe(struct platform_device *pdev)
 	if (cp->platform_support.ce_shared)
 		INIT_WORK(&cp->unlock_ce_ws, qcrypto_unlock_ce);
 
+	cp->batch_req = kzalloc(sizeof(struct ablkcipher_request) +
+			sizeof(struct qcrypto_cipher_req_ctx), GFP_KERNEL);
+	if (!cp->batch_req) {
+		rc = -ENOMEM;
+		goto err;
+	}
+	batch_rctx = ablkcipher_request_ctx(cp->batch_req);
+	batch_rctx->cp = cp;
+
 	if (cp->platform_support.bus_scale_table != NULL) {
 		cp->bus_scale_handle =
 			msm_bus_scale_register_client(
@@ -3225,6 +3709,13 @@ static int  _qcrypto_probe(struct platform_device *pdev)
 		}
 	}
 
+	mutex_lock(&qcrypto_engines_lock);
+	rcu_assign_pointer(_qcrypto_engines[pdev->id], cp);
+	mutex_unlock(&qcrypto_engines_lock);
+
+	if (_qcrypto_dispatch)
+		_qcrypto_dispatch_init(cp);
+
 	return 0;
 err:
 	_qcrypto_remove(pdev);
@@ -34,6 +34,8 @@
 #include <linux/debugfs.h>
 #include <linux/dma-buf.h>
 #include <linux/msm_ion.h>
+#include <linux/freezer.h>
+#include <linux/kthread.h>
 
 #include <mach/iommu_domains.h>
 #include "ion_priv.h"
@@ -50,6 +52,9 @@ struct ion_device {
 	struct dentry *debug_root;
 };
 
+static bool ion_defer_free = true;
+module_param_named(defer_free, ion_defer_free, bool, 0444);
+
 struct ion_client {
 	struct rb_node node;
 	struct ion_device *dev;
@@ -238,22 +243,139 @@ static void ion_iommu_delayed_unmap(struct ion_buffer *buffer)
 	mutex_unlock(&buffer->lock);
 }
 
-static void ion_buffer_destroy(struct kref *kref)
+static void ion_buffer_release(struct ion_buffer *buffer)
 {
-	struct ion_buffer *buffer = container_of(kref, struct ion_buffer, ref);
-	struct ion_device *dev = buffer->dev;
-
 	if (WARN_ON(buffer->kmap_cnt > 0))
 		buffer->heap->ops->unmap_kernel(buffer->heap, buffer);
 
 	buffer->heap->ops->unmap_dma(buffer->heap, buffer);
 
 	ion_iommu_delayed_unmap(buffer);
+	buffer->heap->ops->free(buffer);
+	kfree(buffer);
+}
+
+static void ion_heap_freelist_add(struct ion_heap *heap,
+				  struct ion_buffer *buffer)
+{
+	spin_lock(&heap->free_lock);
+	list_add_tail(&buffer->list, &heap->free_list);
+	heap->free_list_size += buffer->size;
+	spin_unlock(&heap->free_lock);
+	wake_up(&heap->waitqueue);
+}
+
+static size_t ion_heap_freelist_size(struct ion_heap *heap)
+{
+	size_t size;
+
+	spin_lock(&heap->free_lock);
+	size = heap->free_list_size;
+	spin_unlock(&heap->free_lock);
+
+	return size;
+}
+
+/*
+ * Release queued buffers until at least @size bytes are freed, or all of
+ * them when @size is 0.  When called from the shrinker (@shrink set), the
+ * pages go straight back to the page allocator instead of the heap's page
+ * pools, and buffers still mapped into an IOMMU domain are left to the
+ * free thread, since unmapping them takes IOMMU driver locks that may be
+ * held by the allocating task.
+ */
+size_t ion_heap_freelist_drain(struct ion_heap *heap, size_t size, bool shrink)
+{
+	struct ion_buffer *buffer, *found;
+	size_t drained = 0;
+
+	while (!size || drained < size) {
+		found = NULL;
+		spin_lock(&heap->free_lock);
+		list_for_each_entry(buffer, &heap->free_list, list) {
+			if (shrink && !RB_EMPTY_ROOT(&buffer->iommu_maps))
+				continue;
+			found = buffer;
+			list_del(&buffer->list);
+			heap->free_list_size -= buffer->size;
+			break;
+		}
+		spin_unlock(&heap->free_lock);
+		if (!found)
+			break;
+		drained += found->size;
+		if (shrink)
+			found->private_flags |= ION_PRIV_FLAG_SHRINKER_FREE;
+		ion_buffer_release(found);
+	}
+
+	return drained;
+}
+
+static int ion_heap_deferred_free(void *data)
+{
+	struct ion_heap *heap = data;
+
+	set_freezable();
+	while (!kthread_should_stop()) {
+		wait_event_freezable(heap->waitqueue,
+				     ion_heap_freelist_size(heap) > 0 ||
+				     kthread_should_stop());
+		ion_heap_freelist_drain(heap, 0, false);
+	}
+
+	return 0;
+}
+
+static int ion_heap_shrink(struct shrinker *shrinker,
+			   struct shrink_control *sc)
+{
+	struct ion_heap *heap = container_of(shrinker, struct ion_heap,
+					     shrinker);
+
+	if (sc->nr_to_scan)
+		ion_heap_freelist_drain(heap, sc->nr_to_scan * PAGE_SIZE, true);
+
+	return ion_heap_freelist_size(heap) / PAGE_SIZE;
+}
+
+static int ion_heap_init_deferred_free(struct ion_heap *heap)
+{
+	struct sched_param param = { .sched_priority = 0 };
+
+	INIT_LIST_HEAD(&heap->free_list);
+	heap->free_list_size = 0;
+	spin_lock_init(&heap->free_lock);
+	init_waitqueue_head(&heap->waitqueue);
+	heap->task = kthread_run(ion_heap_deferred_free, heap,
+				 "ion_free_%s", heap->name);
+	if (IS_ERR(heap->task)) {
+		pr_err("%s: creating thread for deferred free failed\n",
+		       __func__);
+		return PTR_RET(heap->task);
+	}
+	sched_setscheduler(heap->task, SCHED_IDLE, &param);
+
+	heap->shrinker.shrink = ion_heap_shrink;
+	heap->shrinker.seeks = DEFAULT_SEEKS;
+	register_shrinker(&heap->shrinker);
+	return 0;
+}
+
+static void ion_buffer_destroy(struct kref *kref)
+{
+	struct ion_buffer *buffer = container_of(kref, struct ion_buffer, ref);
+	struct ion_device *dev = buffer->dev;
+	struct ion_heap *heap = buffer->heap;
+
 	mutex_lock(&dev->lock);
 	rb_erase(&buffer->node, &dev->buffers);
 	mutex_unlock(&dev->lock);
-	buffer->heap->ops->free(buffer);
-	kfree(buffer);
+
+	if (heap->flags & ION_HEAP_FLAG_DEFER_FREE)
+		ion_heap_freelist_add(heap, buffer);
+	else
+		ion_buffer_release(buffer);
 }
 
 static void ion_buffer_get(struct ion_buffer *buffer)
@@ -378,6 +500,8 @@ struct ion_handle *ion_alloc(struct ion_client *client, size_t len,
 	struct ion_handle *handle;
 	struct ion_device *dev = client->dev;
 	struct ion_buffer *buffer = NULL;
+	struct ion_heap *drain_heap = NULL;
+	bool drained = false;
 	unsigned long secure_allocation = flags & ION_SECURE;
 	const unsigned int MAX_DBG_STR_LEN = 64;
 	char dbg_str[MAX_DBG_STR_LEN];
@@ -390,6 +514,9 @@ struct ion_handle *ion_alloc(struct ion_client *client, size_t len,
 
 	len = PAGE_ALIGN(len);
 
+retry:
+	dbg_str[0] = '\0';
+	dbg_str_idx = 0;
 	mutex_lock(&dev->lock);
 	for (n = rb_first(&dev->heaps); n != NULL; n = rb_next(n)) {
 		struct ion_heap *heap = rb_entry(n, struct ion_heap, node);
@@ -405,6 +532,9 @@ struct ion_handle *ion_alloc(struct ion_client *client, size_t len,
 		buffer = ion_buffer_create(heap, dev, len, align, flags);
 		if (!IS_ERR_OR_NULL(buffer))
 			break;
+		if (PTR_ERR(buffer) == -ENOMEM && !drain_heap &&
+		    (heap->flags & ION_HEAP_FLAG_DEFER_FREE))
+			drain_heap = heap;
 		if (dbg_str_idx < MAX_DBG_STR_LEN) {
 			unsigned int len_left = MAX_DBG_STR_LEN-dbg_str_idx-1;
 			int ret_value = snprintf(&dbg_str[dbg_str_idx],
@@ -423,6 +553,12 @@ struct ion_handle *ion_alloc(struct ion_client *client, size_t len,
 	}
 	mutex_unlock(&dev->lock);
 
+	if (IS_ERR(buffer) && drain_heap && !drained) {
+		drained = true;
+		if (ion_heap_freelist_drain(drain_heap, 0, false))
+			goto retry;
+	}
+
 	if (buffer == NULL)
 		return ERR_PTR(-ENODEV);
 
@@ -1590,6 +1726,9 @@ static int ion_debug_heap_show(struct seq_file *s, void *unused)
 				   client->pid, size);
 		}
 	}
+	if (heap->flags & ION_HEAP_FLAG_DEFER_FREE)
+		seq_printf(s, "deferred free bytes queued: %zu\n",
+			   ion_heap_freelist_size(heap));
 	ion_heap_print_debug(s, heap);
 	mutex_unlock(&dev->lock);
 	return 0;
@@ -1619,6 +1758,12 @@ void ion_device_add_heap(struct ion_device *dev, struct ion_heap *heap)
 		       __func__);
 
 	heap->dev = dev;
+	if (!ion_defer_free)
+		heap->flags &= ~ION_HEAP_FLAG_DEFER_FREE;
+	if ((heap->flags & ION_HEAP_FLAG_DEFER_FREE) &&
+	    ion_heap_init_deferred_free(heap))
+		heap->flags &= ~ION_HEAP_FLAG_DEFER_FREE;
+
 	mutex_lock(&dev->lock);
 	while (*p) {
 		parent = *p;
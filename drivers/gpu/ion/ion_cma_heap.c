@@ -0,0 +1,420 @@
+/*
+ * drivers/gpu/ion/ion_cma_heap.c
+ *
+ * Copyright (C) 2011 Google, Inc.
+ * Copyright (c) 2011-2012, Code Aurora Forum. All rights reserved.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/device.h>
+#include <linux/dma-contiguous.h>
+#include <linux/err.h>
+#include <linux/highmem.h>
+#include <linux/ion.h>
+#include <linux/iommu.h>
+#include <linux/ktime.h>
+#include <linux/mm.h>
+#include <linux/scatterlist.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/vmalloc.h>
+#include "ion_priv.h"
+
+#include <mach/iommu_domains.h>
+#include <asm/cacheflush.h>
+
+/*
+ * The heap has no memory of its own: buffers are carved out of the CMA
+ * area of the device given in the platform data, and that area stays
+ * available to movable allocations until a buffer is requested.
+ */
+struct ion_cma_heap {
+	struct ion_heap heap;
+	struct device *dev;
+	unsigned int has_outer_cache;
+	spinlock_t lock;
+	unsigned long allocated_bytes;
+	unsigned long total_size;
+	unsigned long alloc_count;
+	unsigned long fail_count;
+	u64 total_ns;
+	u64 max_ns;
+};
+
+struct ion_cma_buffer_info {
+	struct page *pages;
+	unsigned long count;
+	struct sg_table table;
+};
+
+static int ion_cma_heap_allocate(struct ion_heap *heap,
+				 struct ion_buffer *buffer,
+				 unsigned long size, unsigned long align,
+				 unsigned long flags)
+{
+	struct ion_cma_heap *cma_heap =
+		container_of(heap, struct ion_cma_heap, heap);
+	struct ion_cma_buffer_info *info;
+	unsigned long count = PAGE_ALIGN(size) >> PAGE_SHIFT;
+	unsigned int order = get_order(max_t(unsigned long, align, PAGE_SIZE));
+	ktime_t start;
+	u64 ns;
+	unsigned long i;
+	int ret;
+
+	info = kzalloc(sizeof(struct ion_cma_buffer_info), GFP_KERNEL);
+	if (!info)
+		return -ENOMEM;
+
+	if (order > CONFIG_CMA_ALIGNMENT)
+		order = CONFIG_CMA_ALIGNMENT;
+
+	start = ktime_get();
+	info->pages = dma_alloc_from_contiguous(cma_heap->dev, count, order);
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	spin_lock(&cma_heap->lock);
+	if (info->pages) {
+		cma_heap->allocated_bytes += count << PAGE_SHIFT;
+		cma_heap->alloc_count++;
+		cma_heap->total_ns += ns;
+		if (ns > cma_heap->max_ns)
+			cma_heap->max_ns = ns;
+	} else {
+		cma_heap->fail_count++;
+	}
+	spin_unlock(&cma_heap->lock);
+
+	if (!info->pages) {
+		pr_debug("%s: heap %s could not allocate %lu pages\n",
+			 __func__, heap->name, count);
+		ret = -ENOMEM;
+		goto err0;
+	}
+	info->count = count;
+
+	for (i = 0; i < count; i++) {
+		void *addr = kmap_atomic(info->pages + i);
+
+		clear_page(addr);
+		dmac_flush_range(addr, addr + PAGE_SIZE);
+		kunmap_atomic(addr);
+	}
+	if (cma_heap->has_outer_cache) {
+		phys_addr_t phys = page_to_phys(info->pages);
+
+		outer_flush_range(phys, phys + (count << PAGE_SHIFT));
+	}
+
+	ret = sg_alloc_table(&info->table, 1, GFP_KERNEL);
+	if (ret)
+		goto err1;
+	sg_set_page(info->table.sgl, info->pages, count << PAGE_SHIFT, 0);
+	sg_dma_address(info->table.sgl) = page_to_phys(info->pages);
+
+	buffer->priv_virt = info;
+	return 0;
+
+err1:
+	dma_release_from_contiguous(cma_heap->dev, info->pages, count);
+	spin_lock(&cma_heap->lock);
+	cma_heap->allocated_bytes -= count << PAGE_SHIFT;
+	spin_unlock(&cma_heap->lock);
+err0:
+	kfree(info);
+	return ret;
+}
+
+static void ion_cma_heap_free(struct ion_buffer *buffer)
+{
+	struct ion_cma_heap *cma_heap =
+		container_of(buffer->heap, struct ion_cma_heap, heap);
+	struct ion_cma_buffer_info *info = buffer->priv_virt;
+
+	sg_free_table(&info->table);
+	dma_release_from_contiguous(cma_heap->dev, info->pages, info->count);
+
+	spin_lock(&cma_heap->lock);
+	cma_heap->allocated_bytes -= info->count << PAGE_SHIFT;
+	spin_unlock(&cma_heap->lock);
+
+	kfree(info);
+	buffer->priv_virt = NULL;
+}
+
+static int ion_cma_heap_phys(struct ion_heap *heap,
+			     struct ion_buffer *buffer,
+			     ion_phys_addr_t *addr, size_t *len)
+{
+	struct ion_cma_buffer_info *info = buffer->priv_virt;
+
+	*addr = page_to_phys(info->pages);
+	*len = buffer->size;
+	return 0;
+}
+
+static struct sg_table *ion_cma_heap_map_dma(struct ion_heap *heap,
+					     struct ion_buffer *buffer)
+{
+	struct ion_cma_buffer_info *info = buffer->priv_virt;
+
+	return &info->table;
+}
+
+static void ion_cma_heap_unmap_dma(struct ion_heap *heap,
+				   struct ion_buffer *buffer)
+{
+}
+
+static void *ion_cma_heap_map_kernel(struct ion_heap *heap,
+				     struct ion_buffer *buffer)
+{
+	struct ion_cma_buffer_info *info = buffer->priv_virt;
+	struct page **pages;
+	pgprot_t pgprot;
+	unsigned long i;
+	void *vaddr;
+
+	if (ION_IS_CACHED(buffer->flags))
+		pgprot = PAGE_KERNEL;
+	else
+		pgprot = pgprot_writecombine(PAGE_KERNEL);
+
+	pages = vmalloc(sizeof(struct page *) * info->count);
+	if (!pages)
+		return NULL;
+	for (i = 0; i < info->count; i++)
+		pages[i] = info->pages + i;
+
+	vaddr = vmap(pages, info->count, VM_MAP, pgprot);
+	vfree(pages);
+	return vaddr;
+}
+
+static void ion_cma_heap_unmap_kernel(struct ion_heap *heap,
+				      struct ion_buffer *buffer)
+{
+	vunmap(buffer->vaddr);
+	buffer->vaddr = NULL;
+}
+
+static int ion_cma_heap_map_user(struct ion_heap *heap,
+				 struct ion_buffer *buffer,
+				 struct vm_area_struct *vma)
+{
+	struct ion_cma_buffer_info *info = buffer->priv_virt;
+
+	if (!ION_IS_CACHED(buffer->flags))
+		vma->vm_page_prot = pgprot_writecombine(vma->vm_page_prot);
+
+	return remap_pfn_range(vma, vma->vm_start,
+			       page_to_pfn(info->pages) + vma->vm_pgoff,
+			       vma->vm_end - vma->vm_start,
+			       vma->vm_page_prot);
+}
+
+static int ion_cma_cache_ops(struct ion_heap *heap, struct ion_buffer *buffer,
+			     void *vaddr, unsigned int offset,
+			     unsigned int length, unsigned int cmd)
+{
+	struct ion_cma_heap *cma_heap =
+		container_of(heap, struct ion_cma_heap, heap);
+	struct ion_cma_buffer_info *info = buffer->priv_virt;
+	void (*outer_cache_op)(phys_addr_t, phys_addr_t);
+
+	switch (cmd) {
+	case ION_IOC_CLEAN_CACHES:
+		dmac_clean_range(vaddr, vaddr + length);
+		outer_cache_op = outer_clean_range;
+		break;
+	case ION_IOC_INV_CACHES:
+		dmac_inv_range(vaddr, vaddr + length);
+		outer_cache_op = outer_inv_range;
+		break;
+	case ION_IOC_CLEAN_INV_CACHES:
+		dmac_flush_range(vaddr, vaddr + length);
+		outer_cache_op = outer_flush_range;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	if (cma_heap->has_outer_cache) {
+		phys_addr_t pstart = page_to_phys(info->pages) + offset;
+
+		outer_cache_op(pstart, pstart + length);
+	}
+	return 0;
+}
+
+static int ion_cma_print_debug(struct ion_heap *heap, struct seq_file *s,
+			       const struct rb_root *mem_map)
+{
+	struct ion_cma_heap *cma_heap =
+		container_of(heap, struct ion_cma_heap, heap);
+	unsigned long allocated, allocs, fails;
+	u64 total_ns, max_ns;
+
+	spin_lock(&cma_heap->lock);
+	allocated = cma_heap->allocated_bytes;
+	allocs = cma_heap->alloc_count;
+	fails = cma_heap->fail_count;
+	total_ns = cma_heap->total_ns;
+	max_ns = cma_heap->max_ns;
+	spin_unlock(&cma_heap->lock);
+
+	seq_printf(s, "total bytes currently allocated: %lx\n", allocated);
+	seq_printf(s, "total heap size: %lx\n", cma_heap->total_size);
+	seq_printf(s, "allocations: %lu failed: %lu\n", allocs, fails);
+	if (allocs)
+		do_div(total_ns, allocs);
+	do_div(max_ns, NSEC_PER_USEC);
+	do_div(total_ns, NSEC_PER_USEC);
+	seq_printf(s, "allocation latency (us): avg %llu max %llu\n",
+		   total_ns, max_ns);
+	return 0;
+}
+
+static int ion_cma_heap_map_iommu(struct ion_buffer *buffer,
+				  struct ion_iommu_map *data,
+				  unsigned int domain_num,
+				  unsigned int partition_num,
+				  unsigned long align,
+				  unsigned long iova_length,
+				  unsigned long flags)
+{
+	struct ion_cma_buffer_info *info = buffer->priv_virt;
+	struct iommu_domain *domain;
+	unsigned long extra;
+	int prot = IOMMU_WRITE | IOMMU_READ;
+	int ret;
+
+	prot |= ION_IS_CACHED(flags) ? IOMMU_CACHE : 0;
+
+	data->mapped_size = iova_length;
+
+	if (!msm_use_iommu()) {
+		data->iova_addr = page_to_phys(info->pages);
+		return 0;
+	}
+
+	extra = iova_length - buffer->size;
+
+	ret = msm_allocate_iova_address(domain_num, partition_num,
+					data->mapped_size, align,
+					&data->iova_addr);
+	if (ret)
+		goto out;
+
+	domain = msm_get_iommu_domain(domain_num);
+	if (!domain) {
+		ret = -ENOMEM;
+		goto out1;
+	}
+
+	ret = iommu_map_range(domain, data->iova_addr, info->table.sgl,
+			      buffer->size, prot);
+	if (ret) {
+		pr_err("%s: could not map %lx in domain %p\n",
+			__func__, data->iova_addr, domain);
+		goto out1;
+	}
+
+	if (extra) {
+		unsigned long extra_iova_addr = data->iova_addr + buffer->size;
+
+		ret = msm_iommu_map_extra(domain, extra_iova_addr, extra,
+					  SZ_4K, prot);
+		if (ret)
+			goto out2;
+	}
+	return 0;
+
+out2:
+	iommu_unmap_range(domain, data->iova_addr, buffer->size);
+out1:
+	msm_free_iova_address(data->iova_addr, domain_num, partition_num,
+			      data->mapped_size);
+out:
+	return ret;
+}
+
+static void ion_cma_heap_unmap_iommu(struct ion_iommu_map *data)
+{
+	unsigned int domain_num;
+	unsigned int partition_num;
+	struct iommu_domain *domain;
+
+	if (!msm_use_iommu())
+		return;
+
+	domain_num = iommu_map_domain(data);
+	partition_num = iommu_map_partition(data);
+
+	domain = msm_get_iommu_domain(domain_num);
+	if (!domain) {
+		WARN(1, "Could not get domain %d. Corruption?\n", domain_num);
+		return;
+	}
+
+	iommu_unmap_range(domain, data->iova_addr, data->mapped_size);
+	msm_free_iova_address(data->iova_addr, domain_num, partition_num,
+			      data->mapped_size);
+}
+
+static struct ion_heap_ops cma_heap_ops = {
+	.allocate = ion_cma_heap_allocate,
+	.free = ion_cma_heap_free,
+	.phys = ion_cma_heap_phys,
+	.map_user = ion_cma_heap_map_user,
+	.map_kernel = ion_cma_heap_map_kernel,
+	.unmap_kernel = ion_cma_heap_unmap_kernel,
+	.map_dma = ion_cma_heap_map_dma,
+	.unmap_dma = ion_cma_heap_unmap_dma,
+	.cache_op = ion_cma_cache_ops,
+	.print_debug = ion_cma_print_debug,
+	.map_iommu = ion_cma_heap_map_iommu,
+	.unmap_iommu = ion_cma_heap_unmap_iommu,
+};
+
+struct ion_heap *ion_cma_heap_create(struct ion_platform_heap *heap_data)
+{
+	struct ion_cma_heap_pdata *pdata = heap_data->extra_data;
+	struct ion_cma_heap *cma_heap;
+
+	if (!pdata || !pdata->dev) {
+		pr_err("%s: heap %s has no CMA device\n", __func__,
+		       heap_data->name);
+		return ERR_PTR(-EINVAL);
+	}
+
+	cma_heap = kzalloc(sizeof(struct ion_cma_heap), GFP_KERNEL);
+	if (!cma_heap)
+		return ERR_PTR(-ENOMEM);
+
+	spin_lock_init(&cma_heap->lock);
+	cma_heap->heap.ops = &cma_heap_ops;
+	cma_heap->heap.type = ION_HEAP_TYPE_CMA;
+	cma_heap->dev = pdata->dev;
+	cma_heap->total_size = heap_data->size;
+	cma_heap->has_outer_cache = heap_data->has_outer_cache;
+	return &cma_heap->heap;
+}
+
+void ion_cma_heap_destroy(struct ion_heap *heap)
+{
+	struct ion_cma_heap *cma_heap =
+		container_of(heap, struct ion_cma_heap, heap);
+
+	kfree(cma_heap);
+}
@@ -29,12 +29,15 @@
 struct ion_iommu_heap {
 	struct ion_heap heap;
 	unsigned int has_outer_cache;
+	struct ion_page_pools pools;
 };
 
 struct ion_iommu_priv_data {
 	struct page **pages;
 	int nrpages;
 	unsigned long size;
+	struct sg_table table;
+	bool cached;
 };
 
 atomic_t v = ATOMIC_INIT(0);
@@ -44,77 +47,45 @@ static int ion_iommu_heap_allocate(struct ion_heap *heap,
 				      unsigned long size, unsigned long align,
 				      unsigned long flags)
 {
-	int ret = 0, i;
+	struct ion_iommu_heap *iommu_heap =
+	     container_of(heap, struct  ion_iommu_heap, heap);
 	struct ion_iommu_priv_data *data = NULL;
-	pgprot_t page_prot = pgprot_writecombine(PAGE_KERNEL);
-	void *ptr = NULL;
+	struct scatterlist *sg;
+	int ret, i, j, k = 0;
 
-	if (msm_use_iommu()) {
-		struct scatterlist *sg;
-		struct sg_table *table;
-		unsigned int i;
+	if (!msm_use_iommu())
+		return -ENOMEM;
 
-		data = kmalloc(sizeof(*data), GFP_KERNEL);
-		if (!data)
-			return -ENOMEM;
+	data = kmalloc(sizeof(*data), GFP_KERNEL);
+	if (!data)
+		return -ENOMEM;
 
-		data->size = PFN_ALIGN(size);
-		data->nrpages = data->size >> PAGE_SHIFT;
-		data->pages = kzalloc(sizeof(struct page *)*data->nrpages,
-				GFP_KERNEL);
-		if (!data->pages) {
-			ret = -ENOMEM;
-			goto err1;
-		}
+	data->size = PFN_ALIGN(size);
+	data->nrpages = data->size >> PAGE_SHIFT;
+	data->cached = ION_IS_CACHED(flags);
+	data->pages = kmalloc(sizeof(struct page *)*data->nrpages,
+			GFP_KERNEL);
+	if (!data->pages) {
+		ret = -ENOMEM;
+		goto err1;
+	}
 
-		table = buffer->sg_table =
-				kzalloc(sizeof(struct sg_table), GFP_KERNEL);
+	ret = ion_page_pools_alloc(&iommu_heap->pools, &data->table,
+				   data->size, data->cached);
+	if (ret)
+		goto err2;
 
-		if (!table) {
-			ret = -ENOMEM;
-			goto err1;
-		}
-		ret = sg_alloc_table(table, data->nrpages, GFP_KERNEL);
-		if (ret)
-			goto err2;
+	for_each_sg(data->table.sgl, sg, data->table.nents, i)
+		for (j = 0; j < sg->length >> PAGE_SHIFT; j++)
+			data->pages[k++] = sg_page(sg) + j;
 
-		for_each_sg(table->sgl, sg, table->nents, i) {
-			data->pages[i] = alloc_page(GFP_KERNEL | __GFP_HIGHMEM);
-			if (!data->pages[i])
-				goto err3;
+	buffer->priv_virt = data;
 
-			sg_set_page(sg, data->pages[i], PAGE_SIZE, 0);
-		}
-
-		ptr = vmap(data->pages, data->nrpages, VM_IOREMAP, page_prot);
-		if (ptr != NULL) {
-			memset(ptr, 0, data->size);
-			dmac_flush_range(ptr, ptr + data->size);
-			vunmap(ptr);
-		} else
-			pr_err("%s: vmap() failed\n", __func__);
-
-		buffer->priv_virt = data;
-		
-		atomic_add(data->size, &v);
-		
-		return 0;
-
-	} else {
-		return -ENOMEM;
-	}
+	atomic_add(data->size, &v);
 
+	return 0;
 
-err3:
-	sg_free_table(buffer->sg_table);
 err2:
-	kfree(buffer->sg_table);
-	buffer->sg_table = 0;
-
-	for (i = 0; i < data->nrpages; i++) {
-		if (data->pages[i])
-			__free_page(data->pages[i]);
-	}
 	kfree(data->pages);
 err1:
 	kfree(data);
@@ -123,18 +94,17 @@ err1:
 
 static void ion_iommu_heap_free(struct ion_buffer *buffer)
 {
+	struct ion_iommu_heap *iommu_heap =
+	     container_of(buffer->heap, struct  ion_iommu_heap, heap);
 	struct ion_iommu_priv_data *data = buffer->priv_virt;
-	int i;
 
 	if (!data)
 		return;
 
-	for (i = 0; i < data->nrpages; i++)
-		__free_page(data->pages[i]);
+	ion_page_pools_free(&iommu_heap->pools, &data->table, data->cached,
+			    buffer->private_flags & ION_PRIV_FLAG_SHRINKER_FREE);
 
-	
 	atomic_sub(data->size, &v);
-	
 
 	kfree(data->pages);
 	kfree(data);
@@ -149,8 +119,12 @@ int ion_iommu_heap_dump_size(void)
 static int ion_iommu_print_debug(struct ion_heap *heap, struct seq_file *s,
 				    const struct rb_root *mem_map)
 {
+	struct ion_iommu_heap *iommu_heap =
+	     container_of(heap, struct  ion_iommu_heap, heap);
+
 	seq_printf(s, "Total bytes currently allocated: %d (%x)\n",
 		atomic_read(&v), atomic_read(&v));
+	ion_page_pools_print_debug(&iommu_heap->pools, s);
 
 	if (mem_map) {
 		struct rb_node *n;
@@ -341,14 +315,15 @@ static int ion_iommu_cache_ops(struct ion_heap *heap, struct ion_buffer *buffer,
 
 	if (iommu_heap->has_outer_cache) {
 		unsigned long pstart;
-		unsigned int i;
+		struct scatterlist *sg;
+		int i;
 		struct ion_iommu_priv_data *data = buffer->priv_virt;
 		if (!data)
 			return -ENOMEM;
 
-		for (i = 0; i < data->nrpages; ++i) {
-			pstart = page_to_phys(data->pages[i]);
-			outer_cache_op(pstart, pstart + PAGE_SIZE);
+		for_each_sg(data->table.sgl, sg, data->table.nents, i) {
+			pstart = page_to_phys(sg_page(sg));
+			outer_cache_op(pstart, pstart + sg->length);
 		}
 	}
 	return 0;
@@ -357,16 +332,15 @@ static int ion_iommu_cache_ops(struct ion_heap *heap, struct ion_buffer *buffer,
 static struct sg_table *ion_iommu_heap_map_dma(struct ion_heap *heap,
 					      struct ion_buffer *buffer)
 {
-	return buffer->sg_table;
+	struct ion_iommu_priv_data *data = buffer->priv_virt;
+
+	return &data->table;
 }
 
 static void ion_iommu_heap_unmap_dma(struct ion_heap *heap,
 				 struct ion_buffer *buffer)
 {
-	if (buffer->sg_table)
-		sg_free_table(buffer->sg_table);
-	kfree(buffer->sg_table);
-	buffer->sg_table = 0;
+	return;
 }
 
 static struct ion_heap_ops iommu_heap_ops = {
@@ -391,8 +365,14 @@ struct ion_heap *ion_iommu_heap_create(struct ion_platform_heap *heap_data)
 	if (!iommu_heap)
 		return ERR_PTR(-ENOMEM);
 
+	if (ion_page_pools_init(&iommu_heap->pools)) {
+		kfree(iommu_heap);
+		return ERR_PTR(-ENOMEM);
+	}
+
 	iommu_heap->heap.ops = &iommu_heap_ops;
 	iommu_heap->heap.type = ION_HEAP_TYPE_IOMMU;
+	iommu_heap->heap.flags = ION_HEAP_FLAG_DEFER_FREE;
 	iommu_heap->has_outer_cache = heap_data->has_outer_cache;
 
 	return &iommu_heap->heap;
@@ -403,6 +383,7 @@ void ion_iommu_heap_destroy(struct ion_heap *heap)
 	struct ion_iommu_heap *iommu_heap =
 	     container_of(heap, struct  ion_iommu_heap, heap);
 
+	ion_page_pools_destroy(&iommu_heap->pools);
 	kfree(iommu_heap);
 	iommu_heap = NULL;
 }
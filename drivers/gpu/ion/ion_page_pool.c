@@ -0,0 +1,460 @@
+/*
+ * drivers/gpu/ion/ion_page_pool.c
+ *
+ * Copyright (C) 2011 Google, Inc.
+ * Copyright (c) 2011-2012, Code Aurora Forum. All rights reserved.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/err.h>
+#include <linux/highmem.h>
+#include <linux/ktime.h>
+#include <linux/list.h>
+#include <linux/mm.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/scatterlist.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/swap.h>
+#include <linux/workqueue.h>
+#include <asm/cacheflush.h>
+#include <asm/sizes.h>
+#include "ion_priv.h"
+
+/*
+ * Pages are kept split (every subpage holds its own reference) so that
+ * heaps can vm_insert_page() any of them, and are zeroed and flushed out
+ * of the CPU caches before they are handed out, so the same page can be
+ * returned to either a cached or an uncached buffer.  Pages freed back to
+ * a pool are queued as dirty and zeroed by a background worker.
+ */
+struct ion_page_pool {
+	spinlock_t lock;
+	int clean_count;
+	int dirty_count;
+	struct list_head clean_items;
+	struct list_head dirty_items;
+	unsigned long hits;
+	unsigned long misses;
+	gfp_t gfp_mask;
+	unsigned int order;
+	struct work_struct zero_work;
+	struct list_head list;
+};
+
+static const unsigned int ion_pool_orders[ION_NUM_POOL_ORDERS] = {8, 4, 0};
+
+static const unsigned long ion_size_class_max[ION_NUM_SIZE_CLASSES - 1] = {
+	SZ_64K, SZ_1M, SZ_4M, SZ_16M,
+};
+
+static LIST_HEAD(ion_page_pools_list);
+static DEFINE_MUTEX(ion_page_pools_mutex);
+static struct workqueue_struct *ion_page_pool_wq;
+
+static void ion_page_pool_zero(struct ion_page_pool *pool, struct page *page)
+{
+	unsigned int i;
+	phys_addr_t phys = page_to_phys(page);
+
+	for (i = 0; i < (1 << pool->order); i++) {
+		void *addr = kmap_atomic(page + i);
+
+		clear_page(addr);
+		dmac_flush_range(addr, addr + PAGE_SIZE);
+		kunmap_atomic(addr);
+	}
+	outer_flush_range(phys, phys + (PAGE_SIZE << pool->order));
+}
+
+static void ion_page_pool_release_page(struct ion_page_pool *pool,
+				       struct page *page)
+{
+	unsigned int i;
+
+	for (i = 0; i < (1 << pool->order); i++)
+		__free_page(page + i);
+}
+
+static struct page *ion_page_pool_remove(struct ion_page_pool *pool,
+					 bool clean)
+{
+	struct page *page = NULL;
+
+	if (clean && pool->clean_count) {
+		page = list_first_entry(&pool->clean_items, struct page, lru);
+		pool->clean_count--;
+	} else if (!clean && pool->dirty_count) {
+		page = list_first_entry(&pool->dirty_items, struct page, lru);
+		pool->dirty_count--;
+	}
+	if (page)
+		list_del(&page->lru);
+
+	return page;
+}
+
+static void ion_page_pool_zero_work(struct work_struct *work)
+{
+	struct ion_page_pool *pool =
+		container_of(work, struct ion_page_pool, zero_work);
+	struct page *page;
+
+	for (;;) {
+		spin_lock(&pool->lock);
+		page = ion_page_pool_remove(pool, false);
+		spin_unlock(&pool->lock);
+		if (!page)
+			break;
+
+		ion_page_pool_zero(pool, page);
+
+		spin_lock(&pool->lock);
+		list_add_tail(&page->lru, &pool->clean_items);
+		pool->clean_count++;
+		spin_unlock(&pool->lock);
+		cond_resched();
+	}
+}
+
+struct page *ion_page_pool_alloc(struct ion_page_pool *pool)
+{
+	struct page *page;
+	bool clean = true;
+
+	spin_lock(&pool->lock);
+	page = ion_page_pool_remove(pool, true);
+	if (!page) {
+		page = ion_page_pool_remove(pool, false);
+		clean = false;
+	}
+	if (page)
+		pool->hits++;
+	else
+		pool->misses++;
+	spin_unlock(&pool->lock);
+
+	if (!page) {
+		page = alloc_pages(pool->gfp_mask, pool->order);
+		if (!page)
+			return NULL;
+		if (pool->order)
+			split_page(page, pool->order);
+	}
+	if (!clean)
+		ion_page_pool_zero(pool, page);
+
+	return page;
+}
+
+void ion_page_pool_free(struct ion_page_pool *pool, struct page *page)
+{
+	spin_lock(&pool->lock);
+	list_add_tail(&page->lru, &pool->dirty_items);
+	pool->dirty_count++;
+	spin_unlock(&pool->lock);
+
+	queue_work(ion_page_pool_wq, &pool->zero_work);
+}
+
+static int ion_page_pool_total(struct ion_page_pool *pool)
+{
+	return (pool->clean_count + pool->dirty_count) << pool->order;
+}
+
+static int ion_page_pool_shrink_one(struct ion_page_pool *pool, int nr_to_scan)
+{
+	struct page *page;
+	int freed = 0;
+
+	while (freed < nr_to_scan) {
+		spin_lock(&pool->lock);
+		page = ion_page_pool_remove(pool, false);
+		if (!page)
+			page = ion_page_pool_remove(pool, true);
+		spin_unlock(&pool->lock);
+		if (!page)
+			break;
+		ion_page_pool_release_page(pool, page);
+		freed += 1 << pool->order;
+	}
+
+	return freed;
+}
+
+static int ion_page_pool_shrink(struct shrinker *shrinker,
+				struct shrink_control *sc)
+{
+	struct ion_page_pool *pool;
+	int nr_to_scan = sc->nr_to_scan;
+	int total = 0;
+
+	if (!mutex_trylock(&ion_page_pools_mutex))
+		return nr_to_scan ? -1 : 0;
+
+	list_for_each_entry(pool, &ion_page_pools_list, list) {
+		if (nr_to_scan > 0)
+			nr_to_scan -= ion_page_pool_shrink_one(pool, nr_to_scan);
+		total += ion_page_pool_total(pool);
+	}
+	mutex_unlock(&ion_page_pools_mutex);
+
+	return total;
+}
+
+static struct shrinker ion_page_pool_shrinker = {
+	.shrink = ion_page_pool_shrink,
+	.seeks = DEFAULT_SEEKS * 4,
+};
+
+struct ion_page_pool *ion_page_pool_create(gfp_t gfp_mask, unsigned int order)
+{
+	struct ion_page_pool *pool;
+
+	pool = kzalloc(sizeof(struct ion_page_pool), GFP_KERNEL);
+	if (!pool)
+		return NULL;
+	spin_lock_init(&pool->lock);
+	INIT_LIST_HEAD(&pool->clean_items);
+	INIT_LIST_HEAD(&pool->dirty_items);
+	INIT_WORK(&pool->zero_work, ion_page_pool_zero_work);
+	pool->gfp_mask = gfp_mask;
+	pool->order = order;
+
+	mutex_lock(&ion_page_pools_mutex);
+	if (!ion_page_pool_wq) {
+		ion_page_pool_wq = alloc_workqueue("ion_page_pool",
+						   WQ_UNBOUND | WQ_FREEZABLE, 1);
+		if (!ion_page_pool_wq) {
+			mutex_unlock(&ion_page_pools_mutex);
+			kfree(pool);
+			return NULL;
+		}
+		register_shrinker(&ion_page_pool_shrinker);
+	}
+	list_add_tail(&pool->list, &ion_page_pools_list);
+	mutex_unlock(&ion_page_pools_mutex);
+
+	return pool;
+}
+
+void ion_page_pool_destroy(struct ion_page_pool *pool)
+{
+	mutex_lock(&ion_page_pools_mutex);
+	list_del(&pool->list);
+	mutex_unlock(&ion_page_pools_mutex);
+
+	cancel_work_sync(&pool->zero_work);
+	ion_page_pool_shrink_one(pool, INT_MAX);
+	kfree(pool);
+}
+
+int ion_page_pools_init(struct ion_page_pools *pools)
+{
+	gfp_t high_order_gfp = (GFP_HIGHUSER | __GFP_NOWARN | __GFP_NORETRY |
+				__GFP_NO_KSWAPD) & ~__GFP_WAIT;
+	gfp_t low_order_gfp = GFP_HIGHUSER | __GFP_NOWARN;
+	int cached, i;
+
+	memset(pools, 0, sizeof(*pools));
+	spin_lock_init(&pools->stat_lock);
+
+	for (cached = 0; cached < 2; cached++) {
+		for (i = 0; i < ION_NUM_POOL_ORDERS; i++) {
+			struct ion_page_pool *pool;
+			unsigned int order = ion_pool_orders[i];
+
+			pool = ion_page_pool_create(order ? high_order_gfp :
+						    low_order_gfp, order);
+			if (!pool)
+				goto err;
+			pools->pools[cached][i] = pool;
+		}
+	}
+	return 0;
+
+err:
+	ion_page_pools_destroy(pools);
+	return -ENOMEM;
+}
+
+void ion_page_pools_destroy(struct ion_page_pools *pools)
+{
+	int cached, i;
+
+	for (cached = 0; cached < 2; cached++) {
+		for (i = 0; i < ION_NUM_POOL_ORDERS; i++) {
+			if (pools->pools[cached][i])
+				ion_page_pool_destroy(pools->pools[cached][i]);
+			pools->pools[cached][i] = NULL;
+		}
+	}
+}
+
+static int ion_pool_index(unsigned int order)
+{
+	int i;
+
+	for (i = 0; i < ION_NUM_POOL_ORDERS; i++)
+		if (ion_pool_orders[i] == order)
+			return i;
+	BUG();
+	return -1;
+}
+
+static void ion_page_pools_account(struct ion_page_pools *pools,
+				   unsigned long size, unsigned int nents,
+				   u64 ns)
+{
+	struct ion_alloc_stat *stat;
+	int i;
+
+	for (i = 0; i < ION_NUM_SIZE_CLASSES - 1; i++)
+		if (size <= ion_size_class_max[i])
+			break;
+	stat = &pools->stat[i];
+
+	spin_lock(&pools->stat_lock);
+	stat->count++;
+	stat->nents += nents;
+	stat->total_ns += ns;
+	if (ns > stat->max_ns)
+		stat->max_ns = ns;
+	spin_unlock(&pools->stat_lock);
+}
+
+/*
+ * Fill @table with chunks of the largest pool order that fits the rest of
+ * the buffer, dropping to smaller orders for the remainder of the buffer
+ * once a high order allocation fails.
+ */
+int ion_page_pools_alloc(struct ion_page_pools *pools, struct sg_table *table,
+			 unsigned long size, bool cached)
+{
+	struct ion_page_pool **pool = pools->pools[cached];
+	unsigned long remaining = PAGE_ALIGN(size);
+	ktime_t start = ktime_get();
+	struct scatterlist *sg;
+	LIST_HEAD(chunks);
+	struct page *page, *tmp;
+	unsigned int nents = 0;
+	int i = 0, ret;
+
+	while (remaining) {
+		unsigned int order = ion_pool_orders[i];
+
+		if (remaining < (PAGE_SIZE << order)) {
+			i++;
+			continue;
+		}
+		page = ion_page_pool_alloc(pool[i]);
+		if (!page) {
+			if (!order)
+				goto err;
+			i++;
+			continue;
+		}
+		set_page_private(page, order);
+		list_add_tail(&page->lru, &chunks);
+		remaining -= PAGE_SIZE << order;
+		nents++;
+	}
+
+	ret = sg_alloc_table(table, nents, GFP_KERNEL);
+	if (ret)
+		goto err;
+
+	sg = table->sgl;
+	list_for_each_entry_safe(page, tmp, &chunks, lru) {
+		sg_set_page(sg, page, PAGE_SIZE << page_private(page), 0);
+		set_page_private(page, 0);
+		list_del(&page->lru);
+		sg = sg_next(sg);
+	}
+
+	ion_page_pools_account(pools, size, nents,
+			       ktime_to_ns(ktime_sub(ktime_get(), start)));
+	return 0;
+
+err:
+	list_for_each_entry_safe(page, tmp, &chunks, lru) {
+		unsigned int order = page_private(page);
+
+		set_page_private(page, 0);
+		list_del(&page->lru);
+		ion_page_pool_free(pool[ion_pool_index(order)], page);
+	}
+	return -ENOMEM;
+}
+
+/*
+ * @release hands the pages straight back to the page allocator, for buffers
+ * freed on behalf of a shrinker that has to see memory actually released.
+ */
+void ion_page_pools_free(struct ion_page_pools *pools, struct sg_table *table,
+			 bool cached, bool release)
+{
+	struct ion_page_pool **pool = pools->pools[cached];
+	struct ion_page_pool *p;
+	struct scatterlist *sg;
+	int i;
+
+	for_each_sg(table->sgl, sg, table->nents, i) {
+		p = pool[ion_pool_index(get_order(sg->length))];
+		if (release)
+			ion_page_pool_release_page(p, sg_page(sg));
+		else
+			ion_page_pool_free(p, sg_page(sg));
+	}
+	sg_free_table(table);
+}
+
+void ion_page_pools_print_debug(struct ion_page_pools *pools,
+				struct seq_file *s)
+{
+	static const char * const class_name[ION_NUM_SIZE_CLASSES] = {
+		"<=64K", "<=1M", "<=4M", "<=16M", ">16M",
+	};
+	struct ion_alloc_stat stat[ION_NUM_SIZE_CLASSES];
+	int cached, i;
+
+	seq_printf(s, "\n%8s %6s %8s %8s %10s %10s\n", "pool", "order",
+		   "clean", "dirty", "hits", "misses");
+	for (cached = 0; cached < 2; cached++) {
+		for (i = 0; i < ION_NUM_POOL_ORDERS; i++) {
+			struct ion_page_pool *pool = pools->pools[cached][i];
+
+			seq_printf(s, "%8s %6u %8d %8d %10lu %10lu\n",
+				   cached ? "cached" : "uncached", pool->order,
+				   pool->clean_count, pool->dirty_count,
+				   pool->hits, pool->misses);
+		}
+	}
+
+	spin_lock(&pools->stat_lock);
+	memcpy(stat, pools->stat, sizeof(stat));
+	spin_unlock(&pools->stat_lock);
+
+	seq_printf(s, "\n%8s %10s %10s %10s %8s\n", "size", "allocs",
+		   "avg us", "max us", "avg sg");
+	for (i = 0; i < ION_NUM_SIZE_CLASSES; i++) {
+		unsigned long count = stat[i].count ? stat[i].count : 1;
+
+		seq_printf(s, "%8s %10lu %10llu %10llu %8lu\n", class_name[i],
+			   stat[i].count,
+			   div_u64(div_u64(stat[i].total_ns, count),
+				   NSEC_PER_USEC),
+			   div_u64(stat[i].max_ns, NSEC_PER_USEC),
+			   stat[i].nents / count);
+	}
+}
@@ -21,10 +21,14 @@
 #include <linux/kref.h>
 #include <linux/mm_types.h>
 #include <linux/mutex.h>
+#include <linux/shrinker.h>
+#include <linux/wait.h>
 #include <linux/rbtree.h>
 #include <linux/ion.h>
 #include <linux/iommu.h>
 #include <linux/seq_file.h>
+#include <linux/scatterlist.h>
+#include <linux/spinlock.h>
 
 enum {
 	DI_PARTITION_NUM = 0,
@@ -68,8 +72,12 @@ struct ion_buffer {
 	unsigned int iommu_map_cnt;
 	struct rb_root iommu_maps;
 	int marked;
+	struct list_head list;
+	unsigned long private_flags;
 };
 
+#define ION_PRIV_FLAG_SHRINKER_FREE (1 << 0)
+
 struct ion_heap_ops {
 	int (*allocate) (struct ion_heap *heap,
 			 struct ion_buffer *buffer, unsigned long len,
@@ -102,13 +110,40 @@ struct ion_heap_ops {
 	int (*unsecure_heap)(struct ion_heap *heap, int version, void *data);
 };
 
+#define ION_HEAP_FLAG_DEFER_FREE (1 << 0)
+
 struct ion_heap {
 	struct rb_node node;
 	struct ion_device *dev;
 	enum ion_heap_type type;
 	struct ion_heap_ops *ops;
+	unsigned long flags;
 	int id;
 	const char *name;
+	struct list_head free_list;
+	size_t free_list_size;
+	spinlock_t free_lock;
+	wait_queue_head_t waitqueue;
+	struct task_struct *task;
+	struct shrinker shrinker;
+};
+
+struct ion_page_pool;
+
+#define ION_NUM_POOL_ORDERS	3
+#define ION_NUM_SIZE_CLASSES	5
+
+struct ion_alloc_stat {
+	unsigned long count;
+	unsigned long nents;
+	u64 total_ns;
+	u64 max_ns;
+};
+
+struct ion_page_pools {
+	struct ion_page_pool *pools[2][ION_NUM_POOL_ORDERS];
+	spinlock_t stat_lock;
+	struct ion_alloc_stat stat[ION_NUM_SIZE_CLASSES];
 };
 
 struct mem_map_data {
@@ -135,6 +170,7 @@ void ion_device_add_heap(struct ion_device *dev, struct ion_heap *heap);
 
 struct ion_heap *ion_heap_create(struct ion_platform_heap *);
 void ion_heap_destroy(struct ion_heap *);
+size_t ion_heap_freelist_drain(struct ion_heap *heap, size_t size, bool shrink);
 
 struct ion_heap *ion_system_heap_create(struct ion_platform_heap *);
 void ion_system_heap_destroy(struct ion_heap *);
@@ -151,6 +187,9 @@ void ion_iommu_heap_destroy(struct ion_heap *);
 struct ion_heap *ion_cp_heap_create(struct ion_platform_heap *);
 void ion_cp_heap_destroy(struct ion_heap *);
 
+struct ion_heap *ion_cma_heap_create(struct ion_platform_heap *);
+void ion_cma_heap_destroy(struct ion_heap *);
+
 struct ion_heap *ion_reusable_heap_create(struct ion_platform_heap *);
 void ion_reusable_heap_destroy(struct ion_heap *);
 
@@ -178,4 +217,18 @@ void ion_cp_heap_get_base(struct ion_heap *heap, unsigned long *base,
 
 void ion_mem_map_show(struct ion_heap *heap);
 
+struct ion_page_pool *ion_page_pool_create(gfp_t gfp_mask, unsigned int order);
+void ion_page_pool_destroy(struct ion_page_pool *pool);
+struct page *ion_page_pool_alloc(struct ion_page_pool *pool);
+void ion_page_pool_free(struct ion_page_pool *pool, struct page *page);
+
+int ion_page_pools_init(struct ion_page_pools *pools);
+void ion_page_pools_destroy(struct ion_page_pools *pools);
+int ion_page_pools_alloc(struct ion_page_pools *pools, struct sg_table *table,
+			 unsigned long size, bool cached);
+void ion_page_pools_free(struct ion_page_pools *pools, struct sg_table *table,
+			 bool cached, bool release);
+void ion_page_pools_print_debug(struct ion_page_pools *pools,
+				struct seq_file *s);
+
 #endif 
@@ -33,59 +33,59 @@ static atomic_t system_contig_heap_allocated;
 static unsigned int system_heap_has_outer_cache;
 static unsigned int system_heap_contig_has_outer_cache;
 
+struct ion_system_heap {
+	struct ion_heap heap;
+	struct ion_page_pools pools;
+};
+
+struct ion_system_buffer_info {
+	struct sg_table table;
+	bool cached;
+};
+
 static int ion_system_heap_allocate(struct ion_heap *heap,
 				     struct ion_buffer *buffer,
 				     unsigned long size, unsigned long align,
 				     unsigned long flags)
 {
-	struct sg_table *table;
-	struct scatterlist *sg;
-	int i, j;
-	int npages = PAGE_ALIGN(size) / PAGE_SIZE;
+	struct ion_system_heap *sys_heap =
+		container_of(heap, struct ion_system_heap, heap);
+	struct ion_system_buffer_info *info;
+	int ret;
 
-	table = kmalloc(sizeof(struct sg_table), GFP_KERNEL);
-	if (!table)
+	info = kmalloc(sizeof(struct ion_system_buffer_info), GFP_KERNEL);
+	if (!info)
 		return -ENOMEM;
-	i = sg_alloc_table(table, npages, GFP_KERNEL);
-	if (i)
-		goto err0;
-	for_each_sg(table->sgl, sg, table->nents, i) {
-		struct page *page;
-		page = alloc_page(GFP_KERNEL|__GFP_ZERO);
-		if (!page)
-			goto err1;
-		sg_set_page(sg, page, PAGE_SIZE, 0);
+	info->cached = ION_IS_CACHED(flags);
+	ret = ion_page_pools_alloc(&sys_heap->pools, &info->table, size,
+				   info->cached);
+	if (ret) {
+		kfree(info);
+		return ret;
 	}
-	buffer->priv_virt = table;
+	buffer->priv_virt = info;
 	atomic_add(size, &system_heap_allocated);
 	return 0;
-err1:
-	for_each_sg(table->sgl, sg, i, j)
-		__free_page(sg_page(sg));
-	sg_free_table(table);
-err0:
-	kfree(table);
-	return -ENOMEM;
 }
 
 void ion_system_heap_free(struct ion_buffer *buffer)
 {
-	int i;
-	struct scatterlist *sg;
-	struct sg_table *table = buffer->priv_virt;
-
-	for_each_sg(table->sgl, sg, table->nents, i)
-		__free_page(sg_page(sg));
-	if (buffer->sg_table)
-		sg_free_table(buffer->sg_table);
-	kfree(buffer->sg_table);
+	struct ion_system_heap *sys_heap =
+		container_of(buffer->heap, struct ion_system_heap, heap);
+	struct ion_system_buffer_info *info = buffer->priv_virt;
+
+	ion_page_pools_free(&sys_heap->pools, &info->table, info->cached,
+			    buffer->private_flags & ION_PRIV_FLAG_SHRINKER_FREE);
+	kfree(info);
 	atomic_sub(buffer->size, &system_heap_allocated);
 }
 
 struct sg_table *ion_system_heap_map_dma(struct ion_heap *heap,
 					 struct ion_buffer *buffer)
 {
-	return buffer->priv_virt;
+	struct ion_system_buffer_info *info = buffer->priv_virt;
+
+	return &info->table;
 }
 
 void ion_system_heap_unmap_dma(struct ion_heap *heap,
@@ -102,16 +102,21 @@ void *ion_system_heap_map_kernel(struct ion_heap *heap,
 		return ERR_PTR(-EINVAL);
 	} else {
 		struct scatterlist *sg;
-		int i;
+		int i, j, npages = PAGE_ALIGN(buffer->size) / PAGE_SIZE;
 		void *vaddr;
-		struct sg_table *table = buffer->priv_virt;
+		struct sg_table *table = buffer->sg_table;
 		struct page **pages = kmalloc(
-					sizeof(struct page *) * table->nents,
+					sizeof(struct page *) * npages,
 					GFP_KERNEL);
+		struct page **tmp = pages;
 
-		for_each_sg(table->sgl, sg, table->nents, i)
-			pages[i] = sg_page(sg);
-		vaddr = vmap(pages, table->nents, VM_MAP, PAGE_KERNEL);
+		if (!pages)
+			return ERR_PTR(-ENOMEM);
+		for_each_sg(table->sgl, sg, table->nents, i) {
+			for (j = 0; j < sg->length / PAGE_SIZE; j++)
+				*(tmp++) = sg_page(sg) + j;
+		}
+		vaddr = vmap(pages, npages, VM_MAP, PAGE_KERNEL);
 		kfree(pages);
 
 		return vaddr;
@@ -157,19 +162,23 @@ int ion_system_heap_map_user(struct ion_heap *heap, struct ion_buffer *buffer,
 		pr_err("%s: cannot map system heap uncached\n", __func__);
 		return -EINVAL;
 	} else {
-		struct sg_table *table = buffer->priv_virt;
+		struct sg_table *table = buffer->sg_table;
 		unsigned long addr = vma->vm_start;
 		unsigned long offset = vma->vm_pgoff;
 		struct scatterlist *sg;
-		int i;
+		int i, j;
 
 		for_each_sg(table->sgl, sg, table->nents, i) {
-			if (offset) {
-				offset--;
-				continue;
+			for (j = 0; j < sg->length / PAGE_SIZE; j++) {
+				if (offset) {
+					offset--;
+					continue;
+				}
+				if (addr >= vma->vm_end)
+					return 0;
+				vm_insert_page(vma, addr, sg_page(sg) + j);
+				addr += PAGE_SIZE;
 			}
-			vm_insert_page(vma, addr, sg_page(sg));
-			addr += PAGE_SIZE;
 		}
 		return 0;
 	}
@@ -200,7 +209,7 @@ int ion_system_heap_cache_ops(struct ion_heap *heap, struct ion_buffer *buffer,
 
 	if (system_heap_has_outer_cache) {
 		unsigned long pstart;
-		struct sg_table *table = buffer->priv_virt;
+		struct sg_table *table = buffer->sg_table;
 		struct scatterlist *sg;
 		int i;
 		for_each_sg(table->sgl, sg, table->nents, i) {
@@ -210,7 +219,7 @@ int ion_system_heap_cache_ops(struct ion_heap *heap, struct ion_buffer *buffer,
 				WARN(1, "Could not translate virtual address to physical address\n");
 				return -EINVAL;
 			}
-			outer_cache_op(pstart, pstart + PAGE_SIZE);
+			outer_cache_op(pstart, pstart + sg->length);
 		}
 	}
 	return 0;
@@ -219,8 +228,12 @@ int ion_system_heap_cache_ops(struct ion_heap *heap, struct ion_buffer *buffer,
 static int ion_system_print_debug(struct ion_heap *heap, struct seq_file *s,
 				  const struct rb_root *unused)
 {
+	struct ion_system_heap *sys_heap =
+		container_of(heap, struct ion_system_heap, heap);
+
 	seq_printf(s, "total bytes currently allocated: %lx\n",
 			(unsigned long) atomic_read(&system_heap_allocated));
+	ion_page_pools_print_debug(&sys_heap->pools, s);
 
 	return 0;
 }
@@ -237,7 +250,7 @@ int ion_system_heap_map_iommu(struct ion_buffer *buffer,
 	struct iommu_domain *domain;
 	unsigned long extra;
 	unsigned long extra_iova_addr;
-	struct sg_table *table = buffer->priv_virt;
+	struct sg_table *table = buffer->sg_table;
 	int prot = IOMMU_WRITE | IOMMU_READ;
 	prot |= ION_IS_CACHED(flags) ? IOMMU_CACHE : 0;
 
@@ -307,20 +320,29 @@ static struct ion_heap_ops vmalloc_ops = {
 
 struct ion_heap *ion_system_heap_create(struct ion_platform_heap *pheap)
 {
-	struct ion_heap *heap;
+	struct ion_system_heap *sys_heap;
 
-	heap = kzalloc(sizeof(struct ion_heap), GFP_KERNEL);
-	if (!heap)
+	sys_heap = kzalloc(sizeof(struct ion_system_heap), GFP_KERNEL);
+	if (!sys_heap)
 		return ERR_PTR(-ENOMEM);
-	heap->ops = &vmalloc_ops;
-	heap->type = ION_HEAP_TYPE_SYSTEM;
+	if (ion_page_pools_init(&sys_heap->pools)) {
+		kfree(sys_heap);
+		return ERR_PTR(-ENOMEM);
+	}
+	sys_heap->heap.ops = &vmalloc_ops;
+	sys_heap->heap.type = ION_HEAP_TYPE_SYSTEM;
+	sys_heap->heap.flags = ION_HEAP_FLAG_DEFER_FREE;
 	system_heap_has_outer_cache = pheap->has_outer_cache;
-	return heap;
+	return &sys_heap->heap;
 }
 
 void ion_system_heap_destroy(struct ion_heap *heap)
 {
-	kfree(heap);
+	struct ion_system_heap *sys_heap =
+		container_of(heap, struct ion_system_heap, heap);
+
+	ion_page_pools_destroy(&sys_heap->pools);
+	kfree(sys_heap);
 }
 
 static int ion_system_contig_heap_allocate(struct ion_heap *heap,
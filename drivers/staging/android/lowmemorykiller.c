@@ -71,6 +71,7 @@ static size_t minfree_tmp[6] = {0, 0, 0, 0, 0, 0};
 static unsigned long lowmem_deathpending_timeout;
 static unsigned long lowmem_fork_boost_timeout;
 static uint32_t lowmem_fork_boost = 1;
+static uint32_t lowmem_reap = 1;
 
 #define lowmem_print(level, x...)			\
 	do {						\
@@ -262,6 +263,8 @@ static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
 		}
 		send_sig(SIGKILL, selected, 0);
 		set_tsk_thread_flag(selected, TIF_MEMDIE);
+		if (lowmem_reap)
+			wake_oom_reaper(selected);
 		rem -= selected_tasksize;
 		rcu_read_unlock();
 		
@@ -386,6 +389,7 @@ module_param_array_named(minfree, lowmem_minfree, uint, &lowmem_minfree_size,
 			 S_IRUGO | S_IWUSR);
 module_param_named(debug_level, lowmem_debug_level, uint, S_IRUGO | S_IWUSR);
 module_param_named(fork_boost, lowmem_fork_boost, uint, S_IRUGO | S_IWUSR);
+module_param_named(reap, lowmem_reap, uint, S_IRUGO | S_IWUSR);
 module_param_array_named(fork_boost_minfree, lowmem_fork_boost_minfree, uint,
 			 &lowmem_fork_boost_minfree_size, S_IRUGO | S_IWUSR);
 
@@ -30,8 +30,10 @@
 #include <linux/highmem.h>
 #include <linux/slab.h>
 #include <linux/lzo.h>
+#include <linux/scatterlist.h>
 #include <linux/string.h>
 #include <linux/vmalloc.h>
+#include <crypto/acompress.h>
 
 #include "zram_drv.h"
 
@@ -311,16 +313,89 @@ static int zram_read_before_write(struct zram *zram, char *mem, u32 index)
 	return 0;
 }
 
+/*
+ * Store the @clen bytes of compressed data at @src as page @index, or @page
+ * itself when it did not compress well enough.  Called with zram->lock
+ * held for writing and the old contents of @index freed.
+ */
+static int zram_store_page(struct zram *zram, u32 index, struct page *page,
+			   unsigned char *src, size_t clen)
+{
+	u32 store_offset;
+	void *handle;
+	struct zobj_header *zheader;
+	struct page *page_store;
+	unsigned char *cmem;
+
+	/*
+	 * Page is incompressible. Store it as-is (uncompressed)
+	 * since we do not want to return too many disk write
+	 * errors which has side effect of hanging the system.
+	 */
+	if (unlikely(clen > max_zpage_size)) {
+		clen = PAGE_SIZE;
+		page_store = alloc_page(GFP_NOIO | __GFP_HIGHMEM);
+		if (unlikely(!page_store)) {
+			pr_info("Error allocating memory for "
+				"incompressible page: %u\n", index);
+			return -ENOMEM;
+		}
+
+		store_offset = 0;
+		zram_set_flag(zram, index, ZRAM_UNCOMPRESSED);
+		zram_stat_inc(&zram->stats.pages_expand);
+		handle = page_store;
+		src = kmap_atomic(page);
+		cmem = kmap_atomic(page_store);
+		goto memstore;
+	}
+
+	handle = zs_malloc(zram->mem_pool, clen + sizeof(*zheader));
+	if (!handle) {
+		pr_info("Error allocating memory for compressed "
+			"page: %u, size=%zu\n", index, clen);
+		return -ENOMEM;
+	}
+	cmem = zs_map_object(zram->mem_pool, handle);
+
+memstore:
+#if 0
+	/* Back-reference needed for memory defragmentation */
+	if (!zram_test_flag(zram, index, ZRAM_UNCOMPRESSED)) {
+		zheader = (struct zobj_header *)cmem;
+		zheader->table_idx = index;
+		cmem += sizeof(*zheader);
+	}
+#endif
+
+	memcpy(cmem, src, clen);
+
+	if (unlikely(zram_test_flag(zram, index, ZRAM_UNCOMPRESSED))) {
+		kunmap_atomic(cmem);
+		kunmap_atomic(src);
+	} else {
+		zs_unmap_object(zram->mem_pool, handle);
+	}
+
+	zram->table[index].handle = handle;
+	zram->table[index].size = clen;
+
+	/* Update stats */
+	zram_stat64_add(zram, &zram->stats.compr_size, clen);
+	zram_stat_inc(&zram->stats.pages_stored);
+	if (clen <= PAGE_SIZE / 2)
+		zram_stat_inc(&zram->stats.good_compress);
+
+	return 0;
+}
+
 static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 			   int offset)
 {
 	int ret;
-	u32 store_offset;
 	size_t clen;
-	void *handle;
-	struct zobj_header *zheader;
-	struct page *page, *page_store;
-	unsigned char *user_mem, *cmem, *src, *uncmem = NULL;
+	struct page *page;
+	unsigned char *user_mem, *src, *uncmem = NULL;
 
 	page = bvec->bv_page;
 	src = zram->compress_buffer;
@@ -381,66 +456,9 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 		goto out;
 	}
 
-	/*
-	 * Page is incompressible. Store it as-is (uncompressed)
-	 * since we do not want to return too many disk write
-	 * errors which has side effect of hanging the system.
-	 */
-	if (unlikely(clen > max_zpage_size)) {
-		clen = PAGE_SIZE;
-		page_store = alloc_page(GFP_NOIO | __GFP_HIGHMEM);
-		if (unlikely(!page_store)) {
-			pr_info("Error allocating memory for "
-				"incompressible page: %u\n", index);
-			ret = -ENOMEM;
-			goto out;
-		}
-
-		store_offset = 0;
-		zram_set_flag(zram, index, ZRAM_UNCOMPRESSED);
-		zram_stat_inc(&zram->stats.pages_expand);
-		handle = page_store;
-		src = kmap_atomic(page);
-		cmem = kmap_atomic(page_store);
-		goto memstore;
-	}
-
-	handle = zs_malloc(zram->mem_pool, clen + sizeof(*zheader));
-	if (!handle) {
-		pr_info("Error allocating memory for compressed "
-			"page: %u, size=%zu\n", index, clen);
-		ret = -ENOMEM;
+	ret = zram_store_page(zram, index, page, src, clen);
+	if (ret)
 		goto out;
-	}
-	cmem = zs_map_object(zram->mem_pool, handle);
-
-memstore:
-#if 0
-	/* Back-reference needed for memory defragmentation */
-	if (!zram_test_flag(zram, index, ZRAM_UNCOMPRESSED)) {
-		zheader = (struct zobj_header *)cmem;
-		zheader->table_idx = index;
-		cmem += sizeof(*zheader);
-	}
-#endif
-
-	memcpy(cmem, src, clen);
-
-	if (unlikely(zram_test_flag(zram, index, ZRAM_UNCOMPRESSED))) {
-		kunmap_atomic(cmem);
-		kunmap_atomic(src);
-	} else {
-		zs_unmap_object(zram->mem_pool, handle);
-	}
-
-	zram->table[index].handle = handle;
-	zram->table[index].size = clen;
-
-	/* Update stats */
-	zram_stat64_add(zram, &zram->stats.compr_size, clen);
-	zram_stat_inc(&zram->stats.pages_stored);
-	if (clen <= PAGE_SIZE / 2)
-		zram_stat_inc(&zram->stats.good_compress);
 
 	return 0;
 
@@ -468,6 +486,239 @@ static int zram_bvec_rw(struct zram *zram, struct bio_vec *bvec, u32 index,
 	return ret;
 }
 
+#ifdef CONFIG_ZRAM_ASYNC_COMP
+struct zram_acomp_slot {
+	struct acomp_req *req;
+	struct scatterlist src;
+	struct scatterlist dst;
+	void *buf;		/* one lowmem page for the compressed data */
+	int zero;
+	int err;
+	struct zram_acomp_batch *batch;
+};
+
+struct zram_acomp_batch {
+	struct zram_acomp_slot slot[ZRAM_ACOMP_BATCH];
+	atomic_t pending;
+	struct completion done;
+};
+
+static void zram_acomp_batch_free(void *element, void *pool_data)
+{
+	struct zram_acomp_batch *batch = element;
+	int i;
+
+	for (i = 0; i < ZRAM_ACOMP_BATCH; i++) {
+		if (batch->slot[i].req)
+			acomp_request_free(batch->slot[i].req);
+		free_page((unsigned long)batch->slot[i].buf);
+	}
+	kfree(batch);
+}
+
+static void *zram_acomp_batch_alloc(gfp_t gfp_mask, void *pool_data)
+{
+	struct crypto_acomp *tfm = pool_data;
+	struct zram_acomp_batch *batch;
+	int i;
+
+	batch = kzalloc(sizeof(*batch), gfp_mask);
+	if (!batch)
+		return NULL;
+
+	for (i = 0; i < ZRAM_ACOMP_BATCH; i++) {
+		batch->slot[i].req = acomp_request_alloc(tfm, gfp_mask);
+		batch->slot[i].buf = (void *)__get_free_page(gfp_mask);
+		if (!batch->slot[i].req || !batch->slot[i].buf)
+			goto fail;
+		batch->slot[i].batch = batch;
+	}
+
+	return batch;
+
+fail:
+	zram_acomp_batch_free(batch, pool_data);
+	return NULL;
+}
+
+static void zram_acomp_done(struct crypto_async_request *req, int err)
+{
+	struct zram_acomp_slot *slot = req->data;
+
+	slot->err = err;
+	if (atomic_dec_and_test(&slot->batch->pending))
+		complete(&slot->batch->done);
+}
+
+/*
+ * Compress @nr full pages of @bio, starting at segment @seg, in parallel
+ * and store them as pages @index onwards.  Only the stores are done under
+ * zram->lock, so that concurrent writers overlap their compression.
+ */
+static int zram_write_batch(struct zram *zram, struct zram_acomp_batch *batch,
+			    struct bio *bio, int seg, int nr, u32 index)
+{
+	struct acomp_req *reqs[ZRAM_ACOMP_BATCH];
+	struct zram_acomp_slot *slot;
+	struct bio_vec *bvec;
+	void *user_mem;
+	int i, n = 0;
+	int ret = 0;
+
+	for (i = 0; i < nr; i++) {
+		bvec = bio_iovec_idx(bio, seg + i);
+		slot = &batch->slot[i];
+
+		user_mem = kmap_atomic(bvec->bv_page);
+		slot->zero = page_zero_filled(user_mem + bvec->bv_offset);
+		kunmap_atomic(user_mem);
+		if (slot->zero)
+			continue;
+
+		/*
+		 * Output that does not fit max_zpage_size fails with -ENOSPC
+		 * and the page is stored as it is, as on the sync path.
+		 */
+		sg_init_table(&slot->src, 1);
+		sg_set_page(&slot->src, bvec->bv_page, PAGE_SIZE,
+			    bvec->bv_offset);
+		sg_init_one(&slot->dst, slot->buf, PAGE_SIZE);
+		acomp_request_set_callback(slot->req, 0, zram_acomp_done, slot);
+		acomp_request_set_params(slot->req, &slot->src, &slot->dst,
+					 PAGE_SIZE, max_zpage_size);
+		reqs[n++] = slot->req;
+	}
+
+	if (n) {
+		atomic_set(&batch->pending, n);
+		crypto_acomp_compress_batch(reqs, n);
+		wait_for_completion(&batch->done);
+	}
+
+	down_write(&zram->lock);
+	for (i = 0; i < nr; i++, index++) {
+		bvec = bio_iovec_idx(bio, seg + i);
+		slot = &batch->slot[i];
+
+		if (zram->table[index].handle ||
+		    zram_test_flag(zram, index, ZRAM_ZERO))
+			zram_free_page(zram, index);
+
+		if (slot->zero) {
+			zram_stat_inc(&zram->stats.pages_zero);
+			zram_set_flag(zram, index, ZRAM_ZERO);
+			continue;
+		}
+
+		if (slot->err == -ENOSPC) {
+			ret = zram_store_page(zram, index, bvec->bv_page, NULL,
+					      PAGE_SIZE);
+		} else if (slot->err) {
+			pr_err("Compression failed! err=%d\n", slot->err);
+			ret = slot->err;
+		} else {
+			ret = zram_store_page(zram, index, bvec->bv_page,
+					      slot->buf, slot->req->dlen);
+		}
+		if (ret)
+			break;
+	}
+	up_write(&zram->lock);
+
+	if (ret)
+		zram_stat64_inc(zram, &zram->stats.failed_writes);
+	return ret;
+}
+
+/*
+ * Write @bio through the async compressor.  Returns -EAGAIN, having done
+ * nothing, for bios with partial pages, which take the sync path.
+ */
+static int zram_write_async(struct zram *zram, struct bio *bio)
+{
+	struct zram_acomp_batch *batch;
+	struct bio_vec *bvec;
+	u32 index;
+	int i, nr;
+	int ret = 0;
+
+	if (!zram->acomp ||
+	    bio->bi_sector & (SECTORS_PER_PAGE - 1))
+		return -EAGAIN;
+
+	bio_for_each_segment(bvec, bio, i) {
+		if (is_partial_io(bvec))
+			return -EAGAIN;
+	}
+
+	/* One batch at a time, so that waiting on the pool cannot deadlock */
+	batch = mempool_alloc(zram->acomp_pool, GFP_NOIO);
+	init_completion(&batch->done);
+
+	index = bio->bi_sector >> SECTORS_PER_PAGE_SHIFT;
+	for (i = bio->bi_idx; i < bio->bi_vcnt; i += nr, index += nr) {
+		nr = min(bio->bi_vcnt - i, ZRAM_ACOMP_BATCH);
+		ret = zram_write_batch(zram, batch, bio, i, nr, index);
+		if (ret)
+			break;
+	}
+
+	mempool_free(batch, zram->acomp_pool);
+	return ret;
+}
+
+static void zram_acomp_init(struct zram *zram)
+{
+	struct crypto_acomp *tfm;
+
+	if (!zram->async_comp)
+		return;
+
+	tfm = crypto_alloc_acomp("lzo", 0, 0);
+	if (IS_ERR(tfm)) {
+		pr_info("Async compression unavailable: err=%ld, "
+			"using sync path\n", PTR_ERR(tfm));
+		return;
+	}
+
+	zram->acomp_pool = mempool_create(ZRAM_ACOMP_RESERVE,
+					  zram_acomp_batch_alloc,
+					  zram_acomp_batch_free, tfm);
+	if (!zram->acomp_pool) {
+		pr_info("Error allocating async compression requests, "
+			"using sync path\n");
+		crypto_free_acomp(tfm);
+		return;
+	}
+
+	zram->acomp = tfm;
+}
+
+static void zram_acomp_exit(struct zram *zram)
+{
+	if (!zram->acomp)
+		return;
+
+	mempool_destroy(zram->acomp_pool);
+	crypto_free_acomp(zram->acomp);
+	zram->acomp_pool = NULL;
+	zram->acomp = NULL;
+}
+#else
+static inline int zram_write_async(struct zram *zram, struct bio *bio)
+{
+	return -EAGAIN;
+}
+
+static inline void zram_acomp_init(struct zram *zram)
+{
+}
+
+static inline void zram_acomp_exit(struct zram *zram)
+{
+}
+#endif
+
 static void update_position(u32 *index, int *offset, struct bio_vec *bvec)
 {
 	if (*offset + bvec->bv_len >= PAGE_SIZE)
@@ -477,7 +728,7 @@ static void update_position(u32 *index, int *offset, struct bio_vec *bvec)
 
 static void __zram_make_request(struct zram *zram, struct bio *bio, int rw)
 {
-	int i, offset;
+	int i, offset, ret;
 	u32 index;
 	struct bio_vec *bvec;
 
@@ -487,7 +738,13 @@ static void __zram_make_request(struct zram *zram, struct bio *bio, int rw)
 		break;
 	case WRITE:
 		zram_stat64_inc(zram, &zram->stats.num_writes);
-		break;
+
+		ret = zram_write_async(zram, bio);
+		if (ret == -EAGAIN)
+			break;
+		if (ret)
+			goto out;
+		goto done;
 	}
 
 	index = bio->bi_sector >> SECTORS_PER_PAGE_SHIFT;
@@ -522,6 +779,7 @@ static void __zram_make_request(struct zram *zram, struct bio *bio, int rw)
 		update_position(&index, &offset, bvec);
 	}
 
+done:
 	set_bit(BIO_UPTODATE, &bio->bi_flags);
 	bio_endio(bio, 0);
 	return;
@@ -584,6 +842,7 @@ void __zram_reset_device(struct zram *zram)
 	zram->init_done = 0;
 
 	/* Free various per-device buffers */
+	zram_acomp_exit(zram);
 	kfree(zram->compress_workmem);
 	free_pages((unsigned long)zram->compress_buffer, 1);
 
@@ -670,6 +929,8 @@ int zram_init_device(struct zram *zram)
 		goto fail;
 	}
 
+	zram_acomp_init(zram);
+
 	zram->init_done = 1;
 	up_write(&zram->init_lock);
 
@@ -760,6 +1021,9 @@ static int create_device(struct zram *zram, int device_id)
 	}
 
 	zram->init_done = 0;
+#ifdef CONFIG_ZRAM_ASYNC_COMP
+	zram->async_comp = 1;
+#endif
 
 out:
 	return ret;
@@ -17,6 +17,7 @@
 
 #include <linux/spinlock.h>
 #include <linux/mutex.h>
+#include <linux/mempool.h>
 
 #include "../zsmalloc/zsmalloc.h"
 
@@ -57,6 +58,14 @@ static const size_t max_zpage_size = PAGE_SIZE / 4 * 3;
 
 /*-- End of configurable params */
 
+#ifdef CONFIG_ZRAM_ASYNC_COMP
+/* Max number of pages of one write compressed in parallel */
+#define ZRAM_ACOMP_BATCH	16
+
+/* Batches kept in reserve so that writeback can progress without memory */
+#define ZRAM_ACOMP_RESERVE	2
+#endif
+
 #define SECTOR_SHIFT		9
 #define SECTOR_SIZE		(1 << SECTOR_SHIFT)
 #define SECTORS_PER_PAGE_SHIFT	(PAGE_SHIFT - SECTOR_SHIFT)
@@ -121,6 +130,12 @@ struct zram {
 	u64 disksize;	/* bytes */
 
 	struct zram_stats stats;
+
+#ifdef CONFIG_ZRAM_ASYNC_COMP
+	int async_comp;	/* compress full page writes through acomp */
+	struct crypto_acomp *acomp;
+	mempool_t *acomp_pool;	/* of struct zram_acomp_batch */
+#endif
 };
 
 extern struct zram *zram_devices;
@@ -25,15 +25,22 @@
 #include <linux/mutex.h>
 #include <linux/slab.h>
 #include <linux/buffer_head.h>
+#include <linux/percpu.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
 #include "decompressor.h"
 #include "squashfs.h"
+#include "page_actor.h"
 
 /*
  * This file (and decompressor.h) implements a decompressor framework for
- * Squashfs, allowing multiple decompressors to be easily supported
+ * Squashfs, allowing multiple decompressors to be easily supported.
+ *
+ * Each CPU has its own decompressor stream, so blocks are decompressed in
+ * parallel when several threads read from the filesystem.  A stream is
+ * used with preemption disabled, which requires the decompressors to be
+ * handed buffer_heads that have already been read.
  */
 
 static const struct squashfs_decompressor squashfs_lzma_unsupported_comp_ops = {
@@ -46,6 +53,12 @@ static const struct squashfs_decompressor squashfs_lzo_comp_ops = {
 };
 #endif
 
+#ifndef CONFIG_SQUASHFS_LZ4
+static const struct squashfs_decompressor squashfs_lz4_comp_ops = {
+	NULL, NULL, NULL, LZ4_COMPRESSION, "lz4", 0
+};
+#endif
+
 #ifndef CONFIG_SQUASHFS_XZ
 static const struct squashfs_decompressor squashfs_xz_comp_ops = {
 	NULL, NULL, NULL, XZ_COMPRESSION, "xz", 0
@@ -66,6 +79,7 @@ static const struct squashfs_decompressor *decompressor[] = {
 	&squashfs_zlib_comp_ops,
 	&squashfs_lzo_comp_ops,
 	&squashfs_xz_comp_ops,
+	&squashfs_lz4_comp_ops,
 	&squashfs_lzma_unsupported_comp_ops,
 	&squashfs_unknown_comp_ops
 };
@@ -83,34 +97,82 @@ const struct squashfs_decompressor *squashfs_lookup_decompressor(int id)
 }
 
 
-void *squashfs_decompressor_init(struct super_block *sb, unsigned short flags)
+void squashfs_decompressor_free(struct squashfs_sb_info *msblk)
+{
+	int cpu;
+
+	if (!msblk->stream)
+		return;
+
+	for_each_possible_cpu(cpu)
+		msblk->decompressor->free(per_cpu_ptr(msblk->stream,
+							cpu)->stream);
+
+	free_percpu(msblk->stream);
+	msblk->stream = NULL;
+}
+
+
+int squashfs_decompressor_init(struct super_block *sb, unsigned short flags)
 {
 	struct squashfs_sb_info *msblk = sb->s_fs_info;
+	struct squashfs_page_actor actor;
 	void *strm, *buffer = NULL;
-	int length = 0;
+	int length = 0, err = 0, cpu;
+
+	msblk->stream = alloc_percpu(struct squashfs_stream);
+	if (msblk->stream == NULL)
+		return -ENOMEM;
 
 	/*
 	 * Read decompressor specific options from file system if present
 	 */
 	if (SQUASHFS_COMP_OPTS(flags)) {
 		buffer = kmalloc(PAGE_CACHE_SIZE, GFP_KERNEL);
-		if (buffer == NULL)
-			return ERR_PTR(-ENOMEM);
+		if (buffer == NULL) {
+			err = -ENOMEM;
+			goto finished;
+		}
 
-		length = squashfs_read_data(sb, &buffer,
-			sizeof(struct squashfs_super_block), 0, NULL,
-			PAGE_CACHE_SIZE, 1);
+		squashfs_page_actor_init(&actor, &buffer, 1, 0);
+		length = squashfs_read_data(sb,
+			sizeof(struct squashfs_super_block), 0, NULL, &actor);
 
 		if (length < 0) {
-			strm = ERR_PTR(length);
+			err = length;
 			goto finished;
 		}
 	}
 
-	strm = msblk->decompressor->init(msblk, buffer, length);
+	for_each_possible_cpu(cpu) {
+		strm = msblk->decompressor->init(msblk, buffer, length);
+		if (IS_ERR(strm)) {
+			err = PTR_ERR(strm);
+			goto finished;
+		}
+		per_cpu_ptr(msblk->stream, cpu)->stream = strm;
+	}
 
 finished:
 	kfree(buffer);
+	if (err)
+		squashfs_decompressor_free(msblk);
+
+	return err;
+}
+
+
+int squashfs_decompress(struct squashfs_sb_info *msblk,
+	struct buffer_head **bh, int b, int offset, int length,
+	struct squashfs_page_actor *output)
+{
+	struct squashfs_stream *stream = get_cpu_ptr(msblk->stream);
+	int res;
+
+	res = msblk->decompressor->decompress(msblk, stream->stream, bh, b,
+		offset, length, output);
+
+	put_cpu_ptr(msblk->stream);
 
-	return strm;
+	return res;
 }
@@ -52,6 +52,7 @@
 #include "squashfs_fs_sb.h"
 #include "squashfs_fs_i.h"
 #include "squashfs.h"
+#include "page_actor.h"
 
 /*
  * Locate cache slot in range [offset, index] for specified inode.  If
@@ -371,6 +372,98 @@ static int read_blocklist(struct inode *inode, int index, u64 *block)
 }
 
 
+/*
+ * Upper bound on the pages of one datablock decompressed straight into the
+ * page cache; all of them stay locked for the duration of the read.
+ */
+#define SQUASHFS_DIRECT_MAX_PAGES	(131072 >> PAGE_CACHE_SHIFT)
+
+/*
+ * Decompress a whole datablock directly into its page cache pages, avoiding
+ * the read_page cache and the copy out of it.  This is only possible if
+ * every page of the block other than @target_page can be grabbed and is not
+ * already up to date, otherwise -EAGAIN is returned with nothing changed and
+ * the caller uses the cached path.  On success all pages are unlocked.
+ */
+static int squashfs_readpage_direct(struct page *target_page, u64 block,
+	int bsize)
+{
+	struct inode *inode = target_page->mapping->host;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	int mask = (1 << (msblk->block_log - PAGE_CACHE_SHIFT)) - 1;
+	int start_index = target_page->index & ~mask;
+	int end_index = start_index | mask;
+	int file_end = (i_size_read(inode) - 1) >> PAGE_CACHE_SHIFT;
+	int i, n, pages, avail, res = -EAGAIN;
+	struct squashfs_page_actor actor;
+	struct page **page;
+
+	if (end_index > file_end)
+		end_index = file_end;
+	pages = end_index - start_index + 1;
+	if (pages > SQUASHFS_DIRECT_MAX_PAGES)
+		return -EAGAIN;
+
+	page = kmalloc(pages * sizeof(*page), GFP_KERNEL);
+	if (page == NULL)
+		goto out;
+
+	for (i = 0, n = start_index; n <= end_index; i++, n++) {
+		page[i] = (n == target_page->index) ? target_page :
+			grab_cache_page_nowait(target_page->mapping, n);
+
+		if (page[i] == NULL)
+			goto release_pages;
+
+		if (page[i] != target_page && PageUptodate(page[i])) {
+			unlock_page(page[i]);
+			page_cache_release(page[i]);
+			goto release_pages;
+		}
+	}
+
+	squashfs_page_actor_init_special(&actor, page, pages,
+		msblk->block_size);
+	res = squashfs_read_data(inode->i_sb, block, bsize, NULL, &actor);
+
+	for (i = 0; i < pages; i++) {
+		if (res >= 0) {
+			avail = max_t(int, 0, res - (i << PAGE_CACHE_SHIFT));
+			if (avail < PAGE_CACHE_SIZE)
+				zero_user_segment(page[i], avail,
+					PAGE_CACHE_SIZE);
+			flush_dcache_page(page[i]);
+			SetPageUptodate(page[i]);
+		} else if (page[i] == target_page)
+			continue;
+
+		unlock_page(page[i]);
+		if (page[i] != target_page)
+			page_cache_release(page[i]);
+	}
+
+	if (res < 0) {
+		ERROR("Unable to read page, block %llx, size %x\n", block,
+			bsize);
+		res = -EIO;
+	} else
+		res = 0;
+	goto out;
+
+release_pages:
+	while (i--) {
+		if (page[i] == target_page)
+			continue;
+		unlock_page(page[i]);
+		page_cache_release(page[i]);
+	}
+
+out:
+	kfree(page);
+	return res;
+}
+
+
 static int squashfs_readpage(struct file *file, struct page *page)
 {
 	struct inode *inode = page->mapping->host;
@@ -409,6 +502,12 @@ static int squashfs_readpage(struct file *file, struct page *page)
 				 msblk->block_size;
 			sparse = 1;
 		} else {
+			int res = squashfs_readpage_direct(page, block, bsize);
+			if (res == 0)
+				return 0;
+			if (res != -EAGAIN)
+				goto error_out;
+
 			/*
 			 * Read and decompress datablock.
 			 */
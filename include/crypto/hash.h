@@ -67,11 +67,15 @@ struct shash_alg {
 		     unsigned int len, u8 *out);
 	int (*digest)(struct shash_desc *desc, const u8 *data,
 		      unsigned int len, u8 *out);
+	int (*finup_mb)(struct shash_desc *desc, const u8 * const data[],
+			unsigned int len, u8 * const outs[],
+			unsigned int num_msgs);
 	int (*export)(struct shash_desc *desc, void *out);
 	int (*import)(struct shash_desc *desc, const void *in);
 	int (*setkey)(struct crypto_shash *tfm, const u8 *key,
 		      unsigned int keylen);
 
+	unsigned int mb_max_msgs;
 	unsigned int descsize;
 
 	
@@ -319,6 +323,11 @@ static inline unsigned int crypto_shash_descsize(struct crypto_shash *tfm)
 	return tfm->descsize;
 }
 
+static inline unsigned int crypto_shash_mb_max_msgs(struct crypto_shash *tfm)
+{
+	return crypto_shash_alg(tfm)->mb_max_msgs;
+}
+
 static inline void *shash_desc_ctx(struct shash_desc *desc)
 {
 	return desc->__ctx;
@@ -350,4 +359,17 @@ int crypto_shash_final(struct shash_desc *desc, u8 *out);
 int crypto_shash_finup(struct shash_desc *desc, const u8 *data,
 		       unsigned int len, u8 *out);
 
+/*
+ * Finish @num_msgs independent messages of @len bytes each, all starting
+ * from the state in @desc, which is left unchanged.  Algorithms that set
+ * ->finup_mb hash up to crypto_shash_mb_max_msgs() of them in one
+ * interleaved pass, the others one after the other.
+ */
+int crypto_shash_finup_mb(struct shash_desc *desc, const u8 * const data[],
+			  unsigned int len, u8 * const outs[],
+			  unsigned int num_msgs);
+int crypto_shash_digest_mb(struct shash_desc *desc, const u8 * const data[],
+			   unsigned int len, u8 * const outs[],
+			   unsigned int num_msgs);
+
 #endif	
@@ -0,0 +1,67 @@
+/*
+ * Asynchronous compression: Compression algorithms under the crypto API
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ */
+
+#ifndef _CRYPTO_INTERNAL_ACOMPRESS_H
+#define _CRYPTO_INTERNAL_ACOMPRESS_H
+
+#include <crypto/algapi.h>
+#include <crypto/acompress.h>
+
+struct acomp_instance {
+	struct acomp_alg alg;
+};
+
+extern const struct crypto_type crypto_acomp_type;
+
+int crypto_register_acomp(struct acomp_alg *alg);
+int crypto_unregister_acomp(struct acomp_alg *alg);
+int acomp_register_instance(struct crypto_template *tmpl,
+			    struct acomp_instance *inst);
+
+static inline void *crypto_acomp_ctx(struct crypto_acomp *tfm)
+{
+	return crypto_tfm_ctx(crypto_acomp_tfm(tfm));
+}
+
+static inline void crypto_acomp_set_reqsize(struct crypto_acomp *tfm,
+					    unsigned int reqsize)
+{
+	tfm->reqsize = reqsize;
+}
+
+static inline void *acomp_request_ctx(struct acomp_req *req)
+{
+	return req->__ctx;
+}
+
+static inline struct crypto_instance *acomp_crypto_instance(
+	struct acomp_instance *inst)
+{
+	return container_of(&inst->alg.base, struct crypto_instance, alg);
+}
+
+static inline struct acomp_instance *acomp_instance(
+	struct crypto_instance *inst)
+{
+	return container_of(__crypto_acomp_alg(&inst->alg),
+			    struct acomp_instance, alg);
+}
+
+static inline void *acomp_instance_ctx(struct acomp_instance *inst)
+{
+	return crypto_instance_ctx(acomp_crypto_instance(inst));
+}
+
+static inline unsigned int acomp_instance_headroom(void)
+{
+	return sizeof(struct acomp_alg) - sizeof(struct crypto_alg);
+}
+
+#endif	/* _CRYPTO_INTERNAL_ACOMPRESS_H */
@@ -227,12 +227,20 @@ struct queue_limits {
 	unsigned char		discard_zeroes_data;
 };
 
+struct blk_queue_lock_stats {
+	unsigned long		bios;
+	unsigned long		lock_acquisitions;
+	unsigned long		plug_allocs;
+	unsigned long		plug_merges;
+};
+
 struct request_queue {
 	struct list_head	queue_head;
 	struct request		*last_merge;
 	struct elevator_queue	*elevator;
 
 	struct request_list	rq;
+	struct blk_queue_lock_stats __percpu *lock_stats;
 
 	request_fn_proc		*request_fn;
 	make_request_fn		*make_request_fn;
@@ -739,8 +747,11 @@ struct blk_plug {
 	struct list_head list; 
 	struct list_head cb_list; 
 	unsigned int should_sort; 
+	struct request_queue *rq_q;
+	unsigned int rq_credits[2];
 };
 #define BLK_MAX_REQUEST_COUNT 16
+#define BLK_PLUG_RQ_BATCH 8
 
 struct blk_plug_cb {
 	struct list_head list;
@@ -12,6 +12,8 @@ extern u32  crc32_le(u32 crc, unsigned char const *p, size_t len);
 extern u32  crc32_be(u32 crc, unsigned char const *p, size_t len);
 
 extern u32  __crc32c_le(u32 crc, unsigned char const *p, size_t len);
+extern void __crc32c_le_mb(u32 *crcs, unsigned char const * const p[],
+			   size_t len, unsigned int n);
 
 #define crc32(seed, data, length)  crc32_le(seed, (unsigned char const *)(data), length)
 
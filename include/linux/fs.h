@@ -464,6 +464,7 @@ struct address_space {
 	struct mutex		i_mmap_mutex;	
 	
 	unsigned long		nrpages;	
+	unsigned long		nrshadows;	
 	pgoff_t			writeback_index;
 	const struct address_space_operations *a_ops;	
 	unsigned long		flags;		
@@ -737,6 +738,10 @@ struct file {
 	struct fown_struct	f_owner;
 	const struct cred	*f_cred;
 	struct file_ra_state	f_ra;
+#ifdef CONFIG_READAHEAD_PATTERN
+	struct ra_pattern	*f_ra_pattern;
+	unsigned long		f_ra_pattern_until;
+#endif
 
 	u64			f_version;
 #ifdef CONFIG_SECURITY
@@ -1205,6 +1210,7 @@ struct super_block {
 };
 
 extern void prune_icache_sb(struct super_block *sb, int nr_to_scan);
+extern void prune_icache_shadows(void);
 extern void prune_dcache_sb(struct super_block *sb, int nr_to_scan);
 
 extern struct timespec current_fs_time(struct super_block *sb);
@@ -2111,6 +2117,8 @@ extern struct super_block *get_super_thawed(struct block_device *);
 extern struct super_block *get_active_super(struct block_device *bdev);
 extern void drop_super(struct super_block *sb);
 extern void iterate_supers(void (*)(struct super_block *, void *), void *);
+extern void iterate_supers_passive(void (*)(struct super_block *, void *),
+				   void *);
 extern void iterate_supers_type(struct file_system_type *,
 			        void (*)(struct super_block *, void *), void *);
 
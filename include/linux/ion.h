@@ -29,6 +29,7 @@ enum ion_heap_type {
 	ION_HEAP_TYPE_IOMMU,
 	ION_HEAP_TYPE_CP,
 	ION_HEAP_TYPE_CUSTOM, 
+	ION_HEAP_TYPE_CMA,
 	ION_NUM_HEAPS,
 };
 
@@ -36,6 +37,7 @@ enum ion_heap_type {
 #define ION_HEAP_SYSTEM_CONTIG_MASK	(1 << ION_HEAP_TYPE_SYSTEM_CONTIG)
 #define ION_HEAP_CARVEOUT_MASK		(1 << ION_HEAP_TYPE_CARVEOUT)
 #define ION_HEAP_CP_MASK		(1 << ION_HEAP_TYPE_CP)
+#define ION_HEAP_CMA_MASK		(1 << ION_HEAP_TYPE_CMA)
 
 
 
@@ -103,6 +105,7 @@ enum cp_mem_usage {
 #ifdef __KERNEL__
 #include <linux/err.h>
 #include <mach/ion.h>
+struct device;
 struct ion_device;
 struct ion_heap;
 struct ion_mapper;
@@ -149,6 +152,10 @@ struct ion_co_heap_pdata {
 	void *(*setup_region)(void);
 };
 
+struct ion_cma_heap_pdata {
+	struct device *dev;
+};
+
 struct ion_platform_data {
 	unsigned int has_outer_cache;
 	int nr;
@@ -37,6 +37,8 @@ struct mem_cgroup_reclaim_cookie {
 	unsigned int generation;
 };
 
+#define MEM_CGROUP_RECLAIM_PRIO_MAX	3
+
 #ifdef CONFIG_CGROUP_MEM_RES_CTLR
 
 extern int mem_cgroup_newpage_charge(struct page *page, struct mm_struct *mm,
@@ -103,6 +105,10 @@ int mem_cgroup_inactive_anon_is_low(struct mem_cgroup *memcg,
 int mem_cgroup_inactive_file_is_low(struct mem_cgroup *memcg,
 				    struct zone *zone);
 int mem_cgroup_select_victim_node(struct mem_cgroup *memcg);
+int mem_cgroup_reclaim_priority(struct mem_cgroup *memcg);
+bool mem_cgroup_reclaim_prioritized(void);
+void mem_cgroup_vmpressure(struct mem_cgroup *memcg, unsigned long scanned,
+			   unsigned long reclaimed);
 unsigned long mem_cgroup_zone_nr_lru_pages(struct mem_cgroup *memcg,
 					int nid, int zid, unsigned int lrumask);
 struct zone_reclaim_stat *mem_cgroup_get_reclaim_stat(struct mem_cgroup *memcg,
@@ -335,6 +341,22 @@ mem_cgroup_zone_nr_lru_pages(struct mem_cgroup *memcg, int nid, int zid,
 	return 0;
 }
 
+static inline int mem_cgroup_reclaim_priority(struct mem_cgroup *memcg)
+{
+	return MEM_CGROUP_RECLAIM_PRIO_MAX;
+}
+
+static inline bool mem_cgroup_reclaim_prioritized(void)
+{
+	return false;
+}
+
+static inline void mem_cgroup_vmpressure(struct mem_cgroup *memcg,
+					 unsigned long scanned,
+					 unsigned long reclaimed)
+{
+}
+
 
 static inline struct zone_reclaim_stat*
 mem_cgroup_get_reclaim_stat(struct mem_cgroup *memcg, struct zone *zone)
@@ -161,6 +161,9 @@ struct vm_area_struct {
 	struct file * vm_file;		
 	void * vm_private_data;		
 
+#ifdef CONFIG_SWAP
+	atomic_long_t swap_readahead_info;
+#endif
 #ifndef CONFIG_MMU
 	struct vm_region *vm_region;	
 #endif
@@ -106,6 +106,8 @@ enum zone_stat_item {
 	NR_SHMEM,		
 	NR_DIRTIED,		
 	NR_WRITTEN,		
+	WORKINGSET_REFAULT,
+	WORKINGSET_ACTIVATE,
 #ifdef CONFIG_NUMA
 	NUMA_HIT,		
 	NUMA_MISS,		
@@ -282,6 +284,8 @@ struct zone {
 	unsigned long		pages_scanned;	   
 	unsigned long		flags;		   
 
+	atomic_long_t		inactive_age;
+
 	
 	atomic_long_t		vm_stat[NR_VM_ZONE_STAT_ITEMS];
 
@@ -428,6 +432,12 @@ typedef struct pglist_data {
 	struct task_struct *kswapd;	
 	int kswapd_max_order;
 	enum zone_type classzone_idx;
+#ifdef CONFIG_COMPACTION
+	int kcompactd_max_order;
+	enum zone_type kcompactd_classzone_idx;
+	wait_queue_head_t kcompactd_wait;
+	struct task_struct *kcompactd;
+#endif
 } pg_data_t;
 
 #define node_present_pages(nid)	(NODE_DATA(nid)->node_present_pages)
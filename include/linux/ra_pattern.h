@@ -0,0 +1,39 @@
+#ifndef _LINUX_RA_PATTERN_H
+#define _LINUX_RA_PATTERN_H
+
+#include <linux/fs.h>
+
+#ifdef CONFIG_READAHEAD_PATTERN
+
+extern int sysctl_readahead_pattern;
+extern unsigned int sysctl_readahead_pattern_window_ms;
+
+extern void ra_pattern_open(struct file *file);
+extern void ra_pattern_release(struct file *file);
+extern void __ra_pattern_record(struct file *file, pgoff_t start,
+				unsigned long nr);
+
+static inline void ra_pattern_record(struct file *file, pgoff_t start,
+				     unsigned long nr)
+{
+	if (file && unlikely(file->f_ra_pattern_until) && nr)
+		__ra_pattern_record(file, start, nr);
+}
+
+#else
+
+static inline void ra_pattern_open(struct file *file)
+{
+}
+
+static inline void ra_pattern_release(struct file *file)
+{
+}
+
+static inline void ra_pattern_record(struct file *file, pgoff_t start,
+				     unsigned long nr)
+{
+}
+
+#endif
+#endif
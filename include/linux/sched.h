@@ -354,6 +354,7 @@ extern int get_dumpable(struct mm_struct *mm);
 					
 #define MMF_VM_MERGEABLE	16	
 #define MMF_VM_HUGEPAGE		17	
+#define MMF_OOM_REAPED		18
 
 #define MMF_INIT_MASK		(MMF_DUMPABLE_MASK | MMF_DUMP_FILTER_MASK)
 
@@ -1298,6 +1299,10 @@ struct task_struct {
 #ifdef CONFIG_HAVE_HW_BREAKPOINT
 	atomic_t ptrace_bp_refcnt;
 #endif
+#ifdef CONFIG_MMU
+	struct task_struct *oom_reaper_list;
+	u64 oom_reap_queued;
+#endif
 };
 
 #define tsk_cpus_allowed(tsk) (&(tsk)->cpus_allowed)
@@ -1148,6 +1148,10 @@ static struct task_struct *copy_process(unsigned long clone_flags,
 	p->memcg_batch.do_batch = 0;
 	p->memcg_batch.memcg = NULL;
 #endif
+#ifdef CONFIG_MMU
+	p->oom_reaper_list = NULL;
+	p->oom_reap_queued = 0;
+#endif
 
 	
 	sched_fork(p);
@@ -59,6 +59,9 @@
 #ifdef CONFIG_RT_MUTEXES
 #include <linux/rtmutex.h>
 #endif
+#ifdef CONFIG_READAHEAD_PATTERN
+#include <linux/ra_pattern.h>
+#endif
 #if defined(CONFIG_PROVE_LOCKING) || defined(CONFIG_LOCK_STAT)
 #include <linux/lockdep.h>
 #endif
@@ -229,6 +232,8 @@ static int max_sched_tunable_scaling = SCHED_TUNABLESCALING_END-1;
 #ifdef CONFIG_COMPACTION
 static int min_extfrag_threshold;
 static int max_extfrag_threshold = 1000;
+static int min_compaction_order = 1;
+static int max_compaction_order = MAX_ORDER - 1;
 #endif
 
 static struct ctl_table kern_table[] = {
@@ -1031,6 +1036,17 @@ static struct ctl_table vm_table[] = {
 		.proc_handler	= proc_dointvec_minmax,
 		.extra1		= &zero,
 	},
+#ifdef CONFIG_SWAP
+	{
+		.procname	= "swap_vma_readahead",
+		.data		= &sysctl_swap_vma_readahead,
+		.maxlen		= sizeof(sysctl_swap_vma_readahead),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &zero,
+		.extra2		= &one,
+	},
+#endif
 	{
 		.procname	= "dirty_background_ratio",
 		.data		= &dirty_background_ratio,
@@ -1174,8 +1190,53 @@ static struct ctl_table vm_table[] = {
 		.extra1		= &min_extfrag_threshold,
 		.extra2		= &max_extfrag_threshold,
 	},
+	{
+		.procname	= "compaction_target_order",
+		.data		= &sysctl_compaction_target_order,
+		.maxlen		= sizeof(sysctl_compaction_target_order),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &min_compaction_order,
+		.extra2		= &max_compaction_order,
+	},
+	{
+		.procname	= "compaction_target_blocks",
+		.data		= &sysctl_compaction_target_blocks,
+		.maxlen		= sizeof(sysctl_compaction_target_blocks),
+		.mode		= 0644,
+		.proc_handler	= sysctl_compaction_target_handler,
+		.extra1		= &zero,
+	},
+	{
+		.procname	= "compaction_cpu_budget",
+		.data		= &sysctl_compaction_cpu_budget,
+		.maxlen		= sizeof(sysctl_compaction_cpu_budget),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &one,
+		.extra2		= &one_hundred,
+	},
 
 #endif 
+#ifdef CONFIG_READAHEAD_PATTERN
+	{
+		.procname	= "readahead_pattern",
+		.data		= &sysctl_readahead_pattern,
+		.maxlen		= sizeof(sysctl_readahead_pattern),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &zero,
+		.extra2		= &two,
+	},
+	{
+		.procname	= "readahead_pattern_window_ms",
+		.data		= &sysctl_readahead_pattern_window_ms,
+		.maxlen		= sizeof(sysctl_readahead_pattern_window_ms),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &zero,
+	},
+#endif
 	{
 		.procname	= "min_free_kbytes",
 		.data		= &min_free_kbytes,
@@ -28,6 +28,11 @@
 #include <linux/crc32.h>
 #include <linux/module.h>
 #include <linux/types.h>
+#include <linux/debugfs.h>
+#include <linux/hrtimer.h>
+#include <linux/math64.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
 #include "crc32defs.h"
 
 #if CRC_LE_BITS > 8
@@ -51,7 +56,8 @@ MODULE_LICENSE("GPL");
 #if CRC_LE_BITS > 8 || CRC_BE_BITS > 8
 
 static inline u32
-crc32_body(u32 crc, unsigned char const *buf, size_t len, const u32 (*tab)[256])
+crc32_body(u32 crc, unsigned char const *buf, size_t len, const u32 (*tab)[256],
+	   int slices)
 {
 # ifdef __LITTLE_ENDIAN
 #  define DO_CRC(x) crc = t0[(crc ^ (x)) & 255] ^ (crc >> 8)
@@ -75,6 +81,12 @@ crc32_body(u32 crc, unsigned char const *buf, size_t len, const u32 (*tab)[256])
 	const u32 *t4 = tab[4], *t5 = tab[5], *t6 = tab[6], *t7 = tab[7];
 	u32 q;
 
+	if (slices == 1) {
+		while (len--)
+			DO_CRC(*buf++);
+		return crc;
+	}
+
 	
 	if (unlikely((long)buf & 3 && len)) {
 		do {
@@ -82,13 +94,13 @@ crc32_body(u32 crc, unsigned char const *buf, size_t len, const u32 (*tab)[256])
 		} while ((--len) && ((long)buf)&3);
 	}
 
-# if CRC_LE_BITS == 32
-	rem_len = len & 3;
-	len = len >> 2;
-# else
-	rem_len = len & 7;
-	len = len >> 3;
-# endif
+	if (slices == 4) {
+		rem_len = len & 3;
+		len = len >> 2;
+	} else {
+		rem_len = len & 7;
+		len = len >> 3;
+	}
 
 	b = (const u32 *)buf;
 # ifdef CONFIG_X86
@@ -98,13 +110,13 @@ crc32_body(u32 crc, unsigned char const *buf, size_t len, const u32 (*tab)[256])
 	for (--b; len; --len) {
 # endif
 		q = crc ^ *++b; 
-# if CRC_LE_BITS == 32
-		crc = DO_CRC4;
-# else
-		crc = DO_CRC8;
-		q = *++b;
-		crc ^= DO_CRC4;
-# endif
+		if (slices == 4) {
+			crc = DO_CRC4;
+		} else {
+			crc = DO_CRC8;
+			q = *++b;
+			crc ^= DO_CRC4;
+		}
 	}
 	len = rem_len;
 	
@@ -124,19 +136,93 @@ crc32_body(u32 crc, unsigned char const *buf, size_t len, const u32 (*tab)[256])
 #undef DO_CRC4
 #undef DO_CRC8
 }
+
+static inline u32 crc32_slice_step(u32 crc, const u32 *b,
+				   const u32 (*tab)[256], int slices)
+{
+# ifdef __LITTLE_ENDIAN
+#  define DO_CRC4 (t3[(q) & 255] ^ t2[(q >> 8) & 255] ^ \
+		   t1[(q >> 16) & 255] ^ t0[(q >> 24) & 255])
+#  define DO_CRC8 (t7[(q) & 255] ^ t6[(q >> 8) & 255] ^ \
+		   t5[(q >> 16) & 255] ^ t4[(q >> 24) & 255])
+# else
+#  define DO_CRC4 (t0[(q) & 255] ^ t1[(q >> 8) & 255] ^ \
+		   t2[(q >> 16) & 255] ^ t3[(q >> 24) & 255])
+#  define DO_CRC8 (t4[(q) & 255] ^ t5[(q >> 8) & 255] ^ \
+		   t6[(q >> 16) & 255] ^ t7[(q >> 24) & 255])
+# endif
+	const u32 *t0 = tab[0], *t1 = tab[1], *t2 = tab[2], *t3 = tab[3];
+	const u32 *t4 = tab[4], *t5 = tab[5], *t6 = tab[6], *t7 = tab[7];
+	u32 q;
+
+	q = crc ^ b[0];
+	if (slices == 4)
+		return DO_CRC4;
+	crc = DO_CRC8;
+	q = b[1];
+	return crc ^ DO_CRC4;
+#undef DO_CRC4
+#undef DO_CRC8
+}
 #endif
 
-static inline u32 __pure crc32_le_generic(u32 crc, unsigned char const *p,
-					  size_t len, const u32 (*tab)[256],
-					  u32 polynomial)
+static inline u32 __pure crc32_le_bitwise(u32 crc, unsigned char const *p,
+					  size_t len, u32 polynomial)
 {
-#if CRC_LE_BITS == 1
 	int i;
 	while (len--) {
 		crc ^= *p++;
 		for (i = 0; i < 8; i++)
 			crc = (crc >> 1) ^ ((crc & 1) ? polynomial : 0);
 	}
+	return crc;
+}
+
+#if CRC_LE_BITS > 8
+static inline u32 __pure crc32_le_slices(u32 crc, unsigned char const *p,
+					 size_t len, const u32 (*tab)[256],
+					 int slices)
+{
+	crc = (__force u32) __cpu_to_le32(crc);
+	crc = crc32_body(crc, p, len, tab, slices);
+	return __le32_to_cpu((__force __le32)crc);
+}
+
+/*
+ * Two buffers of the same length, both 32-bit aligned, through interleaved
+ * slice-by-4/8 chains.  Each chain stalls on its own table loads, the
+ * other one fills the gaps.
+ */
+static inline void crc32_le_slices_x2(u32 *crc, unsigned char const *p0,
+				      unsigned char const *p1, size_t len,
+				      const u32 (*tab)[256], int slices)
+{
+	const u32 *b0 = (const u32 *)p0, *b1 = (const u32 *)p1;
+	u32 c0 = (__force u32) __cpu_to_le32(crc[0]);
+	u32 c1 = (__force u32) __cpu_to_le32(crc[1]);
+	size_t n;
+
+	for (n = len / slices; n; n--) {
+		c0 = crc32_slice_step(c0, b0, tab, slices);
+		c1 = crc32_slice_step(c1, b1, tab, slices);
+		b0 += slices / 4;
+		b1 += slices / 4;
+	}
+
+	len &= slices - 1;
+	c0 = crc32_body(c0, (unsigned char const *)b0, len, tab, slices);
+	c1 = crc32_body(c1, (unsigned char const *)b1, len, tab, slices);
+	crc[0] = __le32_to_cpu((__force __le32)c0);
+	crc[1] = __le32_to_cpu((__force __le32)c1);
+}
+#endif
+
+static inline u32 __pure crc32_le_generic(u32 crc, unsigned char const *p,
+					  size_t len, const u32 (*tab)[256],
+					  u32 polynomial)
+{
+#if CRC_LE_BITS == 1
+	crc = crc32_le_bitwise(crc, p, len, polynomial);
 # elif CRC_LE_BITS == 2
 	while (len--) {
 		crc ^= *p++;
@@ -158,13 +244,12 @@ static inline u32 __pure crc32_le_generic(u32 crc, unsigned char const *p,
 		crc = (crc >> 8) ^ tab[0][crc & 255];
 	}
 # else
-	crc = (__force u32) __cpu_to_le32(crc);
-	crc = crc32_body(crc, p, len, tab);
-	crc = __le32_to_cpu((__force __le32)crc);
+	crc = crc32_le_slices(crc, p, len, tab, CRC_LE_BITS / 8);
 #endif
 	return crc;
 }
 
+#ifndef CONFIG_CRC32_RUNTIME
 #if CRC_LE_BITS == 1
 u32 __pure crc32_le(u32 crc, unsigned char const *p, size_t len)
 {
@@ -186,12 +271,31 @@ u32 __pure __crc32c_le(u32 crc, unsigned char const *p, size_t len)
 #endif
 EXPORT_SYMBOL(crc32_le);
 EXPORT_SYMBOL(__crc32c_le);
+#endif
 
-static inline u32 __pure crc32_be_generic(u32 crc, unsigned char const *p,
-					  size_t len, const u32 (*tab)[256],
-					  u32 polynomial)
+/*
+ * CRC32C of @n buffers of @len bytes each, @crcs holding the seeds on
+ * entry and the results on return.  Aligned pairs are interleaved.
+ */
+void __crc32c_le_mb(u32 *crcs, unsigned char const * const p[], size_t len,
+		    unsigned int n)
+{
+#if CRC_LE_BITS > 8
+	for (; n >= 2; n -= 2, crcs += 2, p += 2) {
+		if (((unsigned long)p[0] | (unsigned long)p[1]) & 3)
+			break;
+		crc32_le_slices_x2(crcs, p[0], p[1], len, crc32ctable_le,
+				   CRC_LE_BITS / 8);
+	}
+#endif
+	for (; n; n--, crcs++, p++)
+		*crcs = __crc32c_le(*crcs, *p, len);
+}
+EXPORT_SYMBOL(__crc32c_le_mb);
+
+static inline u32 __pure crc32_be_bitwise(u32 crc, unsigned char const *p,
+					  size_t len, u32 polynomial)
 {
-#if CRC_BE_BITS == 1
 	int i;
 	while (len--) {
 		crc ^= *p++ << 24;
@@ -200,6 +304,26 @@ static inline u32 __pure crc32_be_generic(u32 crc, unsigned char const *p,
 			    (crc << 1) ^ ((crc & 0x80000000) ? polynomial :
 					  0);
 	}
+	return crc;
+}
+
+#if CRC_BE_BITS > 8
+static inline u32 __pure crc32_be_slices(u32 crc, unsigned char const *p,
+					 size_t len, const u32 (*tab)[256],
+					 int slices)
+{
+	crc = (__force u32) __cpu_to_be32(crc);
+	crc = crc32_body(crc, p, len, tab, slices);
+	return __be32_to_cpu((__force __be32)crc);
+}
+#endif
+
+static inline u32 __pure crc32_be_generic(u32 crc, unsigned char const *p,
+					  size_t len, const u32 (*tab)[256],
+					  u32 polynomial)
+{
+#if CRC_BE_BITS == 1
+	crc = crc32_be_bitwise(crc, p, len, polynomial);
 # elif CRC_BE_BITS == 2
 	while (len--) {
 		crc ^= *p++ << 24;
@@ -220,13 +344,12 @@ static inline u32 __pure crc32_be_generic(u32 crc, unsigned char const *p,
 		crc = (crc << 8) ^ tab[0][crc >> 24];
 	}
 # else
-	crc = (__force u32) __cpu_to_be32(crc);
-	crc = crc32_body(crc, p, len, tab);
-	crc = __be32_to_cpu((__force __be32)crc);
+	crc = crc32_be_slices(crc, p, len, tab, CRC_BE_BITS / 8);
 # endif
 	return crc;
 }
 
+#ifndef CONFIG_CRC32_RUNTIME
 #if CRC_LE_BITS == 1
 u32 __pure crc32_be(u32 crc, unsigned char const *p, size_t len)
 {
@@ -239,6 +362,197 @@ u32 __pure crc32_be(u32 crc, unsigned char const *p, size_t len)
 }
 #endif
 EXPORT_SYMBOL(crc32_be);
+#endif
+
+#ifdef CONFIG_CRC32_RUNTIME
+
+struct crc32_impl {
+	const char *name;
+	u32 (*le)(u32 crc, unsigned char const *p, size_t len);
+	u32 (*c_le)(u32 crc, unsigned char const *p, size_t len);
+	u32 (*be)(u32 crc, unsigned char const *p, size_t len);
+	u64 le_mbps;
+	u64 be_mbps;
+};
+
+static u32 __pure crc32_le_bit(u32 crc, unsigned char const *p, size_t len)
+{
+	return crc32_le_bitwise(crc, p, len, CRCPOLY_LE);
+}
+
+static u32 __pure crc32c_le_bit(u32 crc, unsigned char const *p, size_t len)
+{
+	return crc32_le_bitwise(crc, p, len, CRC32C_POLY_LE);
+}
+
+static u32 __pure crc32_be_bit(u32 crc, unsigned char const *p, size_t len)
+{
+	return crc32_be_bitwise(crc, p, len, CRCPOLY_BE);
+}
+
+#define CRC32_TABLE_IMPL(name, slices)					\
+static u32 __pure crc32_le_##name(u32 crc, unsigned char const *p,	\
+				  size_t len)				\
+{									\
+	return crc32_le_slices(crc, p, len, crc32table_le, slices);	\
+}									\
+static u32 __pure crc32c_le_##name(u32 crc, unsigned char const *p,	\
+				   size_t len)				\
+{									\
+	return crc32_le_slices(crc, p, len, crc32ctable_le, slices);	\
+}									\
+static u32 __pure crc32_be_##name(u32 crc, unsigned char const *p,	\
+				  size_t len)				\
+{									\
+	return crc32_be_slices(crc, p, len, crc32table_be, slices);	\
+}
+
+CRC32_TABLE_IMPL(sarwate, 1)
+CRC32_TABLE_IMPL(slice4, 4)
+CRC32_TABLE_IMPL(slice8, 8)
+
+static struct crc32_impl crc32_impls[] = {
+	{ "bit", crc32_le_bit, crc32c_le_bit, crc32_be_bit },
+	{ "sarwate", crc32_le_sarwate, crc32c_le_sarwate, crc32_be_sarwate },
+	{ "slice4", crc32_le_slice4, crc32c_le_slice4, crc32_be_slice4 },
+	{ "slice8", crc32_le_slice8, crc32c_le_slice8, crc32_be_slice8 },
+};
+
+/*
+ * crc32_le() and __crc32c_le() share one choice, crc32_be() has its own.
+ * Slice by 8 is used until the boot time benchmark has run.
+ */
+static const struct crc32_impl *crc32_le_impl __read_mostly =
+	&crc32_impls[ARRAY_SIZE(crc32_impls) - 1];
+static const struct crc32_impl *crc32_be_impl __read_mostly =
+	&crc32_impls[ARRAY_SIZE(crc32_impls) - 1];
+
+u32 __pure crc32_le(u32 crc, unsigned char const *p, size_t len)
+{
+	return crc32_le_impl->le(crc, p, len);
+}
+EXPORT_SYMBOL(crc32_le);
+
+u32 __pure __crc32c_le(u32 crc, unsigned char const *p, size_t len)
+{
+	return crc32_le_impl->c_le(crc, p, len);
+}
+EXPORT_SYMBOL(__crc32c_le);
+
+u32 __pure crc32_be(u32 crc, unsigned char const *p, size_t len)
+{
+	return crc32_be_impl->be(crc, p, len);
+}
+EXPORT_SYMBOL(crc32_be);
+
+#define CRC32_BENCH_LEN		4096
+#define CRC32_BENCH_ROUNDS	4
+
+/*
+ * Returns the best throughput over a few rounds in MB/s, or 0 if the
+ * implementation does not agree with the bitwise reference.
+ */
+static u64 __init crc32_bench(u32 (*fn)(u32, unsigned char const *, size_t),
+			      const u8 *buf, u32 expect)
+{
+	unsigned long flags;
+	ktime_t start;
+	s64 ns, best = LLONG_MAX;
+	u32 crc;
+	int i;
+
+	for (i = 0; i < CRC32_BENCH_ROUNDS; i++) {
+		local_irq_save(flags);
+		start = ktime_get();
+		crc = fn(~0, buf, CRC32_BENCH_LEN);
+		ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+		local_irq_restore(flags);
+
+		if (crc != expect)
+			return 0;
+		best = min(best, ns);
+	}
+
+	return div64_u64((u64)CRC32_BENCH_LEN * 1000, max_t(s64, best, 1));
+}
+
+static void __init crc32_select(void)
+{
+	const struct crc32_impl *best_le = NULL, *best_be = NULL;
+	struct crc32_impl *impl;
+	u32 le, c_le, be;
+	u8 *buf;
+	int i;
+
+	buf = kmalloc(CRC32_BENCH_LEN, GFP_KERNEL);
+	if (!buf)
+		return;
+	for (i = 0; i < CRC32_BENCH_LEN; i++)
+		buf[i] = (i * 0x9e3779b1) >> 24;
+
+	le = crc32_le_bit(~0, buf, CRC32_BENCH_LEN);
+	c_le = crc32c_le_bit(~0, buf, CRC32_BENCH_LEN);
+	be = crc32_be_bit(~0, buf, CRC32_BENCH_LEN);
+
+	for (i = 0; i < ARRAY_SIZE(crc32_impls); i++) {
+		impl = &crc32_impls[i];
+
+		impl->le_mbps = crc32_bench(impl->le, buf, le);
+		if (impl->c_le(~0, buf, CRC32_BENCH_LEN) != c_le)
+			impl->le_mbps = 0;
+		impl->be_mbps = crc32_bench(impl->be, buf, be);
+
+		if (!impl->le_mbps || !impl->be_mbps)
+			pr_err("crc32: %s implementation failed the check\n",
+			       impl->name);
+
+		if (impl->le_mbps &&
+		    (!best_le || impl->le_mbps > best_le->le_mbps))
+			best_le = impl;
+		if (impl->be_mbps &&
+		    (!best_be || impl->be_mbps > best_be->be_mbps))
+			best_be = impl;
+	}
+	kfree(buf);
+
+	if (best_le)
+		crc32_le_impl = best_le;
+	if (best_be)
+		crc32_be_impl = best_be;
+
+	pr_info("crc32: using %s for crc32_le (%llu MB/s), %s for crc32_be (%llu MB/s)\n",
+		crc32_le_impl->name, crc32_le_impl->le_mbps,
+		crc32_be_impl->name, crc32_be_impl->be_mbps);
+}
+
+static int crc32_impl_show(struct seq_file *m, void *v)
+{
+	int i;
+
+	seq_printf(m, "crc32_le: %s\ncrc32_be: %s\n\n",
+		   crc32_le_impl->name, crc32_be_impl->name);
+	seq_printf(m, "%-8s %10s %10s\n", "impl", "le MB/s", "be MB/s");
+	for (i = 0; i < ARRAY_SIZE(crc32_impls); i++)
+		seq_printf(m, "%-8s %10llu %10llu\n", crc32_impls[i].name,
+			   crc32_impls[i].le_mbps, crc32_impls[i].be_mbps);
+	return 0;
+}
+
+static int crc32_impl_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, crc32_impl_show, NULL);
+}
+
+static const struct file_operations crc32_impl_fops = {
+	.open		= crc32_impl_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static struct dentry *crc32_impl_dent;
+
+#endif
 
 #ifdef CONFIG_CRC32_SELFTEST
 
@@ -1005,6 +1319,20 @@ static int __init crc32c_test(void)
 	local_irq_restore(flags);
 	local_irq_enable();
 
+	for (i = 0; i < 100; i += 2) {
+		unsigned char const *p[2] = {
+			test_buf + (test[i].start & ~3),
+			test_buf + (test[i + 1].start & ~3),
+		};
+		size_t len = min(test[i].length, test[i + 1].length);
+		u32 crcs[2] = { test[i].crc, test[i + 1].crc };
+
+		__crc32c_le_mb(crcs, p, len, 2);
+		if (crcs[0] != __crc32c_le(test[i].crc, p[0], len) ||
+		    crcs[1] != __crc32c_le(test[i + 1].crc, p[1], len))
+			errors++;
+	}
+
 	nsec = stop.tv_nsec - start.tv_nsec +
 		1000000000 * (stop.tv_sec - start.tv_sec);
 
@@ -1077,17 +1405,30 @@ static int __init crc32_test(void)
 	return 0;
 }
 
-static int __init crc32test_init(void)
+#endif 
+
+#if defined(CONFIG_CRC32_RUNTIME) || defined(CONFIG_CRC32_SELFTEST)
+static int __init crc32_init(void)
 {
+#ifdef CONFIG_CRC32_RUNTIME
+	crc32_select();
+	crc32_impl_dent = debugfs_create_file("crc32", S_IRUGO, NULL, NULL,
+					      &crc32_impl_fops);
+#endif
+#ifdef CONFIG_CRC32_SELFTEST
 	crc32_test();
 	crc32c_test();
+#endif
 	return 0;
 }
 
 static void __exit crc32_exit(void)
 {
+#ifdef CONFIG_CRC32_RUNTIME
+	debugfs_remove(crc32_impl_dent);
+#endif
 }
 
-module_init(crc32test_init);
+module_init(crc32_init);
 module_exit(crc32_exit);
-#endif 
+#endif
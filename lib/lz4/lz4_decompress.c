@@ -0,0 +1,131 @@
+/*
+ * LZ4 Decompressor for Linux kernel
+ *
+ * Copyright (C) 2013, LG Electronics, Kyungsik Lee <kyungsik.lee@lge.com>
+ *
+ * Based on LZ4 implementation by Yann Collet.
+ *
+ * LZ4 - Fast LZ compression algorithm
+ * Copyright (C) 2011-2012, Yann Collet.
+ * BSD 2-Clause License (http://www.opensource.org/licenses/bsd-license.php)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef STATIC
+#include <linux/module.h>
+#include <linux/kernel.h>
+#endif
+#include <linux/types.h>
+#include <linux/string.h>
+#include <linux/lz4.h>
+
+#include <asm/unaligned.h>
+
+#include "lz4defs.h"
+
+/*
+ * Decode an LZ4 block of exactly isize bytes into at most maxoutputsize
+ * bytes.  Every length and offset is validated against both buffers, so
+ * corrupt input can never read or write out of bounds.  Returns the number
+ * of bytes written, or a negative value on malformed input.
+ */
+static int lz4_uncompress_unknownoutputsize(const u8 *source, u8 *dest,
+				int isize, size_t maxoutputsize)
+{
+	const u8 *ip = source;
+	const u8 *const iend = ip + isize;
+	u8 *op = dest;
+	u8 *const oend = op + maxoutputsize;
+	const u8 *ref;
+	size_t length, offset;
+	unsigned int token, s;
+
+	if (!isize)
+		goto _output_error;
+
+	while (ip < iend) {
+		token = *ip++;
+
+		length = token >> ML_BITS;
+		if (length == RUN_MASK) {
+			do {
+				if (ip >= iend)
+					goto _output_error;
+				s = *ip++;
+				length += s;
+			} while (s == 255);
+		}
+
+		if (length > (size_t)(iend - ip) ||
+		    length > (size_t)(oend - op))
+			goto _output_error;
+
+		memcpy(op, ip, length);
+		ip += length;
+		op += length;
+
+		/* The last sequence carries literals only. */
+		if (ip == iend)
+			break;
+
+		if (iend - ip < 2)
+			goto _output_error;
+		offset = get_unaligned_le16(ip);
+		ip += 2;
+		if (!offset || offset > (size_t)(op - dest))
+			goto _output_error;
+		ref = op - offset;
+
+		length = token & ML_MASK;
+		if (length == ML_MASK) {
+			do {
+				if (ip >= iend)
+					goto _output_error;
+				s = *ip++;
+				length += s;
+			} while (s == 255);
+		}
+		length += MINMATCH;
+
+		if (length > (size_t)(oend - op))
+			goto _output_error;
+
+		if (offset >= COPYLENGTH) {
+			while (length >= COPYLENGTH) {
+				LZ4_COPY8(op, ref);
+				op += COPYLENGTH;
+				ref += COPYLENGTH;
+				length -= COPYLENGTH;
+			}
+		}
+		while (length--)
+			*op++ = *ref++;
+	}
+
+	return (int)(op - dest);
+
+_output_error:
+	return -1;
+}
+
+int lz4_decompress_unknownoutputsize(const unsigned char *src, size_t src_len,
+		unsigned char *dest, size_t *dest_len)
+{
+	int ret;
+
+	ret = lz4_uncompress_unknownoutputsize(src, dest, src_len, *dest_len);
+	if (ret < 0)
+		return -1;
+
+	*dest_len = ret;
+	return 0;
+}
+#ifndef STATIC
+EXPORT_SYMBOL(lz4_decompress_unknownoutputsize);
+
+MODULE_LICENSE("Dual BSD/GPL");
+MODULE_DESCRIPTION("LZ4 Decompressor");
+#endif
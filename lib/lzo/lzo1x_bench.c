@@ -0,0 +1,237 @@
+/*
+ *  lib/lzo/lzo1x_bench.c
+ *
+ *  Compression ratio and throughput of the LZO1X-1 compressor and
+ *  decompressor against the previous implementation on page sized data
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/gfp.h>
+#include <linux/ktime.h>
+#include <linux/lzo.h>
+#include <linux/math64.h>
+#include <linux/random.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+#include "lzo1x_ref.h"
+
+#define BENCH_PAGES	32
+#define BENCH_STRIDE	lzo1x_worst_compress(PAGE_SIZE)
+
+static unsigned int msec = 200;
+module_param(msec, uint, 0);
+MODULE_PARM_DESC(msec, "Time to spend on each variant and direction");
+
+struct lzo_variant {
+	const char *name;
+	int (*compress)(const unsigned char *, size_t, unsigned char *,
+			size_t *, void *);
+	int (*decompress)(const unsigned char *, size_t, unsigned char *,
+			  size_t *);
+};
+
+static const struct lzo_variant variants[] = {
+	{ "ref", lzo1x_1_compress_ref, lzo1x_decompress_ref },
+	{ "new", lzo1x_1_compress, lzo1x_decompress_safe },
+};
+
+/*
+ * The corpus mixes the kind of pages zram and swap see: kernel text,
+ * zero and sparse pages, short repeating records and incompressible data.
+ */
+static void bench_fill(u8 *corpus)
+{
+	const u8 *text = (const u8 *)((unsigned long)printk & PAGE_MASK);
+	u8 *p;
+	int i, j;
+
+	for (i = 0; i < BENCH_PAGES; i++) {
+		p = corpus + i * PAGE_SIZE;
+
+		switch (i % 8) {
+		case 0:
+		case 1:
+		case 2:
+			memcpy(p, text + i * PAGE_SIZE, PAGE_SIZE);
+			break;
+		case 3:
+			memset(p, 0, PAGE_SIZE);
+			break;
+		case 4:
+			memset(p, 0, PAGE_SIZE);
+			for (j = 0; j < PAGE_SIZE; j += 64 + (j & 0xc0))
+				p[j] = j >> 4;
+			break;
+		case 5:
+			for (j = 0; j < PAGE_SIZE; j++)
+				p[j] = "struct page "[j % 12] ^ ((j >> 9) & 1);
+			break;
+		case 6:
+			get_random_bytes(p, PAGE_SIZE / 2);
+			memset(p + PAGE_SIZE / 2, 0, PAGE_SIZE / 2);
+			break;
+		default:
+			get_random_bytes(p, PAGE_SIZE);
+			break;
+		}
+	}
+}
+
+/*
+ * Every stream is decoded by both decompressors so that the two
+ * implementations stay interchangeable on the same data.
+ */
+static int bench_verify(const u8 *corpus, u8 *comp, size_t *comp_len,
+			u8 *out, void *wrkmem)
+{
+	size_t total = 0, len, out_len;
+	int i, v, d, ret;
+
+	for (v = 0; v < ARRAY_SIZE(variants); v++) {
+		total = 0;
+		for (i = 0; i < BENCH_PAGES; i++) {
+			const u8 *src = corpus + i * PAGE_SIZE;
+
+			len = lzo1x_worst_compress(PAGE_SIZE);
+			ret = variants[v].compress(src, PAGE_SIZE, comp, &len,
+						   wrkmem);
+			if (ret != LZO_E_OK) {
+				printk(KERN_ERR "lzo: %s compress failed on "
+				       "page %d: %d\n", variants[v].name, i,
+				       ret);
+				return -EINVAL;
+			}
+			total += len;
+
+			for (d = 0; d < ARRAY_SIZE(variants); d++) {
+				out_len = PAGE_SIZE;
+				ret = variants[d].decompress(comp, len, out,
+							     &out_len);
+				if (ret != LZO_E_OK || out_len != PAGE_SIZE ||
+				    memcmp(out, src, PAGE_SIZE)) {
+					printk(KERN_ERR "lzo: %s stream of page "
+					       "%d not decoded by %s: %d\n",
+					       variants[v].name, i,
+					       variants[d].name, ret);
+					return -EINVAL;
+				}
+			}
+		}
+		comp_len[v] = total;
+	}
+
+	return 0;
+}
+
+static u64 bench_compress(const struct lzo_variant *v, const u8 *corpus,
+			  u8 *comp, void *wrkmem)
+{
+	ktime_t start, end;
+	u64 bytes = 0, ns, limit = (u64)msec * NSEC_PER_MSEC;
+	size_t len;
+	int i;
+
+	start = ktime_get();
+	do {
+		for (i = 0; i < BENCH_PAGES; i++) {
+			len = lzo1x_worst_compress(PAGE_SIZE);
+			v->compress(corpus + i * PAGE_SIZE, PAGE_SIZE, comp,
+				    &len, wrkmem);
+		}
+		bytes += BENCH_PAGES * PAGE_SIZE;
+		end = ktime_get();
+		ns = ktime_to_ns(ktime_sub(end, start));
+		cond_resched();
+	} while (ns < limit);
+
+	return div64_u64(bytes * 1000, ns);
+}
+
+static u64 bench_decompress(const struct lzo_variant *v, const u8 *corpus,
+			    u8 *comp, u8 *out, void *wrkmem)
+{
+	ktime_t start, end;
+	u64 bytes = 0, ns, limit = (u64)msec * NSEC_PER_MSEC;
+	size_t len[BENCH_PAGES], out_len;
+	int i;
+
+	for (i = 0; i < BENCH_PAGES; i++) {
+		len[i] = lzo1x_worst_compress(PAGE_SIZE);
+		v->compress(corpus + i * PAGE_SIZE, PAGE_SIZE,
+			    comp + i * BENCH_STRIDE, &len[i], wrkmem);
+	}
+
+	start = ktime_get();
+	do {
+		for (i = 0; i < BENCH_PAGES; i++) {
+			out_len = PAGE_SIZE;
+			v->decompress(comp + i * BENCH_STRIDE, len[i], out,
+				      &out_len);
+		}
+		bytes += BENCH_PAGES * PAGE_SIZE;
+		end = ktime_get();
+		ns = ktime_to_ns(ktime_sub(end, start));
+		cond_resched();
+	} while (ns < limit);
+
+	return div64_u64(bytes * 1000, ns);
+}
+
+static int __init lzo_bench_init(void)
+{
+	size_t comp_len[ARRAY_SIZE(variants)];
+	u8 *corpus, *comp, *out;
+	void *wrkmem;
+	int i;
+
+	corpus = vmalloc(BENCH_PAGES * PAGE_SIZE);
+	comp = vmalloc(BENCH_PAGES * BENCH_STRIDE);
+	out = kmalloc(PAGE_SIZE, GFP_KERNEL);
+	wrkmem = vmalloc(max(LZO1X_MEM_COMPRESS, LZO1X_REF_MEM_COMPRESS));
+	if (!corpus || !comp || !out || !wrkmem)
+		goto out;
+
+	bench_fill(corpus);
+	if (bench_verify(corpus, comp, comp_len, out, wrkmem))
+		goto out;
+
+	for (i = 0; i < ARRAY_SIZE(variants); i++) {
+		const struct lzo_variant *v = &variants[i];
+
+		printk(KERN_INFO "lzo: %s %lu -> %zu bytes, "
+		       "compress %llu MB/s, decompress %llu MB/s\n",
+		       v->name, BENCH_PAGES * PAGE_SIZE, comp_len[i],
+		       bench_compress(v, corpus, comp, wrkmem),
+		       bench_decompress(v, corpus, comp, out, wrkmem));
+	}
+
+out:
+	vfree(wrkmem);
+	kfree(out);
+	vfree(comp);
+	vfree(corpus);
+
+	/*
+	 * An error return makes the module unload right away, the results
+	 * are in the kernel log.
+	 */
+	return -EAGAIN;
+}
+
+static void __exit lzo_bench_exit(void)
+{
+}
+
+module_init(lzo_bench_init);
+module_exit(lzo_bench_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("LZO1X-1 compression ratio and throughput");
@@ -0,0 +1,12 @@
+#ifndef __LZO1X_REF_H
+#define __LZO1X_REF_H
+
+#define LZO1X_REF_MEM_COMPRESS	(16384 * sizeof(unsigned char *))
+
+int lzo1x_1_compress_ref(const unsigned char *src, size_t src_len,
+			 unsigned char *dst, size_t *dst_len, void *wrkmem);
+
+int lzo1x_decompress_ref(const unsigned char *src, size_t src_len,
+			 unsigned char *dst, size_t *dst_len);
+
+#endif
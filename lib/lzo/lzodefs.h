@@ -1,19 +1,62 @@
 /*
  *  lzodefs.h -- architecture, OS and compiler specific defines
  *
- *  Copyright (C) 1996-2005 Markus F.X.J. Oberhumer <markus@oberhumer.com>
+ *  Copyright (C) 1996-2012 Markus F.X.J. Oberhumer <markus@oberhumer.com>
  *
  *  The full LZO package can be found at:
  *  http://www.oberhumer.com/opensource/lzo/
  *
- *  Changed for kernel use by:
+ *  Changed for Linux kernel use by:
  *  Nitin Gupta <nitingupta910@gmail.com>
  *  Richard Purdie <rpurdie@openedhand.com>
  */
 
-#define LZO_VERSION		0x2020
-#define LZO_VERSION_STRING	"2.02"
-#define LZO_VERSION_DATE	"Oct 17 2005"
+/*
+ * ARMv6 and later handle unaligned ldr/str in hardware, but the kernel
+ * is built with -mno-unaligned-access and get_unaligned() goes byte by
+ * byte, so the word accesses are done by hand there.  The pre-boot
+ * decompressor (STATIC) keeps to the portable code.
+ */
+#if defined(CONFIG_HAVE_EFFICIENT_UNALIGNED_ACCESS)
+#define LZO_FAST_UNALIGNED
+#elif defined(CONFIG_ARM) && __LINUX_ARM_ARCH__ >= 6 && !defined(STATIC)
+#define LZO_FAST_UNALIGNED
+#define LZO_ARM_UNALIGNED
+#endif
+
+#if defined(LZO_FAST_UNALIGNED) && \
+	(defined(CONFIG_X86) || (defined(CONFIG_ARM) && __LINUX_ARM_ARCH__ >= 7))
+#define LZO_USE_CTZ32
+#endif
+
+#ifdef LZO_ARM_UNALIGNED
+static __always_inline u32 lzo_get_u32(const void *p)
+{
+	u32 v;
+
+	asm("ldr	%0, %1" : "=r" (v) : "Q" (*(const u32 *)p));
+	return v;
+}
+
+static __always_inline void lzo_put_u32(void *p, u32 v)
+{
+	asm("str	%1, %0" : "=Q" (*(u32 *)p) : "r" (v));
+}
+#else
+#define lzo_get_u32(p)		get_unaligned((const u32 *)(p))
+#define lzo_put_u32(p, v)	put_unaligned((v), (u32 *)(p))
+#endif
+
+#define lzo_get_le32(p)		le32_to_cpu((__force __le32)lzo_get_u32(p))
+
+#define COPY4(dst, src)		lzo_put_u32(dst, lzo_get_u32(src))
+#if defined(CONFIG_X86_64)
+#define COPY8(dst, src)	\
+		put_unaligned(get_unaligned((const u64 *)(src)), (u64 *)(dst))
+#else
+#define COPY8(dst, src)	\
+		do { COPY4(dst, src); COPY4((dst) + 4, (src) + 4); } while (0)
+#endif
 
 #define M1_MAX_OFFSET	0x0400
 #define M2_MAX_OFFSET	0x0800
@@ -34,10 +77,8 @@
 #define M3_MARKER	32
 #define M4_MARKER	16
 
-#define D_BITS		14
-#define D_MASK		((1u << D_BITS) - 1)
+#define lzo_dict_t	unsigned short
+#define D_BITS		13
+#define D_SIZE		(1u << D_BITS)
+#define D_MASK		(D_SIZE - 1)
 #define D_HIGH		((D_MASK >> 1) + 1)
-
-#define DX2(p, s1, s2)	(((((size_t)((p)[2]) << (s2)) ^ (p)[1]) \
-							<< (s1)) ^ (p)[0])
-#define DX3(p, s1, s2, s3)	((DX2((p)+1, s2, s3) << (s1)) ^ (p)[0])
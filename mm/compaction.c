@@ -14,6 +14,9 @@
 #include <linux/backing-dev.h>
 #include <linux/sysctl.h>
 #include <linux/sysfs.h>
+#include <linux/kthread.h>
+#include <linux/freezer.h>
+#include <linux/sched.h>
 #include "internal.h"
 
 #if defined CONFIG_COMPACTION || defined CONFIG_CMA
@@ -420,6 +423,16 @@ static isolate_migrate_t isolate_migratepages(struct zone *zone,
 	return ISOLATE_SUCCESS;
 }
 
+static unsigned long zone_free_blocks(struct zone *zone, unsigned int order)
+{
+	unsigned long nr = 0;
+	unsigned int o;
+
+	for (o = order; o < MAX_ORDER; o++)
+		nr += zone->free_area[o].nr_free << (o - order);
+	return nr;
+}
+
 static int compact_finished(struct zone *zone,
 			    struct compact_control *cc)
 {
@@ -429,6 +442,9 @@ static int compact_finished(struct zone *zone,
 	if (fatal_signal_pending(current))
 		return COMPACT_PARTIAL;
 
+	if (cc->kcompactd && (kthread_should_stop() || freezing(current)))
+		return COMPACT_PARTIAL;
+
 	
 	if (cc->free_pfn <= cc->migrate_pfn)
 		return COMPACT_COMPLETE;
@@ -436,6 +452,12 @@ static int compact_finished(struct zone *zone,
 	if (cc->order == -1)
 		return COMPACT_CONTINUE;
 
+	if (cc->target_blocks) {
+		if (zone_free_blocks(zone, cc->order) >= cc->target_blocks)
+			return COMPACT_PARTIAL;
+		return COMPACT_CONTINUE;
+	}
+
 	
 	watermark = low_wmark_pages(zone);
 	watermark += (1 << cc->order);
@@ -480,11 +502,54 @@ unsigned long compaction_suitable(struct zone *zone, int order)
 	return COMPACT_CONTINUE;
 }
 
+#ifdef CONFIG_COMPACTION
+int sysctl_compaction_target_order = PAGE_ALLOC_COSTLY_ORDER + 1;
+int sysctl_compaction_target_blocks;
+int sysctl_compaction_cpu_budget = 10;
+
+#define KCOMPACTD_SLICE_NS	(10 * NSEC_PER_MSEC)
+
+/*
+ * kcompactd runs in slices of KCOMPACTD_SLICE_NS of CPU time and then
+ * sleeps long enough to keep its share of one CPU at
+ * sysctl_compaction_cpu_budget percent.
+ */
+static void kcompactd_throttle(struct compact_control *cc,
+			       unsigned long nr_migrated)
+{
+	int budget = sysctl_compaction_cpu_budget;
+	u64 ran;
+
+	count_vm_events(KCOMPACTD_MIGRATED, nr_migrated);
+
+	if (budget >= 100)
+		return;
+
+	ran = current->se.sum_exec_runtime - cc->slice_start;
+	if (ran < KCOMPACTD_SLICE_NS)
+		return;
+
+	ran *= 100 - budget;
+	do_div(ran, budget);
+	count_vm_event(KCOMPACTD_THROTTLE);
+	schedule_timeout_interruptible(nsecs_to_jiffies(ran));
+	cc->slice_start = current->se.sum_exec_runtime;
+}
+#else
+static inline void kcompactd_throttle(struct compact_control *cc,
+				      unsigned long nr_migrated)
+{
+}
+#endif
+
 static int compact_zone(struct zone *zone, struct compact_control *cc)
 {
 	int ret;
 
-	ret = compaction_suitable(zone, cc->order);
+	if (cc->target_blocks)
+		ret = COMPACT_CONTINUE;
+	else
+		ret = compaction_suitable(zone, cc->order);
 	switch (ret) {
 	case COMPACT_PARTIAL:
 	case COMPACT_SKIPPED:
@@ -529,6 +594,8 @@ static int compact_zone(struct zone *zone, struct compact_control *cc)
 			count_vm_events(COMPACTPAGEFAILED, nr_remaining);
 		trace_mm_compaction_migratepages(nr_migrate - nr_remaining,
 						nr_remaining);
+		if (cc->kcompactd)
+			kcompactd_throttle(cc, nr_migrate - nr_remaining);
 
 		
 		if (err) {
@@ -639,16 +706,6 @@ static int __compact_pgdat(pg_data_t *pgdat, struct compact_control *cc)
 	return 0;
 }
 
-int compact_pgdat(pg_data_t *pgdat, int order)
-{
-	struct compact_control cc = {
-		.order = order,
-		.sync = false,
-	};
-
-	return __compact_pgdat(pgdat, &cc);
-}
-
 static int compact_node(int nid)
 {
 	struct compact_control cc = {
@@ -692,6 +749,245 @@ int sysctl_extfrag_handler(struct ctl_table *table, int write,
 	return 0;
 }
 
+#ifdef CONFIG_COMPACTION
+#define KCOMPACTD_PROACTIVE_INTERVAL	HZ
+
+/*
+ * A zone is worth compacting in the background when it is short of free
+ * blocks of the target order, has enough free memory to form them, and
+ * its fragmentation index says the shortage is due to fragmentation
+ * rather than to a lack of memory.
+ */
+static bool kcompactd_zone_fragmented(struct zone *zone)
+{
+	unsigned int order = sysctl_compaction_target_order;
+	unsigned long target = sysctl_compaction_target_blocks;
+	int fragindex;
+
+	if (zone_free_blocks(zone, order) >= target)
+		return false;
+
+	if (!zone_watermark_ok(zone, 0, low_wmark_pages(zone) +
+			       (target << order), 0, 0))
+		return false;
+
+	fragindex = fragmentation_index(zone, order);
+	return fragindex == -1000 || fragindex > sysctl_extfrag_threshold;
+}
+
+static bool kcompactd_node_fragmented(pg_data_t *pgdat)
+{
+	int zoneid;
+
+	if (!sysctl_compaction_target_blocks)
+		return false;
+
+	for (zoneid = 0; zoneid < pgdat->nr_zones; zoneid++) {
+		struct zone *zone = &pgdat->node_zones[zoneid];
+
+		if (populated_zone(zone) && kcompactd_zone_fragmented(zone))
+			return true;
+	}
+	return false;
+}
+
+static bool kcompactd_work_requested(pg_data_t *pgdat)
+{
+	return pgdat->kcompactd_max_order > 0 || kthread_should_stop();
+}
+
+/*
+ * Returns false when a proactive pass did not add a single free block of
+ * the target order to any zone it compacted.
+ */
+static bool kcompactd_do_work(pg_data_t *pgdat, bool proactive)
+{
+	int zoneid;
+	int classzone_idx;
+	struct zone *zone;
+	bool progress = false;
+	struct compact_control cc = {
+		.sync = true,
+		.kcompactd = true,
+	};
+
+	if (proactive) {
+		cc.order = sysctl_compaction_target_order;
+		cc.target_blocks = sysctl_compaction_target_blocks;
+		classzone_idx = pgdat->nr_zones - 1;
+		count_vm_event(KCOMPACTD_PROACTIVE);
+	} else {
+		cc.order = pgdat->kcompactd_max_order;
+		classzone_idx = pgdat->kcompactd_classzone_idx;
+		pgdat->kcompactd_max_order = 0;
+		pgdat->kcompactd_classzone_idx = pgdat->nr_zones - 1;
+		count_vm_event(KCOMPACTD_WAKE);
+	}
+	cc.slice_start = current->se.sum_exec_runtime;
+
+	for (zoneid = 0; zoneid <= classzone_idx; zoneid++) {
+		unsigned long free_blocks = 0;
+		int status;
+
+		zone = &pgdat->node_zones[zoneid];
+		if (!populated_zone(zone))
+			continue;
+
+		if (proactive) {
+			if (!kcompactd_zone_fragmented(zone))
+				continue;
+			free_blocks = zone_free_blocks(zone, cc.order);
+		} else {
+			if (compaction_deferred(zone, cc.order))
+				continue;
+			if (compaction_suitable(zone, cc.order) !=
+							COMPACT_CONTINUE)
+				continue;
+		}
+
+		cc.nr_freepages = 0;
+		cc.nr_migratepages = 0;
+		cc.zone = zone;
+		INIT_LIST_HEAD(&cc.freepages);
+		INIT_LIST_HEAD(&cc.migratepages);
+
+		status = compact_zone(zone, &cc);
+
+		if (proactive) {
+			if (zone_free_blocks(zone, cc.order) > free_blocks)
+				progress = true;
+		} else {
+			if (zone_watermark_ok(zone, cc.order,
+					      low_wmark_pages(zone), 0, 0)) {
+				if (cc.order > zone->compact_order_failed)
+					zone->compact_order_failed =
+								cc.order + 1;
+			} else if (status == COMPACT_COMPLETE) {
+				defer_compaction(zone, cc.order);
+			}
+		}
+
+		VM_BUG_ON(!list_empty(&cc.freepages));
+		VM_BUG_ON(!list_empty(&cc.migratepages));
+
+		if (kthread_should_stop() || freezing(current))
+			break;
+	}
+	return progress;
+}
+
+static int kcompactd(void *p)
+{
+	pg_data_t *pgdat = (pg_data_t *)p;
+	const struct cpumask *cpumask = cpumask_of_node(pgdat->node_id);
+	unsigned int defer_shift = 0;
+
+	if (!cpumask_empty(cpumask))
+		set_cpus_allowed_ptr(current, cpumask);
+	set_freezable();
+
+	while (!kthread_should_stop()) {
+		int target = sysctl_compaction_target_blocks;
+		long timeout = MAX_SCHEDULE_TIMEOUT;
+
+		if (target)
+			timeout = KCOMPACTD_PROACTIVE_INTERVAL << defer_shift;
+
+		if (!wait_event_freezable_timeout(pgdat->kcompactd_wait,
+				kcompactd_work_requested(pgdat) ||
+				sysctl_compaction_target_blocks != target,
+				timeout)) {
+			if (!kcompactd_node_fragmented(pgdat))
+				defer_shift = 0;
+			else if (kcompactd_do_work(pgdat, true))
+				defer_shift = 0;
+			else if (defer_shift < COMPACT_MAX_DEFER_SHIFT)
+				defer_shift++;
+			continue;
+		}
+
+		if (sysctl_compaction_target_blocks != target)
+			defer_shift = 0;
+
+		if (kthread_should_stop())
+			break;
+
+		if (pgdat->kcompactd_max_order > 0)
+			kcompactd_do_work(pgdat, false);
+	}
+	return 0;
+}
+
+void wakeup_kcompactd(pg_data_t *pgdat, int order, int classzone_idx)
+{
+	if (!order)
+		return;
+
+	if (pgdat->kcompactd_max_order < order)
+		pgdat->kcompactd_max_order = order;
+
+	if (pgdat->kcompactd_classzone_idx > classzone_idx)
+		pgdat->kcompactd_classzone_idx = classzone_idx;
+
+	if (!waitqueue_active(&pgdat->kcompactd_wait))
+		return;
+
+	wake_up_interruptible(&pgdat->kcompactd_wait);
+}
+
+int sysctl_compaction_target_handler(struct ctl_table *table, int write,
+			void __user *buffer, size_t *length, loff_t *ppos)
+{
+	int ret, nid;
+
+	ret = proc_dointvec_minmax(table, write, buffer, length, ppos);
+	if (ret || !write)
+		return ret;
+
+	for_each_node_state(nid, N_HIGH_MEMORY)
+		wake_up_interruptible(&NODE_DATA(nid)->kcompactd_wait);
+	return 0;
+}
+
+int kcompactd_run(int nid)
+{
+	pg_data_t *pgdat = NODE_DATA(nid);
+
+	if (pgdat->kcompactd)
+		return 0;
+
+	pgdat->kcompactd_max_order = 0;
+	pgdat->kcompactd_classzone_idx = pgdat->nr_zones - 1;
+	pgdat->kcompactd = kthread_run(kcompactd, pgdat, "kcompactd%d", nid);
+	if (IS_ERR(pgdat->kcompactd)) {
+		pr_err("Failed to start kcompactd on node %d\n", nid);
+		pgdat->kcompactd = NULL;
+		return -1;
+	}
+	return 0;
+}
+
+void kcompactd_stop(int nid)
+{
+	struct task_struct *kcompactd = NODE_DATA(nid)->kcompactd;
+
+	if (kcompactd) {
+		kthread_stop(kcompactd);
+		NODE_DATA(nid)->kcompactd = NULL;
+	}
+}
+
+static int __init kcompactd_init(void)
+{
+	int nid;
+
+	for_each_node_state(nid, N_HIGH_MEMORY)
+		kcompactd_run(nid);
+	return 0;
+}
+module_init(kcompactd_init)
+#endif
+
 #if defined(CONFIG_SYSFS) && defined(CONFIG_NUMA)
 ssize_t sysfs_compact_node(struct device *dev,
 			struct device_attribute *attr,
@@ -79,6 +79,10 @@ struct compact_control {
 	int order;			
 	int migratetype;		
 	struct zone *zone;
+
+	bool kcompactd;
+	unsigned long target_blocks;
+	u64 slice_start;
 };
 
 unsigned long
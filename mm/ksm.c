@@ -129,6 +129,8 @@ struct stable_node {
  * @mm: the memory structure this rmap_item is pointing into
  * @address: the virtual address this rmap_item tracks (+ flags in low bits)
  * @oldchecksum: previous checksum of the page at that virtual address
+ * @age: number of consecutive scans that found the page changed
+ * @remaining_skips: scans to skip before looking at the page again
  * @node: rb node of this rmap_item in the unstable tree
  * @head: pointer to stable_node heading this list in the stable tree
  * @hlist: link into hlist of rmap_items hanging off that stable_node
@@ -139,6 +141,8 @@ struct rmap_item {
 	struct mm_struct *mm;
 	unsigned long address;		/* + low bits used for flags below */
 	unsigned int oldchecksum;	/* when unstable */
+	unsigned char age;		/* lightweight mode backoff */
+	unsigned char remaining_skips;
 	union {
 		struct rb_node node;	/* when node of unstable tree */
 		struct {		/* when listed from stable tree */
@@ -189,6 +193,35 @@ static unsigned int ksm_thread_pages_to_scan = 100;
 /* Milliseconds ksmd should sleep between batches */
 static unsigned int ksm_thread_sleep_millisecs = 20;
 
+/*
+ * Lightweight mode: skip small mms, back off from pages that keep
+ * changing, filter with a sampled checksum before searching the trees,
+ * merge zero pages with the zero page, and cap ksmd's CPU time.
+ */
+static unsigned int ksm_lightweight = 1;
+
+/* In lightweight mode, mms with fewer resident pages are not scanned */
+static unsigned long ksm_min_rss_pages = 2048;
+
+/* In lightweight mode, percent of one CPU ksmd may use per interval */
+static unsigned int ksm_cpu_budget_percent = 5;
+
+#define KSM_BUDGET_INTERVAL	HZ
+
+static unsigned long ksm_budget_start;
+static u64 ksm_budget_used;
+
+/* Pages merged since boot, and the CPU time ksmd has spent doing it */
+static unsigned long ksm_pages_merged;
+static unsigned long ksm_zero_pages_merged;
+static u64 ksm_cpu_time;
+
+#define KSM_CHECKSUM_SAMPLES	64
+#define KSM_MAX_AGE		4
+
+/* Sampled checksum of a page full of zeroes */
+static u32 zero_checksum __read_mostly;
+
 #define KSM_RUN_STOP	0
 #define KSM_RUN_MERGE	1
 #define KSM_RUN_UNMERGE	2
@@ -673,15 +706,44 @@ error:
 }
 #endif /* CONFIG_SYSFS */
 
+/*
+ * Hash KSM_CHECKSUM_SAMPLES words spread over the page instead of all of
+ * it: that notices most pages being rewritten for a fraction of the cost.
+ * A page changed only outside the samples is still caught by the memcmp
+ * done before any merge.
+ */
+static u32 calc_sampled_checksum(const u32 *addr)
+{
+	const int stride = PAGE_SIZE / sizeof(u32) / KSM_CHECKSUM_SAMPLES;
+	u32 sample[KSM_CHECKSUM_SAMPLES];
+	int i;
+
+	for (i = 0; i < KSM_CHECKSUM_SAMPLES; i++)
+		sample[i] = addr[i * stride + i % stride];
+	return jhash2(sample, KSM_CHECKSUM_SAMPLES, 17);
+}
+
 static u32 calc_checksum(struct page *page)
 {
 	u32 checksum;
 	void *addr = kmap_atomic(page);
-	checksum = jhash2(addr, PAGE_SIZE / 4, 17);
+	if (ksm_lightweight)
+		checksum = calc_sampled_checksum(addr);
+	else
+		checksum = jhash2(addr, PAGE_SIZE / 4, 17);
 	kunmap_atomic(addr);
 	return checksum;
 }
 
+static bool page_is_zero_filled(struct page *page)
+{
+	void *addr = kmap_atomic(page);
+	bool zero = !memchr_inv(addr, 0, PAGE_SIZE);
+
+	kunmap_atomic(addr);
+	return zero;
+}
+
 static int memcmp_pages(struct page *page1, struct page *page2)
 {
 	char *addr1, *addr2;
@@ -760,7 +822,7 @@ out:
  * replace_page - replace page in vma by new ksm page
  * @vma:      vma that holds the pte pointing to page
  * @page:     the page we are replacing by kpage
- * @kpage:    the ksm page we replace page by
+ * @kpage:    the ksm page or the zero page we replace page by
  * @orig_pte: the original value of the pte
  *
  * Returns 0 on success, -EFAULT on failure.
@@ -775,6 +837,7 @@ static int replace_page(struct vm_area_struct *vma, struct page *page,
 	pte_t *ptep;
 	spinlock_t *ptl;
 	unsigned long addr;
+	pte_t newpte;
 	int err = -EFAULT;
 
 	addr = page_address_in_vma(page, vma);
@@ -800,12 +863,23 @@ static int replace_page(struct vm_area_struct *vma, struct page *page,
 		goto out;
 	}
 
-	get_page(kpage);
-	page_add_anon_rmap(kpage, vma, addr);
+	if (kpage != ZERO_PAGE(addr)) {
+		get_page(kpage);
+		page_add_anon_rmap(kpage, vma, addr);
+		newpte = mk_pte(kpage, vma->vm_page_prot);
+	} else {
+		/*
+		 * The zero page is not refcounted or rmapped, just as when
+		 * it is mapped by a read fault; a write fault will COW it.
+		 */
+		newpte = pte_mkspecial(pfn_pte(page_to_pfn(kpage),
+					       vma->vm_page_prot));
+		dec_mm_counter(mm, MM_ANONPAGES);
+	}
 
 	flush_cache_page(vma, addr, pte_pfn(*ptep));
 	ptep_clear_flush(vma, addr, ptep);
-	set_pte_at_notify(mm, addr, ptep, mk_pte(kpage, vma->vm_page_prot));
+	set_pte_at_notify(mm, addr, ptep, newpte);
 
 	page_remove_rmap(page);
 	if (!page_mapped(page))
@@ -938,6 +1012,8 @@ static int try_to_merge_with_ksm_page(struct rmap_item *rmap_item,
 	err = try_to_merge_one_page(vma, page, kpage);
 	if (err)
 		goto out;
+	if (kpage)
+		ksm_pages_merged++;
 
 	/* Must get reference to anon_vma while still holding mmap_sem */
 	rmap_item->anon_vma = vma->anon_vma;
@@ -978,6 +1054,43 @@ static struct page *try_to_merge_two_pages(struct rmap_item *rmap_item,
 	return err ? NULL : page;
 }
 
+/*
+ * try_to_merge_zero_page - map the zero page in place of a page that is
+ * full of zeroes, rather than keeping a ksm page of zeroes in the stable
+ * tree.
+ *
+ * This function returns 0 if the page was replaced, -EFAULT otherwise.
+ */
+static int try_to_merge_zero_page(struct rmap_item *rmap_item,
+				  struct page *page)
+{
+	struct mm_struct *mm = rmap_item->mm;
+	struct vm_area_struct *vma;
+	int err = -EFAULT;
+
+	if (!page_is_zero_filled(page))
+		return err;
+
+	down_read(&mm->mmap_sem);
+	if (ksm_test_exit(mm))
+		goto out;
+	vma = find_vma(mm, rmap_item->address);
+	if (!vma || vma->vm_start > rmap_item->address)
+		goto out;
+	/* The zero page cannot be mlocked in place of the original */
+	if (vma->vm_flags & VM_LOCKED)
+		goto out;
+
+	err = try_to_merge_one_page(vma, page, ZERO_PAGE(rmap_item->address));
+	if (!err) {
+		ksm_pages_merged++;
+		ksm_zero_pages_merged++;
+	}
+out:
+	up_read(&mm->mmap_sem);
+	return err;
+}
+
 /*
  * stable_tree_search - search for page inside the stable tree
  *
@@ -1172,6 +1285,18 @@ static void stable_tree_append(struct rmap_item *rmap_item,
  * @page: the page that we are searching identical page to.
  * @rmap_item: the reverse mapping into the virtual address of this page
  */
+/*
+ * In lightweight mode a page found changed on consecutive scans is left
+ * alone for exponentially more scans, so that ksmd spends its time on
+ * idle pages, which are the ones likely to stay merged.
+ */
+static void ksm_backoff(struct rmap_item *rmap_item)
+{
+	if (rmap_item->age < KSM_MAX_AGE)
+		rmap_item->age++;
+	rmap_item->remaining_skips = (1 << rmap_item->age) / 2 - 1;
+}
+
 static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 {
 	struct rmap_item *tree_rmap_item;
@@ -1183,6 +1308,27 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 
 	remove_rmap_item_from_tree(rmap_item);
 
+	/*
+	 * In lightweight mode the checksum is checked first, so that pages
+	 * which are still changing cost no tree search at all.
+	 */
+	if (ksm_lightweight) {
+		if (rmap_item->remaining_skips) {
+			rmap_item->remaining_skips--;
+			return;
+		}
+		checksum = calc_checksum(page);
+		if (rmap_item->oldchecksum != checksum) {
+			rmap_item->oldchecksum = checksum;
+			ksm_backoff(rmap_item);
+			return;
+		}
+		rmap_item->age = 0;
+		if (checksum == zero_checksum &&
+		    !try_to_merge_zero_page(rmap_item, page))
+			return;
+	}
+
 	/* We first start with searching the page inside the stable tree */
 	kpage = stable_tree_search(page);
 	if (kpage) {
@@ -1206,10 +1352,12 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 	 * don't want to insert it in the unstable tree, and we don't want
 	 * to waste our time searching for something identical to it there.
 	 */
-	checksum = calc_checksum(page);
-	if (rmap_item->oldchecksum != checksum) {
-		rmap_item->oldchecksum = checksum;
-		return;
+	if (!ksm_lightweight) {
+		checksum = calc_checksum(page);
+		if (rmap_item->oldchecksum != checksum) {
+			rmap_item->oldchecksum = checksum;
+			return;
+		}
 	}
 
 	tree_rmap_item =
@@ -1276,6 +1424,30 @@ static struct rmap_item *get_next_rmap_item(struct mm_slot *mm_slot,
 	return rmap_item;
 }
 
+static bool ksm_mm_too_small(struct mm_struct *mm)
+{
+	return ksm_lightweight && get_mm_rss(mm) < ksm_min_rss_pages;
+}
+
+/*
+ * An mm skipped for a pass would keep unstable rmap_items from an older
+ * pass than remove_rmap_item_from_tree() allows for.  They are no longer
+ * in root_unstable_tree, which is reset every pass, so just drop them
+ * from the unstable count; stable ones stay, their pages still merged.
+ */
+static void forget_unstable_rmap_items(struct mm_slot *mm_slot)
+{
+	struct rmap_item *rmap_item;
+
+	for (rmap_item = mm_slot->rmap_list; rmap_item;
+	     rmap_item = rmap_item->rmap_list) {
+		if (rmap_item->address & UNSTABLE_FLAG) {
+			ksm_pages_unshared--;
+			rmap_item->address &= PAGE_MASK;
+		}
+	}
+}
+
 static struct rmap_item *scan_get_next_rmap_item(struct page **page)
 {
 	struct mm_struct *mm;
@@ -1319,10 +1491,20 @@ next_mm:
 
 	mm = slot->mm;
 	down_read(&mm->mmap_sem);
-	if (ksm_test_exit(mm))
+	if (ksm_test_exit(mm)) {
 		vma = NULL;
-	else
+	} else if (!ksm_scan.address && ksm_mm_too_small(mm)) {
+		/* Leave it registered, but don't spend time on it this pass */
+		forget_unstable_rmap_items(slot);
+		up_read(&mm->mmap_sem);
+		spin_lock(&ksm_mmlist_lock);
+		ksm_scan.mm_slot = list_entry(slot->mm_list.next,
+						struct mm_slot, mm_list);
+		spin_unlock(&ksm_mmlist_lock);
+		goto next_slot;
+	} else {
 		vma = find_vma(mm, ksm_scan.address);
+	}
 
 	for (; vma; vma = vma->vm_next) {
 		if (!(vma->vm_flags & VM_MERGEABLE))
@@ -1398,6 +1580,7 @@ next_mm:
 		up_read(&mm->mmap_sem);
 	}
 
+next_slot:
 	/* Repeat until we've completed scanning the whole list */
 	slot = ksm_scan.mm_slot;
 	if (slot != &ksm_mm_head)
@@ -1432,22 +1615,56 @@ static int ksmd_should_run(void)
 	return (ksm_run & KSM_RUN_MERGE) && !list_empty(&ksm_mm_head.mm_list);
 }
 
+/*
+ * Account ksmd's CPU time for a batch, and in lightweight mode return how
+ * long to sleep so that it uses no more than ksm_cpu_budget_percent of a
+ * CPU in each KSM_BUDGET_INTERVAL.
+ */
+static long ksm_account_cpu(u64 ran)
+{
+	u64 budget;
+
+	ksm_cpu_time += ran;
+
+	if (time_after_eq(jiffies, ksm_budget_start + KSM_BUDGET_INTERVAL)) {
+		ksm_budget_start = jiffies;
+		ksm_budget_used = 0;
+	}
+	ksm_budget_used += ran;
+
+	if (!ksm_lightweight)
+		return 0;
+
+	budget = (u64)jiffies_to_usecs(KSM_BUDGET_INTERVAL) * NSEC_PER_USEC;
+	do_div(budget, 100);
+	budget *= ksm_cpu_budget_percent;
+	if (ksm_budget_used < budget)
+		return 0;
+	return ksm_budget_start + KSM_BUDGET_INTERVAL - jiffies;
+}
+
 static int ksm_scan_thread(void *nothing)
 {
 	set_freezable();
 	set_user_nice(current, 5);
 
 	while (!kthread_should_stop()) {
+		u64 start = task_sched_runtime(current);
+		long delay;
+
 		mutex_lock(&ksm_thread_mutex);
 		if (ksmd_should_run())
 			ksm_do_scan(ksm_thread_pages_to_scan);
 		mutex_unlock(&ksm_thread_mutex);
 
+		delay = ksm_account_cpu(task_sched_runtime(current) - start);
+
 		try_to_freeze();
 
 		if (ksmd_should_run()) {
-			schedule_timeout_interruptible(
+			delay = max_t(long, delay,
 				msecs_to_jiffies(ksm_thread_sleep_millisecs));
+			schedule_timeout_interruptible(delay);
 		} else {
 			wait_event_freezable(ksm_thread_wait,
 				ksmd_should_run() || kthread_should_stop());
@@ -1926,6 +2143,77 @@ static ssize_t run_store(struct kobject *kobj, struct kobj_attribute *attr,
 }
 KSM_ATTR(run);
 
+static ssize_t lightweight_show(struct kobject *kobj,
+				struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_lightweight);
+}
+
+static ssize_t lightweight_store(struct kobject *kobj,
+				 struct kobj_attribute *attr,
+				 const char *buf, size_t count)
+{
+	int err;
+	unsigned long enable;
+
+	err = strict_strtoul(buf, 10, &enable);
+	if (err || enable > 1)
+		return -EINVAL;
+
+	mutex_lock(&ksm_thread_mutex);
+	ksm_lightweight = enable;
+	mutex_unlock(&ksm_thread_mutex);
+
+	return count;
+}
+KSM_ATTR(lightweight);
+
+static ssize_t min_rss_pages_show(struct kobject *kobj,
+				  struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_min_rss_pages);
+}
+
+static ssize_t min_rss_pages_store(struct kobject *kobj,
+				   struct kobj_attribute *attr,
+				   const char *buf, size_t count)
+{
+	int err;
+	unsigned long nr_pages;
+
+	err = strict_strtoul(buf, 10, &nr_pages);
+	if (err)
+		return -EINVAL;
+
+	ksm_min_rss_pages = nr_pages;
+
+	return count;
+}
+KSM_ATTR(min_rss_pages);
+
+static ssize_t cpu_budget_percent_show(struct kobject *kobj,
+				       struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_cpu_budget_percent);
+}
+
+static ssize_t cpu_budget_percent_store(struct kobject *kobj,
+					struct kobj_attribute *attr,
+					const char *buf, size_t count)
+{
+	int err;
+	unsigned long percent;
+
+	err = strict_strtoul(buf, 10, &percent);
+	if (err || !percent || percent > 100)
+		return -EINVAL;
+
+	ksm_cpu_budget_percent = percent;
+
+	return count;
+}
+KSM_ATTR(cpu_budget_percent);
+
 static ssize_t pages_shared_show(struct kobject *kobj,
 				 struct kobj_attribute *attr, char *buf)
 {
@@ -1971,6 +2259,44 @@ static ssize_t full_scans_show(struct kobject *kobj,
 }
 KSM_ATTR_RO(full_scans);
 
+static ssize_t pages_merged_show(struct kobject *kobj,
+				 struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_pages_merged);
+}
+KSM_ATTR_RO(pages_merged);
+
+static ssize_t zero_pages_merged_show(struct kobject *kobj,
+				      struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_zero_pages_merged);
+}
+KSM_ATTR_RO(zero_pages_merged);
+
+static ssize_t cpu_time_msecs_show(struct kobject *kobj,
+				   struct kobj_attribute *attr, char *buf)
+{
+	u64 msecs = ksm_cpu_time;
+
+	do_div(msecs, NSEC_PER_MSEC);
+	return sprintf(buf, "%llu\n", msecs);
+}
+KSM_ATTR_RO(cpu_time_msecs);
+
+static ssize_t pages_merged_per_cpu_sec_show(struct kobject *kobj,
+					     struct kobj_attribute *attr,
+					     char *buf)
+{
+	u64 msecs = ksm_cpu_time;
+	u64 rate = (u64)ksm_pages_merged * MSEC_PER_SEC;
+
+	do_div(msecs, NSEC_PER_MSEC);
+	if (!msecs)
+		return sprintf(buf, "0\n");
+	return sprintf(buf, "%llu\n", div64_u64(rate, msecs));
+}
+KSM_ATTR_RO(pages_merged_per_cpu_sec);
+
 static struct attribute *ksm_attrs[] = {
 	&sleep_millisecs_attr.attr,
 	&pages_to_scan_attr.attr,
@@ -1980,6 +2306,13 @@ static struct attribute *ksm_attrs[] = {
 	&pages_unshared_attr.attr,
 	&pages_volatile_attr.attr,
 	&full_scans_attr.attr,
+	&lightweight_attr.attr,
+	&min_rss_pages_attr.attr,
+	&cpu_budget_percent_attr.attr,
+	&pages_merged_attr.attr,
+	&zero_pages_merged_attr.attr,
+	&cpu_time_msecs_attr.attr,
+	&pages_merged_per_cpu_sec_attr.attr,
 	NULL,
 };
 
@@ -1992,12 +2325,17 @@ static struct attribute_group ksm_attr_group = {
 static int __init ksm_init(void)
 {
 	struct task_struct *ksm_thread;
+	void *addr;
 	int err;
 
 	err = ksm_slab_init();
 	if (err)
 		goto out;
 
+	addr = kmap_atomic(ZERO_PAGE(0));
+	zero_checksum = calc_sampled_checksum(addr);
+	kunmap_atomic(addr);
+
 	ksm_thread = kthread_run(ksm_scan_thread, NULL, "ksmd");
 	if (IS_ERR(ksm_thread)) {
 		printk(KERN_ERR "ksm: creating kthread failed\n");
@@ -39,6 +39,7 @@
 #include <linux/slab.h>
 #include <linux/swap.h>
 #include <linux/swapops.h>
+#include <linux/shmem_fs.h>
 #include <linux/spinlock.h>
 #include <linux/eventfd.h>
 #include <linux/sort.h>
@@ -207,6 +208,20 @@ struct mem_cgroup_eventfd_list {
 	struct eventfd_ctx *eventfd;
 };
 
+/* for memory pressure */
+enum mem_cgroup_pressure_level {
+	MEM_CGROUP_PRESSURE_LOW,
+	MEM_CGROUP_PRESSURE_MEDIUM,
+	MEM_CGROUP_PRESSURE_CRITICAL,
+	MEM_CGROUP_PRESSURE_NR,
+};
+
+struct mem_cgroup_pressure_event {
+	struct list_head list;
+	struct eventfd_ctx *eventfd;
+	enum mem_cgroup_pressure_level level;
+};
+
 static void mem_cgroup_threshold(struct mem_cgroup *memcg);
 static void mem_cgroup_oom_notify(struct mem_cgroup *memcg);
 
@@ -291,6 +306,20 @@ struct mem_cgroup {
 	/* For oom notifier event fd */
 	struct list_head oom_notify;
 
+	/* reclaim efficiency since the last pressure_level evaluation */
+	spinlock_t	pressure_lock;
+	unsigned long	pressure_scanned;
+	unsigned long	pressure_reclaimed;
+	int		pressure_level;
+	struct work_struct pressure_work;
+
+	/* For pressure_level notifier event fd */
+	struct mutex	pressure_events_lock;
+	struct list_head pressure_events;
+
+	/* Lower values are scanned first and harder by global reclaim */
+	int		reclaim_priority;
+
 	/*
 	 * Should we move charges of a task when a task is moved into this
 	 * mem_cgroup ? And what type of charges should we move ?
@@ -4567,6 +4596,216 @@ static void mem_cgroup_oom_unregister_event(struct cgroup *cgrp,
 	spin_unlock(&memcg_oom_lock);
 }
 
+/*
+ * Memory pressure is derived from how much of what reclaim scanned in a
+ * memcg it could actually free: the fewer pages reclaimed per page
+ * scanned, the harder reclaim has to work and the closer the group is
+ * to thrashing or OOM.  Samples are batched up into windows of
+ * PRESSURE_WINDOW scanned pages so that the levels reflect a trend
+ * rather than individual LRU batches, and are evaluated from a work
+ * item to keep the eventfd signalling off the reclaim path.
+ */
+#define PRESSURE_WINDOW		(SWAP_CLUSTER_MAX * 16)
+#define PRESSURE_MEDIUM		60
+#define PRESSURE_CRITICAL	95
+
+static const char * const mem_cgroup_pressure_str[] = {
+	[MEM_CGROUP_PRESSURE_LOW]	= "low",
+	[MEM_CGROUP_PRESSURE_MEDIUM]	= "medium",
+	[MEM_CGROUP_PRESSURE_CRITICAL]	= "critical",
+};
+
+static enum mem_cgroup_pressure_level
+mem_cgroup_calc_pressure(unsigned long scanned, unsigned long reclaimed)
+{
+	unsigned long pressure;
+
+	/*
+	 * Reclaimed can exceed scanned when huge pages are split or
+	 * freed, which is no sign of pressure at all.
+	 */
+	if (reclaimed >= scanned)
+		return MEM_CGROUP_PRESSURE_LOW;
+
+	pressure = 100 - reclaimed * 100 / scanned;
+	if (pressure >= PRESSURE_CRITICAL)
+		return MEM_CGROUP_PRESSURE_CRITICAL;
+	if (pressure >= PRESSURE_MEDIUM)
+		return MEM_CGROUP_PRESSURE_MEDIUM;
+	return MEM_CGROUP_PRESSURE_LOW;
+}
+
+static bool mem_cgroup_pressure_notify(struct mem_cgroup *memcg,
+				       enum mem_cgroup_pressure_level level)
+{
+	struct mem_cgroup_pressure_event *ev;
+	bool signalled = false;
+
+	mutex_lock(&memcg->pressure_events_lock);
+	list_for_each_entry(ev, &memcg->pressure_events, list) {
+		if (level >= ev->level) {
+			eventfd_signal(ev->eventfd, 1);
+			signalled = true;
+		}
+	}
+	mutex_unlock(&memcg->pressure_events_lock);
+
+	return signalled;
+}
+
+static void mem_cgroup_pressure_work_fn(struct work_struct *work)
+{
+	struct mem_cgroup *memcg = container_of(work, struct mem_cgroup,
+						pressure_work);
+	enum mem_cgroup_pressure_level level;
+	unsigned long scanned, reclaimed;
+
+	spin_lock(&memcg->pressure_lock);
+	scanned = memcg->pressure_scanned;
+	reclaimed = memcg->pressure_reclaimed;
+	memcg->pressure_scanned = 0;
+	memcg->pressure_reclaimed = 0;
+	spin_unlock(&memcg->pressure_lock);
+
+	if (!scanned)
+		return;
+
+	level = mem_cgroup_calc_pressure(scanned, reclaimed);
+	memcg->pressure_level = level;
+
+	/*
+	 * Pressure in a child is pressure in its parents as well, so hand
+	 * it up the hierarchy until somebody is listening.
+	 */
+	do {
+		if (mem_cgroup_pressure_notify(memcg, level))
+			break;
+	} while ((memcg = parent_mem_cgroup(memcg)));
+}
+
+/**
+ * mem_cgroup_vmpressure - account reclaim efficiency of a memcg
+ * @memcg: memcg that was scanned, %NULL for the global LRU
+ * @scanned: number of pages scanned
+ * @reclaimed: number of pages reclaimed
+ *
+ * Called by reclaim after every pass over the LRU lists of @memcg.
+ */
+void mem_cgroup_vmpressure(struct mem_cgroup *memcg, unsigned long scanned,
+			   unsigned long reclaimed)
+{
+	if (!memcg || !scanned)
+		return;
+
+	spin_lock(&memcg->pressure_lock);
+	memcg->pressure_scanned += scanned;
+	memcg->pressure_reclaimed += reclaimed;
+	scanned = memcg->pressure_scanned;
+	spin_unlock(&memcg->pressure_lock);
+
+	if (scanned >= PRESSURE_WINDOW)
+		schedule_work(&memcg->pressure_work);
+}
+
+static int mem_cgroup_pressure_read(struct cgroup *cgrp, struct cftype *cft,
+				    struct seq_file *m)
+{
+	struct mem_cgroup *memcg = mem_cgroup_from_cont(cgrp);
+
+	seq_printf(m, "%s\n", mem_cgroup_pressure_str[memcg->pressure_level]);
+	return 0;
+}
+
+static int mem_cgroup_pressure_register_event(struct cgroup *cgrp,
+	struct cftype *cft, struct eventfd_ctx *eventfd, const char *args)
+{
+	struct mem_cgroup *memcg = mem_cgroup_from_cont(cgrp);
+	struct mem_cgroup_pressure_event *event;
+	int level;
+
+	for (level = 0; level < MEM_CGROUP_PRESSURE_NR; level++) {
+		if (!strcmp(mem_cgroup_pressure_str[level], args))
+			break;
+	}
+	if (level == MEM_CGROUP_PRESSURE_NR)
+		return -EINVAL;
+
+	event = kmalloc(sizeof(*event), GFP_KERNEL);
+	if (!event)
+		return -ENOMEM;
+
+	event->eventfd = eventfd;
+	event->level = level;
+
+	mutex_lock(&memcg->pressure_events_lock);
+	list_add(&event->list, &memcg->pressure_events);
+	mutex_unlock(&memcg->pressure_events_lock);
+
+	return 0;
+}
+
+static void mem_cgroup_pressure_unregister_event(struct cgroup *cgrp,
+	struct cftype *cft, struct eventfd_ctx *eventfd)
+{
+	struct mem_cgroup *memcg = mem_cgroup_from_cont(cgrp);
+	struct mem_cgroup_pressure_event *ev, *tmp;
+
+	mutex_lock(&memcg->pressure_events_lock);
+	list_for_each_entry_safe(ev, tmp, &memcg->pressure_events, list) {
+		if (ev->eventfd == eventfd) {
+			list_del(&ev->list);
+			kfree(ev);
+		}
+	}
+	mutex_unlock(&memcg->pressure_events_lock);
+}
+
+/* Number of memcgs with a reclaim_priority below the default */
+static atomic_t nr_reclaim_prioritized = ATOMIC_INIT(0);
+
+int mem_cgroup_reclaim_priority(struct mem_cgroup *memcg)
+{
+	if (!memcg)
+		return MEM_CGROUP_RECLAIM_PRIO_MAX;
+	return memcg->reclaim_priority;
+}
+
+bool mem_cgroup_reclaim_prioritized(void)
+{
+	return atomic_read(&nr_reclaim_prioritized) != 0;
+}
+
+static void mem_cgroup_set_reclaim_priority(struct mem_cgroup *memcg, int prio)
+{
+	bool was = memcg->reclaim_priority < MEM_CGROUP_RECLAIM_PRIO_MAX;
+	bool is = prio < MEM_CGROUP_RECLAIM_PRIO_MAX;
+
+	if (is && !was)
+		atomic_inc(&nr_reclaim_prioritized);
+	else if (was && !is)
+		atomic_dec(&nr_reclaim_prioritized);
+	memcg->reclaim_priority = prio;
+}
+
+static u64 mem_cgroup_reclaim_priority_read(struct cgroup *cgrp,
+					    struct cftype *cft)
+{
+	return mem_cgroup_from_cont(cgrp)->reclaim_priority;
+}
+
+static int mem_cgroup_reclaim_priority_write(struct cgroup *cgrp,
+					     struct cftype *cft, u64 val)
+{
+	/* the root cgroup always stays at the default priority */
+	if (!cgrp->parent || val > MEM_CGROUP_RECLAIM_PRIO_MAX)
+		return -EINVAL;
+
+	cgroup_lock();
+	mem_cgroup_set_reclaim_priority(mem_cgroup_from_cont(cgrp), val);
+	cgroup_unlock();
+	return 0;
+}
+
 static int mem_cgroup_oom_control_read(struct cgroup *cgrp,
 	struct cftype *cft,  struct cgroup_map_cb *cb)
 {
@@ -4714,6 +4953,17 @@ static struct cftype mem_cgroup_files[] = {
 		.unregister_event = mem_cgroup_oom_unregister_event,
 		.private = MEMFILE_PRIVATE(_OOM_TYPE, OOM_CONTROL),
 	},
+	{
+		.name = "pressure_level",
+		.read_seq_string = mem_cgroup_pressure_read,
+		.register_event = mem_cgroup_pressure_register_event,
+		.unregister_event = mem_cgroup_pressure_unregister_event,
+	},
+	{
+		.name = "reclaim_priority",
+		.read_u64 = mem_cgroup_reclaim_priority_read,
+		.write_u64 = mem_cgroup_reclaim_priority_write,
+	},
 #ifdef CONFIG_NUMA
 	{
 		.name = "numa_stat",
@@ -5012,10 +5262,18 @@ mem_cgroup_create(struct cgroup *cont)
 
 	if (parent)
 		memcg->swappiness = mem_cgroup_swappiness(parent);
+	memcg->reclaim_priority = MEM_CGROUP_RECLAIM_PRIO_MAX;
+	if (parent)
+		mem_cgroup_set_reclaim_priority(memcg,
+						parent->reclaim_priority);
 	atomic_set(&memcg->refcnt, 1);
 	memcg->move_charge_at_immigrate = 0;
 	mutex_init(&memcg->thresholds_lock);
 	spin_lock_init(&memcg->move_lock);
+	spin_lock_init(&memcg->pressure_lock);
+	INIT_WORK(&memcg->pressure_work, mem_cgroup_pressure_work_fn);
+	mutex_init(&memcg->pressure_events_lock);
+	INIT_LIST_HEAD(&memcg->pressure_events);
 	return &memcg->css;
 free_out:
 	__mem_cgroup_free(memcg);
@@ -5035,6 +5293,8 @@ static void mem_cgroup_destroy(struct cgroup *cont)
 
 	kmem_cgroup_destroy(cont);
 
+	cancel_work_sync(&memcg->pressure_work);
+	mem_cgroup_set_reclaim_priority(memcg, MEM_CGROUP_RECLAIM_PRIO_MAX);
 	mem_cgroup_put(memcg);
 }
 
@@ -5200,16 +5460,20 @@ static struct page *mc_handle_file_pte(struct vm_area_struct *vma,
 		pgoff = pte_to_pgoff(ptent);
 
 	/* page is moved even if it's not RSS of this task(page-faulted). */
-	page = find_get_page(mapping, pgoff);
-
 #ifdef CONFIG_SWAP
 	/* shmem/tmpfs may report page out on swap: account for that too. */
-	if (radix_tree_exceptional_entry(page)) {
-		swp_entry_t swap = radix_to_swp_entry(page);
-		if (do_swap_account)
-			*entry = swap;
-		page = find_get_page(&swapper_space, swap.val);
-	}
+	if (shmem_mapping(mapping)) {
+		page = find_get_entry(mapping, pgoff);
+		if (radix_tree_exceptional_entry(page)) {
+			swp_entry_t swap = radix_to_swp_entry(page);
+			if (do_swap_account)
+				*entry = swap;
+			page = find_get_page(&swapper_space, swap.val);
+		}
+	} else
+		page = find_get_page(mapping, pgoff);
+#else
+	page = find_get_page(mapping, pgoff);
 #endif
 	return page;
 }
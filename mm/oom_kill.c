@@ -35,6 +35,8 @@
 #include <linux/freezer.h>
 #include <linux/ftrace.h>
 #include <linux/ratelimit.h>
+#include <linux/kthread.h>
+#include <linux/wait.h>
 
 #define CREATE_TRACE_POINTS
 #include <trace/events/oom.h>
@@ -373,6 +375,7 @@ static void oom_kill_process(struct task_struct *p, gfp_t gfp_mask, int order,
 
 	set_tsk_thread_flag(victim, TIF_MEMDIE);
 	do_send_sig_info(SIGKILL, SEND_SIG_FORCED, victim, true);
+	wake_oom_reaper(victim);
 }
 #undef K
 
@@ -558,3 +561,204 @@ void pagefault_out_of_memory(void)
 	if (!test_thread_flag(TIF_MEMDIE))
 		schedule_timeout_uninterruptible(1);
 }
+
+#ifdef CONFIG_MMU
+/*
+ * A killed task only gives its memory back once it gets to exit_mmap(),
+ * which can take a long time if it is blocked or has a lot of threads to
+ * tear down.  The reaper unmaps the private memory of the victim from a
+ * dedicated thread as soon as it has been killed, so the pages go back to
+ * the allocator while the victim is still on its way out.
+ */
+#define MAX_OOM_REAP_RETRIES 10
+
+static struct task_struct *oom_reaper_th;
+static DECLARE_WAIT_QUEUE_HEAD(oom_reaper_wait);
+static struct task_struct *oom_reaper_list;
+static DEFINE_SPINLOCK(oom_reaper_lock);
+
+static bool __oom_reap_task(struct task_struct *tsk)
+{
+	struct vm_area_struct *vma;
+	struct mm_struct *mm;
+	struct task_struct *p;
+	unsigned long rss, released;
+	u64 now;
+
+	p = find_lock_task_mm(tsk);
+	if (!p)
+		return true;
+
+	mm = p->mm;
+	if (!atomic_inc_not_zero(&mm->mm_users)) {
+		task_unlock(p);
+		return true;
+	}
+	task_unlock(p);
+
+	if (!down_read_trylock(&mm->mmap_sem)) {
+		mmput(mm);
+		return false;
+	}
+
+	
+	if (mm->core_state || test_and_set_bit(MMF_OOM_REAPED, &mm->flags)) {
+		up_read(&mm->mmap_sem);
+		mmput(mm);
+		return true;
+	}
+
+	rss = get_mm_rss(mm);
+	for (vma = mm->mmap ; vma; vma = vma->vm_next) {
+		if (is_vm_hugetlb_page(vma))
+			continue;
+		if (vma->vm_flags & (VM_LOCKED | VM_PFNMAP | VM_IO | VM_SHARED))
+			continue;
+		zap_page_range(vma, vma->vm_start, vma->vm_end - vma->vm_start,
+			       NULL);
+	}
+	released = rss - get_mm_rss(mm);
+	up_read(&mm->mmap_sem);
+
+	now = local_clock();
+	count_vm_event(OOM_REAP_SUCCESS);
+	count_vm_events(OOM_REAP_PAGES, released);
+	count_vm_events(OOM_REAP_RELEASE_US,
+			div_u64(now - tsk->oom_reap_queued, NSEC_PER_USEC));
+
+	mmput(mm);
+	return true;
+}
+
+static void oom_reap_task(struct task_struct *tsk)
+{
+	int attempts = 0;
+	bool reaped;
+
+	while (!(reaped = __oom_reap_task(tsk)) &&
+	       ++attempts < MAX_OOM_REAP_RETRIES)
+		schedule_timeout_interruptible(HZ/10);
+
+	if (!reaped) {
+		pr_info("oom_reaper: unable to reap pid:%d (%s)\n",
+			task_pid_nr(tsk), tsk->comm);
+		count_vm_event(OOM_REAP_FAILED);
+	}
+
+	put_task_struct(tsk);
+}
+
+static int oom_reaper(void *unused)
+{
+	set_freezable();
+
+	while (!kthread_should_stop()) {
+		struct task_struct *tsk = NULL;
+
+		wait_event_freezable(oom_reaper_wait,
+				     oom_reaper_list != NULL ||
+				     kthread_should_stop());
+		spin_lock(&oom_reaper_lock);
+		if (oom_reaper_list != NULL) {
+			tsk = oom_reaper_list;
+			oom_reaper_list = tsk->oom_reaper_list;
+		}
+		spin_unlock(&oom_reaper_lock);
+
+		if (tsk)
+			oom_reap_task(tsk);
+	}
+
+	return 0;
+}
+
+static bool process_shares_mm(struct task_struct *p, struct mm_struct *mm)
+{
+	struct task_struct *t = p;
+
+	do {
+		if (ACCESS_ONCE(t->mm) == mm)
+			return true;
+	} while_each_thread(p, t);
+
+	return false;
+}
+
+/*
+ * The private mappings of @mm can only be torn down if nobody outside the
+ * killed thread groups is still running on it, e.g. the parent of a vfork
+ * child or a sharer the OOM killer left alone because of OOM_SCORE_ADJ_MIN.
+ */
+static bool mm_is_reapable(struct task_struct *tsk, struct mm_struct *mm)
+{
+	struct task_struct *p;
+	bool ret = true;
+
+	rcu_read_lock();
+	for_each_process(p) {
+		if (!process_shares_mm(p, mm))
+			continue;
+		if (same_thread_group(p, tsk))
+			continue;
+		if ((p->flags & PF_KTHREAD) || is_global_init(p) ||
+		    !(fatal_signal_pending(p) ||
+		      (p->signal->flags & SIGNAL_GROUP_EXIT))) {
+			ret = false;
+			break;
+		}
+	}
+	rcu_read_unlock();
+
+	return ret;
+}
+
+void wake_oom_reaper(struct task_struct *tsk)
+{
+	struct mm_struct *mm;
+	struct task_struct *p;
+	bool reapable;
+
+	if (!oom_reaper_th)
+		return;
+
+	p = find_lock_task_mm(tsk);
+	if (!p)
+		return;
+	mm = p->mm;
+	atomic_inc(&mm->mm_count);
+	task_unlock(p);
+
+	reapable = mm_is_reapable(tsk, mm);
+	if (!reapable)
+		set_bit(MMF_OOM_REAPED, &mm->flags);
+	mmdrop(mm);
+	if (!reapable)
+		return;
+
+	spin_lock(&oom_reaper_lock);
+	if (tsk->oom_reap_queued) {
+		spin_unlock(&oom_reaper_lock);
+		return;
+	}
+	get_task_struct(tsk);
+	tsk->oom_reap_queued = local_clock();
+	tsk->oom_reaper_list = oom_reaper_list;
+	oom_reaper_list = tsk;
+	spin_unlock(&oom_reaper_lock);
+
+	wake_up(&oom_reaper_wait);
+}
+EXPORT_SYMBOL_GPL(wake_oom_reaper);
+
+static int __init oom_init(void)
+{
+	oom_reaper_th = kthread_run(oom_reaper, NULL, "oom_reaper");
+	if (IS_ERR(oom_reaper_th)) {
+		pr_err("Unable to start OOM reaper %ld. Continuing regardless\n",
+				PTR_ERR(oom_reaper_th));
+		oom_reaper_th = NULL;
+	}
+	return 0;
+}
+subsys_initcall(oom_init);
+#endif
@@ -1021,20 +1021,15 @@ void mark_free_pages(struct zone *zone)
 }
 #endif 
 
-void free_hot_cold_page(struct page *page, int cold)
+static void __free_hot_cold_page(struct page *page, int cold,
+				 int wasMlocked)
 {
 	struct zone *zone = page_zone(page);
 	struct per_cpu_pages *pcp;
-	unsigned long flags;
 	int migratetype;
-	int wasMlocked = __TestClearPageMlocked(page);
-
-	if (!free_pages_prepare(page, 0))
-		return;
 
 	migratetype = get_pageblock_migratetype(page);
 	set_page_private(page, migratetype);
-	local_irq_save(flags);
 	if (unlikely(wasMlocked))
 		free_page_mlock(page);
 	__count_vm_event(PGFREE);
@@ -1042,7 +1037,7 @@ void free_hot_cold_page(struct page *page, int cold)
 	if (migratetype >= MIGRATE_PCPTYPES) {
 		if (unlikely(migratetype == MIGRATE_ISOLATE)) {
 			free_one_page(zone, page, 0, migratetype);
-			goto out;
+			return;
 		}
 		migratetype = MIGRATE_MOVABLE;
 	}
@@ -1057,19 +1052,57 @@ void free_hot_cold_page(struct page *page, int cold)
 		free_pcppages_bulk(zone, pcp->batch, pcp);
 		pcp->count -= pcp->batch;
 	}
+}
 
-out:
+void free_hot_cold_page(struct page *page, int cold)
+{
+	unsigned long flags;
+	int wasMlocked = __TestClearPageMlocked(page);
+
+	if (!free_pages_prepare(page, 0))
+		return;
+
+	local_irq_save(flags);
+	__free_hot_cold_page(page, cold, wasMlocked);
 	local_irq_restore(flags);
 }
 
+/*
+ * Free a list of order-0 pages, as collected by release_pages() on
+ * munmap and exit.  The pages are checked and prepared with interrupts
+ * enabled, then go to the per-cpu lists in batches of FREE_PAGE_BATCH
+ * with interrupts disabled once per batch rather than once per page.
+ */
+#define FREE_PAGE_BATCH		SWAP_CLUSTER_MAX
+
 void free_hot_cold_page_list(struct list_head *list, int cold)
 {
 	struct page *page, *next;
+	unsigned long flags;
+	int batch = 0;
 
 	list_for_each_entry_safe(page, next, list, lru) {
+		int wasMlocked = __TestClearPageMlocked(page);
+
 		trace_mm_page_free_batched(page, cold);
-		free_hot_cold_page(page, cold);
+		if (!free_pages_prepare(page, 0)) {
+			list_del(&page->lru);
+			continue;
+		}
+		set_page_private(page, wasMlocked);
 	}
+
+	local_irq_save(flags);
+	list_for_each_entry_safe(page, next, list, lru) {
+		__free_hot_cold_page(page, cold, page_private(page));
+
+		if (++batch == FREE_PAGE_BATCH) {
+			local_irq_restore(flags);
+			batch = 0;
+			local_irq_save(flags);
+		}
+	}
+	local_irq_restore(flags);
 }
 
 void split_page(struct page *page, unsigned int order)
@@ -1087,6 +1120,7 @@ void split_page(struct page *page, unsigned int order)
 	for (i = 1; i < (1 << order); i++)
 		set_page_refcounted(page + i);
 }
+EXPORT_SYMBOL_GPL(split_page);
 
 int split_free_page(struct page *page)
 {
@@ -3355,6 +3389,9 @@ static void __paginginit free_area_init_core(struct pglist_data *pgdat,
 	pgdat->nr_zones = 0;
 	init_waitqueue_head(&pgdat->kswapd_wait);
 	pgdat->kswapd_max_order = 0;
+#ifdef CONFIG_COMPACTION
+	init_waitqueue_head(&pgdat->kcompactd_wait);
+#endif
 	pgdat_page_cgroup_init(pgdat);
 
 	for (j = 0; j < MAX_NR_ZONES; j++) {
@@ -4415,8 +4452,10 @@ int alloc_contig_range(unsigned long start, unsigned long end,
 		goto done;
 
 	ret = __alloc_contig_migrate_range(start, end);
-	if (ret)
+	if (ret) {
+		count_vm_event(CMA_MIGRATE_FAIL);
 		goto done;
+	}
 
 
 	lru_add_drain_all();
@@ -4458,6 +4497,7 @@ int alloc_contig_range(unsigned long start, unsigned long end,
 done:
 	undo_isolate_page_range(pfn_max_align_down(start),
 				pfn_max_align_up(end), migratetype);
+	count_vm_event(ret ? CMA_ALLOC_FAIL : CMA_ALLOC_SUCCESS);
 	return ret;
 }
 
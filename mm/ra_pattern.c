@@ -0,0 +1,367 @@
+/*
+ * mm/ra_pattern.c - learned readahead for files opened repeatedly.
+ *
+ * For a short window after a regular file is opened, every range of pages
+ * read in from it is recorded in a small per-file table of sorted page
+ * ranges.  The next time the same file is opened, the recorded ranges are
+ * prefetched asynchronously, so reads that the sequential heuristic in
+ * ondemand_readahead() cannot predict (an app touching scattered parts of
+ * its APK and dex files at launch) find their pages already in flight.
+ *
+ * A pattern is only allocated once a file actually misses in the page cache
+ * during its window, so opens of cached or never-read files cost a hash
+ * lookup.  Patterns live in a hash table whose buckets each have their own
+ * lock and keep a bounded number of files in LRU order; they are dropped
+ * when the file's size or mtime changes.
+ */
+
+#include <linux/kernel.h>
+#include <linux/fs.h>
+#include <linux/file.h>
+#include <linux/mm.h>
+#include <linux/slab.h>
+#include <linux/hash.h>
+#include <linux/jiffies.h>
+#include <linux/kref.h>
+#include <linux/workqueue.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/vmstat.h>
+#include <linux/ra_pattern.h>
+
+#define RA_PATTERN_RANGES	32
+#define RA_PATTERN_GAP		4
+#define RA_PATTERN_HASH_BITS	8
+#define RA_PATTERN_BUCKET_FILES	4
+
+struct ra_pattern_range {
+	pgoff_t		start;
+	unsigned int	nr;
+};
+
+struct ra_pattern {
+	struct list_head	lru;
+	struct kref		kref;
+
+	dev_t			dev;
+	unsigned long		ino;
+	u32			generation;
+	loff_t			isize;
+	struct timespec		mtime;
+
+	spinlock_t		lock;
+	unsigned int		nr;
+	struct ra_pattern_range	range[RA_PATTERN_RANGES];
+};
+
+struct ra_pattern_bucket {
+	spinlock_t		lock;
+	struct list_head	lru;
+	unsigned int		nr;
+};
+
+struct ra_pattern_replay {
+	struct work_struct	work;
+	struct file		*file;
+	unsigned int		nr;
+	struct ra_pattern_range	range[RA_PATTERN_RANGES];
+};
+
+int sysctl_readahead_pattern = 2;
+unsigned int sysctl_readahead_pattern_window_ms = 3000;
+
+static struct ra_pattern_bucket ra_pattern_hash[1 << RA_PATTERN_HASH_BITS];
+
+static void ra_pattern_free(struct kref *kref)
+{
+	kfree(container_of(kref, struct ra_pattern, kref));
+}
+
+static struct ra_pattern_bucket *ra_pattern_bucket(struct inode *inode)
+{
+	unsigned long key = inode->i_ino ^ inode->i_sb->s_dev;
+
+	return &ra_pattern_hash[hash_long(key, RA_PATTERN_HASH_BITS)];
+}
+
+/* Called with b->lock held; a hit is moved to the head of the bucket. */
+static struct ra_pattern *__ra_pattern_lookup(struct ra_pattern_bucket *b,
+					      struct inode *inode)
+{
+	struct ra_pattern *p;
+
+	list_for_each_entry(p, &b->lru, lru) {
+		if (p->ino == inode->i_ino && p->dev == inode->i_sb->s_dev &&
+		    p->generation == inode->i_generation) {
+			list_move(&p->lru, &b->lru);
+			kref_get(&p->kref);
+			return p;
+		}
+	}
+
+	return NULL;
+}
+
+static struct ra_pattern *ra_pattern_lookup(struct inode *inode)
+{
+	struct ra_pattern_bucket *b = ra_pattern_bucket(inode);
+	struct ra_pattern *p;
+
+	spin_lock(&b->lock);
+	p = __ra_pattern_lookup(b, inode);
+	spin_unlock(&b->lock);
+
+	return p;
+}
+
+static struct ra_pattern *ra_pattern_create(struct inode *inode)
+{
+	struct ra_pattern_bucket *b = ra_pattern_bucket(inode);
+	struct ra_pattern *p, *new, *victim = NULL;
+
+	new = kzalloc(sizeof(*new), GFP_NOFS | __GFP_NOWARN);
+	if (!new)
+		return NULL;
+
+	spin_lock(&b->lock);
+	p = __ra_pattern_lookup(b, inode);
+	if (!p) {
+		p = new;
+		new = NULL;
+		kref_init(&p->kref);
+		spin_lock_init(&p->lock);
+		p->dev = inode->i_sb->s_dev;
+		p->ino = inode->i_ino;
+		p->generation = inode->i_generation;
+		p->isize = i_size_read(inode);
+		p->mtime = inode->i_mtime;
+		list_add(&p->lru, &b->lru);
+		kref_get(&p->kref);
+
+		if (++b->nr > RA_PATTERN_BUCKET_FILES) {
+			victim = list_entry(b->lru.prev, struct ra_pattern, lru);
+			list_del(&victim->lru);
+			b->nr--;
+		}
+	}
+	spin_unlock(&b->lock);
+
+	kfree(new);
+	if (victim)
+		kref_put(&victim->kref, ra_pattern_free);
+
+	return p;
+}
+
+static void ra_pattern_replay_fn(struct work_struct *work)
+{
+	struct ra_pattern_replay *r;
+	struct file *file;
+	unsigned int i;
+	int ret;
+
+	r = container_of(work, struct ra_pattern_replay, work);
+	file = r->file;
+
+	for (i = 0; i < r->nr; i++) {
+		ret = force_page_cache_readahead(file->f_mapping, file,
+						 r->range[i].start,
+						 r->range[i].nr);
+		if (ret > 0)
+			count_vm_events(RA_PATTERN_REPLAYED, ret);
+	}
+
+	fput(file);
+	kfree(r);
+}
+
+static void ra_pattern_replay(struct file *file, struct ra_pattern *p)
+{
+	struct ra_pattern_replay *r;
+
+	r = kmalloc(sizeof(*r), GFP_KERNEL);
+	if (!r)
+		return;
+
+	spin_lock(&p->lock);
+	r->nr = p->nr;
+	memcpy(r->range, p->range, p->nr * sizeof(p->range[0]));
+	spin_unlock(&p->lock);
+
+	if (!r->nr) {
+		kfree(r);
+		return;
+	}
+
+	get_file(file);
+	r->file = file;
+	INIT_WORK(&r->work, ra_pattern_replay_fn);
+	queue_work(system_unbound_wq, &r->work);
+}
+
+void ra_pattern_open(struct file *file)
+{
+	struct inode *inode = file->f_mapping->host;
+	struct ra_pattern *p;
+	bool stale;
+
+	if (!sysctl_readahead_pattern || !S_ISREG(inode->i_mode) ||
+	    !(file->f_mode & FMODE_READ) || (file->f_flags & O_DIRECT) ||
+	    !file->f_ra.ra_pages)
+		return;
+
+	file->f_ra_pattern_until = jiffies +
+		msecs_to_jiffies(sysctl_readahead_pattern_window_ms);
+
+	p = ra_pattern_lookup(inode);
+	if (!p)
+		return;
+
+	spin_lock(&p->lock);
+	stale = p->isize != i_size_read(inode) ||
+		!timespec_equal(&p->mtime, &inode->i_mtime);
+	if (stale) {
+		p->nr = 0;
+		p->isize = i_size_read(inode);
+		p->mtime = inode->i_mtime;
+	}
+	spin_unlock(&p->lock);
+
+	if (!stale && sysctl_readahead_pattern > 1)
+		ra_pattern_replay(file, p);
+
+	file->f_ra_pattern = p;
+}
+
+void ra_pattern_release(struct file *file)
+{
+	if (file->f_ra_pattern) {
+		kref_put(&file->f_ra_pattern->kref, ra_pattern_free);
+		file->f_ra_pattern = NULL;
+	}
+}
+
+/*
+ * Merge [start, start + nr) into the sorted range table, joining ranges
+ * that overlap or are separated by at most RA_PATTERN_GAP pages.
+ */
+static void ra_pattern_add(struct ra_pattern *p, pgoff_t start,
+			   unsigned long nr)
+{
+	pgoff_t end = start + nr;
+	struct ra_pattern_range *r;
+	unsigned int i, j;
+
+	for (i = 0; i < p->nr; i++)
+		if (p->range[i].start + p->range[i].nr + RA_PATTERN_GAP >= start)
+			break;
+
+	r = &p->range[i];
+	if (i == p->nr || r->start > end + RA_PATTERN_GAP) {
+		if (p->nr == RA_PATTERN_RANGES)
+			return;
+		memmove(r + 1, r, (p->nr - i) * sizeof(*r));
+		r->start = start;
+		r->nr = nr;
+		p->nr++;
+		return;
+	}
+
+	start = min(r->start, start);
+	end = max_t(pgoff_t, end, r->start + r->nr);
+	for (j = i + 1; j < p->nr; j++) {
+		if (p->range[j].start > end + RA_PATTERN_GAP)
+			break;
+		end = max_t(pgoff_t, end, p->range[j].start + p->range[j].nr);
+	}
+
+	r->start = start;
+	r->nr = end - start;
+	memmove(r + 1, &p->range[j], (p->nr - j) * sizeof(*r));
+	p->nr -= j - i - 1;
+}
+
+void __ra_pattern_record(struct file *file, pgoff_t start, unsigned long nr)
+{
+	struct ra_pattern *p = file->f_ra_pattern;
+
+	if (time_after(jiffies, file->f_ra_pattern_until)) {
+		file->f_ra_pattern_until = 0;
+		return;
+	}
+
+	if (!p) {
+		p = ra_pattern_create(file->f_mapping->host);
+		if (!p)
+			return;
+		if (cmpxchg(&file->f_ra_pattern, NULL, p)) {
+			kref_put(&p->kref, ra_pattern_free);
+			p = file->f_ra_pattern;
+		}
+	}
+
+	spin_lock(&p->lock);
+	ra_pattern_add(p, start, nr);
+	spin_unlock(&p->lock);
+
+	count_vm_events(RA_PATTERN_RECORDED, nr);
+}
+
+static int __init ra_pattern_init(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(ra_pattern_hash); i++) {
+		spin_lock_init(&ra_pattern_hash[i].lock);
+		INIT_LIST_HEAD(&ra_pattern_hash[i].lru);
+	}
+	return 0;
+}
+core_initcall(ra_pattern_init);
+
+#ifdef CONFIG_DEBUG_FS
+static int ra_pattern_show(struct seq_file *m, void *v)
+{
+	struct ra_pattern_bucket *b;
+	struct ra_pattern *p;
+	unsigned int i;
+
+	for (b = ra_pattern_hash; b < ra_pattern_hash +
+	     ARRAY_SIZE(ra_pattern_hash); b++) {
+		spin_lock(&b->lock);
+		list_for_each_entry(p, &b->lru, lru) {
+			seq_printf(m, "%u:%u %lu", MAJOR(p->dev),
+				   MINOR(p->dev), p->ino);
+			spin_lock(&p->lock);
+			for (i = 0; i < p->nr; i++)
+				seq_printf(m, " %lu+%u", p->range[i].start,
+					   p->range[i].nr);
+			spin_unlock(&p->lock);
+			seq_putc(m, '\n');
+		}
+		spin_unlock(&b->lock);
+	}
+
+	return 0;
+}
+
+static int ra_pattern_debug_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ra_pattern_show, NULL);
+}
+
+static const struct file_operations ra_pattern_debug_fops = {
+	.open		= ra_pattern_debug_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init ra_pattern_debugfs_init(void)
+{
+	debugfs_create_file("readahead_patterns", S_IRUSR, NULL, NULL,
+			    &ra_pattern_debug_fops);
+	return 0;
+}
+late_initcall(ra_pattern_debugfs_init);
+#endif
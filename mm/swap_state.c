@@ -17,6 +17,7 @@
 #include <linux/pagevec.h>
 #include <linux/migrate.h>
 #include <linux/page_cgroup.h>
+#include <linux/vmstat.h>
 
 #include <asm/pgtable.h>
 
@@ -45,6 +46,31 @@ struct address_space swapper_space = {
 
 #define INC_CACHE_INFO(x)	do { swap_cache_info.x++; } while (0)
 
+/*
+ * The VMA readahead state lives in vma->swap_readahead_info: the page
+ * aligned address of the last swap fault, the readahead window that was
+ * used for it and the number of readahead hits since then, packed into
+ * the low bits.
+ */
+#define SWAP_RA_WIN_SHIFT	(PAGE_SHIFT / 2)
+#define SWAP_RA_HITS_MASK	((1UL << SWAP_RA_WIN_SHIFT) - 1)
+#define SWAP_RA_HITS_MAX	SWAP_RA_HITS_MASK
+#define SWAP_RA_WIN_MASK	(~PAGE_MASK & ~SWAP_RA_HITS_MASK)
+
+#define SWAP_RA_HITS(v)		((v) & SWAP_RA_HITS_MASK)
+#define SWAP_RA_WIN(v)		(((v) & SWAP_RA_WIN_MASK) >> SWAP_RA_WIN_SHIFT)
+#define SWAP_RA_ADDR(v)		((v) & PAGE_MASK)
+
+#define SWAP_RA_VAL(addr, win, hits)				\
+	(((addr) & PAGE_MASK) |					\
+	 (((win) << SWAP_RA_WIN_SHIFT) & SWAP_RA_WIN_MASK) |	\
+	 ((hits) & SWAP_RA_HITS_MASK))
+
+/* Largest window is 1 << SWAP_RA_ORDER_CEILING pages, whatever page_cluster is */
+#define SWAP_RA_ORDER_CEILING	5
+
+int sysctl_swap_vma_readahead = 1;
+
 static struct {
 	unsigned long add_total;
 	unsigned long del_total;
@@ -257,15 +283,34 @@ void free_pages_and_swap_cache(struct page **pages, int nr)
  * unlocked and with its refcount incremented - we rely on the kernel
  * lock getting page table operations atomic even if we drop the page
  * lock before returning.
+ *
+ * If the page was brought in by readahead, account the hit, and credit
+ * it to @vma so that swap_vma_readahead() can grow its window.
  */
-struct page * lookup_swap_cache(swp_entry_t entry)
+struct page * lookup_swap_cache(swp_entry_t entry,
+			struct vm_area_struct *vma, unsigned long addr)
 {
 	struct page *page;
 
 	page = find_get_page(&swapper_space, entry.val);
 
-	if (page)
+	if (page) {
 		INC_CACHE_INFO(find_success);
+		/* PG_readahead is PG_reclaim while the page is under writeback */
+		if (!PageWriteback(page) && TestClearPageReadahead(page)) {
+			count_vm_event(SWAP_RA_HIT);
+			if (vma) {
+				unsigned long ra_val, hits;
+
+				ra_val = atomic_long_read(&vma->swap_readahead_info);
+				hits = min(SWAP_RA_HITS(ra_val) + 1,
+					   SWAP_RA_HITS_MAX);
+				atomic_long_set(&vma->swap_readahead_info,
+					SWAP_RA_VAL(addr, SWAP_RA_WIN(ra_val), hits));
+			}
+		}
+	} else
+		count_vm_event(SWAP_RA_MISS);
 
 	INC_CACHE_INFO(find_total);
 	return page;
@@ -275,14 +320,17 @@ struct page * lookup_swap_cache(swp_entry_t entry)
  * Locate a page of swap in physical memory, reserving swap cache space
  * and reading the disk if it is not already cached.
  * A failure return means that either the page allocation failed or that
- * the swap entry is no longer in use.
+ * the swap entry is no longer in use.  *@new_page_read tells whether a
+ * read was started for a newly allocated page.
  */
-struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
-			struct vm_area_struct *vma, unsigned long addr)
+static struct page *__read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr,
+			bool *new_page_read)
 {
 	struct page *found_page, *new_page = NULL;
 	int err;
 
+	*new_page_read = false;
 	do {
 		/*
 		 * First check the swap cache.  Since this is normally
@@ -333,6 +381,7 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
 			 */
 			lru_cache_add_anon(new_page);
 			swap_readpage(new_page);
+			*new_page_read = true;
 			return new_page;
 		}
 		radix_tree_preload_end();
@@ -350,6 +399,36 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
 	return found_page;
 }
 
+struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr)
+{
+	bool new_page_read;
+
+	return __read_swap_cache_async(entry, gfp_mask, vma, addr,
+				       &new_page_read);
+}
+
+/*
+ * Start an async read of a readahead page, marking it PG_readahead when
+ * we actually had to read it so that a later hit can be told apart.
+ * Returns true if a read was started.
+ */
+static bool swap_readahead_one(swp_entry_t entry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr)
+{
+	struct page *page;
+	bool new_page_read;
+
+	page = __read_swap_cache_async(entry, gfp_mask, vma, addr,
+				       &new_page_read);
+	if (!page)
+		return false;
+	if (new_page_read)
+		SetPageReadahead(page);
+	page_cache_release(page);
+	return new_page_read;
+}
+
 /**
  * swapin_readahead - swap in pages in hope we need them soon
  * @entry: swap entry of this memory
@@ -372,10 +451,13 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
 struct page *swapin_readahead(swp_entry_t entry, gfp_t gfp_mask,
 			struct vm_area_struct *vma, unsigned long addr)
 {
-	struct page *page;
 	unsigned long offset = swp_offset(entry);
 	unsigned long start_offset, end_offset;
 	unsigned long mask = (1UL << page_cluster) - 1;
+	unsigned long nr_read = 0;
+
+	if (swap_readahead_mode(entry) == SWAP_RA_NONE)
+		goto skip;
 
 	/* Read a page_cluster sized and aligned cluster around offset. */
 	start_offset = offset & ~mask;
@@ -385,12 +467,146 @@ struct page *swapin_readahead(swp_entry_t entry, gfp_t gfp_mask,
 
 	for (offset = start_offset; offset <= end_offset ; offset++) {
 		/* Ok, do the async read-ahead now */
-		page = read_swap_cache_async(swp_entry(swp_type(entry), offset),
-						gfp_mask, vma, addr);
-		if (!page)
+		if (offset == swp_offset(entry))
 			continue;
-		page_cache_release(page);
+		if (swap_readahead_one(swp_entry(swp_type(entry), offset),
+				       gfp_mask, vma, addr))
+			nr_read++;
 	}
+	count_vm_events(SWAP_RA, nr_read);
 	lru_add_drain();	/* Push any new pages onto the LRU now */
+skip:
 	return read_swap_cache_async(entry, gfp_mask, vma, addr);
 }
+
+/*
+ * Size the next VMA readahead window.  Without any hits since the last
+ * fault only a fault right next to the previous one gets a (two page)
+ * window; each hit grows it, and it never shrinks by more than half at
+ * a time so that one unlucky fault doesn't kill a sequential stream.
+ */
+static unsigned int swap_ra_window(unsigned long prev_pfn, unsigned long pfn,
+				   unsigned int hits, unsigned int max_win,
+				   unsigned int prev_win)
+{
+	unsigned int win, roundup;
+
+	win = hits + 2;
+	if (win == 2) {
+		if (pfn != prev_pfn + 1 && pfn != prev_pfn - 1)
+			win = 1;
+	} else {
+		roundup = 4;
+		while (roundup < win)
+			roundup <<= 1;
+		win = roundup;
+	}
+
+	if (win > max_win)
+		win = max_win;
+	if (win < prev_win / 2)
+		win = prev_win / 2;
+	return win;
+}
+
+/**
+ * swap_vma_readahead - swap in pages around the faulting address
+ * @fentry: swap entry of the faulting page
+ * @gfp_mask: memory allocation flags
+ * @vma: user vma the fault happened in
+ * @faddr: faulting address
+ *
+ * Returns the struct page for @fentry, after queueing swapin.
+ *
+ * On devices like zram, swap slot locality says little about what will
+ * be needed next and every page read costs a decompression.  Instead,
+ * read the swapped out pages that neighbour @faddr in @vma, in the
+ * direction the faults are moving, with a window that adapts to how many
+ * of the previously read ahead pages were actually used.  The window is
+ * kept within the page table that maps @faddr so that the swap entries
+ * can be collected in one go.  Other devices use swapin_readahead().
+ *
+ * Caller must hold down_read on the vma->vm_mm.
+ */
+struct page *swap_vma_readahead(swp_entry_t fentry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long faddr)
+{
+	swp_entry_t entries[1 << SWAP_RA_ORDER_CEILING];
+	unsigned long addrs[1 << SWAP_RA_ORDER_CEILING];
+	unsigned long ra_val, fpfn, prev_pfn, lpfn, rpfn, start, end, pfn;
+	unsigned int max_win, win, back, nr = 0, i;
+	unsigned long nr_read = 0;
+	struct page *page;
+	pgd_t *pgd;
+	pud_t *pud;
+	pmd_t *pmd;
+	pte_t *orig_pte, *pte;
+
+	if (!sysctl_swap_vma_readahead ||
+	    swap_readahead_mode(fentry) != SWAP_RA_VMA)
+		return swapin_readahead(fentry, gfp_mask, vma, faddr);
+
+	max_win = 1 << min(ACCESS_ONCE(page_cluster), SWAP_RA_ORDER_CEILING);
+
+	faddr &= PAGE_MASK;
+	fpfn = faddr >> PAGE_SHIFT;
+	ra_val = atomic_long_read(&vma->swap_readahead_info);
+	prev_pfn = SWAP_RA_ADDR(ra_val) >> PAGE_SHIFT;
+	win = swap_ra_window(prev_pfn, fpfn, SWAP_RA_HITS(ra_val), max_win,
+			     SWAP_RA_WIN(ra_val));
+	atomic_long_set(&vma->swap_readahead_info, SWAP_RA_VAL(faddr, win, 0));
+
+	/* Read the faulting page first, it is the one we are waiting for */
+	page = read_swap_cache_async(fentry, gfp_mask, vma, faddr);
+	if (!page || win == 1)
+		return page;
+
+	if (fpfn == prev_pfn + 1)
+		back = 0;
+	else if (fpfn == prev_pfn - 1)
+		back = win - 1;
+	else
+		back = (win - 1) / 2;
+
+	lpfn = max(vma->vm_start, faddr & PMD_MASK) >> PAGE_SHIFT;
+	rpfn = min(vma->vm_end, (faddr & PMD_MASK) + PMD_SIZE) >> PAGE_SHIFT;
+	start = fpfn - min_t(unsigned long, back, fpfn - lpfn);
+	end = min_t(unsigned long, start + win, rpfn);
+
+	pgd = pgd_offset(vma->vm_mm, faddr);
+	if (pgd_none(*pgd) || pgd_bad(*pgd))
+		return page;
+	pud = pud_offset(pgd, faddr);
+	if (pud_none(*pud) || pud_bad(*pud))
+		return page;
+	pmd = pmd_offset(pud, faddr);
+	if (pmd_none(*pmd) || pmd_bad(*pmd))
+		return page;
+
+	/*
+	 * The entries are only hints: read_swap_cache_async() copes with
+	 * any that get freed or faulted in under us.
+	 */
+	orig_pte = pte = pte_offset_map(pmd, start << PAGE_SHIFT);
+	for (pfn = start; pfn < end; pfn++, pte++) {
+		swp_entry_t entry;
+
+		if (pfn == fpfn || !is_swap_pte(*pte))
+			continue;
+		entry = pte_to_swp_entry(*pte);
+		if (unlikely(non_swap_entry(entry)) ||
+		    swp_type(entry) != swp_type(fentry))
+			continue;
+		entries[nr] = entry;
+		addrs[nr++] = pfn << PAGE_SHIFT;
+	}
+	pte_unmap(orig_pte);
+
+	for (i = 0; i < nr; i++)
+		if (swap_readahead_one(entries[i], gfp_mask, vma, addrs[i]))
+			nr_read++;
+	count_vm_events(SWAP_RA, nr_read);
+	lru_add_drain();	/* Push any new pages onto the LRU now */
+
+	return page;
+}
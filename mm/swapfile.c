@@ -472,6 +472,29 @@ swp_entry_t get_swap_page_of_type(int type)
 	return (swp_entry_t) {0};
 }
 
+/*
+ * Pick the swapin readahead policy for the device backing @entry.
+ * Setting read_ahead_kb of the swap device to 0 turns readahead off for
+ * it.  Non-rotational devices such as zram gain nothing from reading
+ * neighbouring slots, so they get readahead by virtual address instead.
+ */
+int swap_readahead_mode(swp_entry_t entry)
+{
+	struct swap_info_struct *si;
+	unsigned long type = swp_type(entry);
+
+	if (type >= nr_swapfiles)
+		return SWAP_RA_NONE;
+	si = swap_info[type];
+	if (!(si->flags & SWP_USED))
+		return SWAP_RA_NONE;
+	if (si->bdev && !blk_get_backing_dev_info(si->bdev)->ra_pages)
+		return SWAP_RA_NONE;
+	if (si->flags & SWP_SOLIDSTATE)
+		return SWAP_RA_VMA;
+	return SWAP_RA_CLUSTER;
+}
+
 static struct swap_info_struct *swap_info_get(swp_entry_t entry)
 {
 	struct swap_info_struct *p;
@@ -123,6 +123,47 @@ int invalidate_inode_page(struct page *page)
 	return invalidate_complete_page(mapping, page);
 }
 
+/*
+ * Drop the shadow entries that reclaim left behind for evicted pages in
+ * [start, end], a batch at a time so tree_lock is not held for long.
+ */
+static void clear_shadow_entries(struct address_space *mapping,
+				 pgoff_t start, pgoff_t end)
+{
+	pgoff_t indices[PAGEVEC_SIZE];
+	struct radix_tree_iter iter;
+	void **slot;
+	int i, nr;
+
+	do {
+		nr = 0;
+		spin_lock_irq(&mapping->tree_lock);
+		radix_tree_for_each_slot(slot, &mapping->page_tree, &iter,
+					 start) {
+			void *entry;
+
+			if (iter.index > end)
+				break;
+			entry = radix_tree_deref_slot_protected(slot,
+						&mapping->tree_lock);
+			if (!radix_tree_exceptional_entry(entry))
+				continue;
+			indices[nr++] = iter.index;
+			if (nr == PAGEVEC_SIZE)
+				break;
+		}
+		for (i = 0; i < nr; i++)
+			radix_tree_delete(&mapping->page_tree, indices[i]);
+		mapping->nrshadows -= nr;
+		spin_unlock_irq(&mapping->tree_lock);
+		workingset_shadow_removed(nr);
+
+		if (nr)
+			start = indices[nr - 1] + 1;
+		cond_resched();
+	} while (nr == PAGEVEC_SIZE && start && start <= end);
+}
+
 void truncate_inode_pages_range(struct address_space *mapping,
 				loff_t lstart, loff_t lend)
 {
@@ -134,12 +175,15 @@ void truncate_inode_pages_range(struct address_space *mapping,
 	int i;
 
 	cleancache_invalidate_inode(mapping);
-	if (mapping->nrpages == 0)
+	if (mapping->nrpages == 0 && mapping->nrshadows == 0)
 		return;
 
 	BUG_ON((lend & (PAGE_CACHE_SIZE - 1)) != (PAGE_CACHE_SIZE - 1));
 	end = (lend >> PAGE_CACHE_SHIFT);
 
+	if (mapping->nrpages == 0)
+		goto shadows;
+
 	pagevec_init(&pvec, 0);
 	index = start;
 	while (index <= end && pagevec_lookup(&pvec, mapping, index,
@@ -212,6 +256,9 @@ void truncate_inode_pages_range(struct address_space *mapping,
 		mem_cgroup_uncharge_end();
 		index++;
 	}
+shadows:
+	if (mapping->nrshadows)
+		clear_shadow_entries(mapping, start, end);
 	cleancache_invalidate_inode(mapping);
 }
 EXPORT_SYMBOL(truncate_inode_pages_range);
@@ -277,7 +324,7 @@ invalidate_complete_page2(struct address_space *mapping, struct page *page)
 
 	clear_page_mlock(page);
 	BUG_ON(page_has_private(page));
-	__delete_from_page_cache(page);
+	__delete_from_page_cache(page, NULL);
 	spin_unlock_irq(&mapping->tree_lock);
 	mem_cgroup_uncharge_cache_page(page);
 
@@ -86,6 +86,9 @@ struct scan_control {
 
 	reclaim_mode_t reclaim_mode;
 
+	
+	int ignore_references;
+
 	struct mem_cgroup *target_mem_cgroup;
 
 	nodemask_t	*nodemask;
@@ -401,7 +404,8 @@ static pageout_t pageout(struct page *page, struct address_space *mapping,
 	return PAGE_CLEAN;
 }
 
-static int __remove_mapping(struct address_space *mapping, struct page *page)
+static int __remove_mapping(struct address_space *mapping, struct page *page,
+			    bool reclaimed)
 {
 	BUG_ON(!PageLocked(page));
 	BUG_ON(mapping != page_mapping(page));
@@ -422,10 +426,13 @@ static int __remove_mapping(struct address_space *mapping, struct page *page)
 		swapcache_free(swap, page);
 	} else {
 		void (*freepage)(struct page *);
+		void *shadow = NULL;
 
 		freepage = mapping->a_ops->freepage;
 
-		__delete_from_page_cache(page);
+		if (reclaimed && page_is_file_cache(page))
+			shadow = workingset_eviction(mapping, page);
+		__delete_from_page_cache(page, shadow);
 		spin_unlock_irq(&mapping->tree_lock);
 		mem_cgroup_uncharge_cache_page(page);
 
@@ -442,7 +449,7 @@ cannot_free:
 
 int remove_mapping(struct address_space *mapping, struct page *page)
 {
-	if (__remove_mapping(mapping, page)) {
+	if (__remove_mapping(mapping, page, false)) {
 		page_unfreeze_refs(page, 1);
 		return 1;
 	}
@@ -501,6 +508,9 @@ static enum page_references page_check_references(struct page *page,
 	referenced_ptes = page_referenced(page, 1, mz->mem_cgroup, &vm_flags);
 	referenced_page = TestClearPageReferenced(page);
 
+	if (sc->ignore_references)
+		return PAGEREF_RECLAIM;
+
 	
 	if (sc->reclaim_mode & RECLAIM_MODE_LUMPYRECLAIM)
 		return PAGEREF_RECLAIM;
@@ -705,7 +715,7 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 			}
 		}
 
-		if (!mapping || !__remove_mapping(mapping, page))
+		if (!mapping || !__remove_mapping(mapping, page, true))
 			goto keep_locked;
 
 		__clear_page_locked(page);
@@ -751,6 +761,56 @@ keep_lumpy:
 	return nr_reclaimed;
 }
 
+#ifdef CONFIG_PROCESS_RECLAIM
+/*
+ * Reclaim pages isolated by a per-process walker.  The pages may come
+ * from any zone, so they are fed to shrink_page_list() one at a time
+ * with a matching mem_cgroup_zone.  Whatever could not be reclaimed is
+ * put back on the LRU.
+ */
+unsigned long reclaim_pages_from_list(struct list_head *page_list)
+{
+	struct scan_control sc = {
+		.gfp_mask = GFP_KERNEL,
+		.may_writepage = 1,
+		.may_unmap = 1,
+		.may_swap = 1,
+		.ignore_references = 1,
+	};
+	struct mem_cgroup_zone mz = {
+		.mem_cgroup = NULL,
+	};
+	unsigned long nr_taken = 0, nr_reclaimed = 0;
+	unsigned long dummy1, dummy2;
+	struct page *page;
+
+	while (!list_empty(page_list)) {
+		LIST_HEAD(single);
+
+		page = lru_to_page(page_list);
+		list_move(&page->lru, &single);
+		nr_taken++;
+		dec_zone_page_state(page, NR_ISOLATED_ANON +
+				    page_is_file_cache(page));
+		ClearPageActive(page);
+
+		mz.zone = page_zone(page);
+		nr_reclaimed += shrink_page_list(&single, &mz, &sc,
+						 DEF_PRIORITY,
+						 &dummy1, &dummy2);
+		if (!list_empty(&single)) {
+			page = lru_to_page(&single);
+			list_del(&page->lru);
+			putback_lru_page(page);
+		}
+	}
+
+	count_vm_events(PGSCAN_PROCESS, nr_taken);
+	count_vm_events(PGSTEAL_PROCESS, nr_reclaimed);
+	return nr_reclaimed;
+}
+#endif
+
 int __isolate_lru_page(struct page *page, isolate_mode_t mode, int file)
 {
 	bool all_lru_mode;
@@ -1509,6 +1569,8 @@ static void shrink_mem_cgroup_zone(int priority, struct mem_cgroup_zone *mz,
 	enum lru_list lru;
 	unsigned long nr_reclaimed, nr_scanned;
 	unsigned long nr_to_reclaim = sc->nr_to_reclaim;
+	unsigned long scanned_start = sc->nr_scanned;
+	unsigned long reclaimed_start = sc->nr_reclaimed;
 	struct blk_plug plug;
 
 restart:
@@ -1543,6 +1605,9 @@ restart:
 					sc->nr_scanned - nr_scanned, sc))
 		goto restart;
 
+	mem_cgroup_vmpressure(mz->mem_cgroup, sc->nr_scanned - scanned_start,
+			      sc->nr_reclaimed - reclaimed_start);
+
 	throttle_vm_writeout(sc->gfp_mask);
 }
 
@@ -1550,26 +1615,45 @@ static void shrink_zone(int priority, struct zone *zone,
 			struct scan_control *sc)
 {
 	struct mem_cgroup *root = sc->target_mem_cgroup;
-	struct mem_cgroup_reclaim_cookie reclaim = {
+	struct mem_cgroup_reclaim_cookie cookie = {
 		.zone = zone,
 		.priority = priority,
 	};
+	struct mem_cgroup_reclaim_cookie *reclaim = &cookie;
+	unsigned long nr_reclaimed = sc->nr_reclaimed;
+	int prio = MEM_CGROUP_RECLAIM_PRIO_MAX;
 	struct mem_cgroup *memcg;
 
-	memcg = mem_cgroup_iter(root, NULL, &reclaim);
+	if (global_reclaim(sc) && mem_cgroup_reclaim_prioritized()) {
+		prio = 0;
+		reclaim = NULL;
+	}
+
 	do {
-		struct mem_cgroup_zone mz = {
-			.mem_cgroup = memcg,
-			.zone = zone,
-		};
+		int scan_priority = max(priority -
+				(MEM_CGROUP_RECLAIM_PRIO_MAX - prio), 0);
 
-		shrink_mem_cgroup_zone(priority, &mz, sc);
-		if (!global_reclaim(sc)) {
-			mem_cgroup_iter_break(root, memcg);
+		memcg = mem_cgroup_iter(root, NULL, reclaim);
+		do {
+			struct mem_cgroup_zone mz = {
+				.mem_cgroup = memcg,
+				.zone = zone,
+			};
+
+			if (!global_reclaim(sc)) {
+				shrink_mem_cgroup_zone(priority, &mz, sc);
+				mem_cgroup_iter_break(root, memcg);
+				return;
+			}
+			if (mem_cgroup_reclaim_priority(memcg) == prio)
+				shrink_mem_cgroup_zone(scan_priority, &mz, sc);
+			memcg = mem_cgroup_iter(root, memcg, reclaim);
+		} while (memcg);
+
+		if (priority >= DEF_PRIORITY - 2 &&
+		    sc->nr_reclaimed - nr_reclaimed >= SWAP_CLUSTER_MAX)
 			break;
-		}
-		memcg = mem_cgroup_iter(root, memcg, &reclaim);
-	} while (memcg);
+	} while (++prio <= MEM_CGROUP_RECLAIM_PRIO_MAX);
 }
 
 static inline bool compaction_ready(struct zone *zone, struct scan_control *sc)
@@ -2137,7 +2221,7 @@ out:
 		}
 
 		if (zones_need_compaction)
-			compact_pgdat(pgdat, order);
+			wakeup_kcompactd(pgdat, order, *classzone_idx);
 	}
 
 	*classzone_idx = end_zone;
@@ -533,6 +533,8 @@ const char * const vmstat_text[] = {
 	"nr_shmem",
 	"nr_dirtied",
 	"nr_written",
+	"workingset_refault",
+	"workingset_activate",
 
 #ifdef CONFIG_NUMA
 	"numa_hit",
@@ -581,6 +583,19 @@ const char * const vmstat_text[] = {
 
 	"pgrotated",
 
+#ifdef CONFIG_SWAP
+	"swap_ra",
+	"swap_ra_hit",
+	"swap_ra_miss",
+#endif
+
+#ifdef CONFIG_MMU
+	"oom_reap_success",
+	"oom_reap_failed",
+	"oom_reap_pages",
+	"oom_reap_release_us",
+#endif
+
 #ifdef CONFIG_COMPACTION
 	"compact_blocks_moved",
 	"compact_pages_moved",
@@ -588,6 +603,10 @@ const char * const vmstat_text[] = {
 	"compact_stall",
 	"compact_fail",
 	"compact_success",
+	"compact_daemon_wake",
+	"compact_daemon_proactive",
+	"compact_daemon_migrated",
+	"compact_daemon_throttle",
 #endif
 
 #ifdef CONFIG_HUGETLB_PAGE
@@ -610,6 +629,19 @@ const char * const vmstat_text[] = {
 	"thp_collapse_alloc_failed",
 	"thp_split",
 #endif
+#ifdef CONFIG_READAHEAD_PATTERN
+	"ra_pattern_recorded",
+	"ra_pattern_replayed",
+#endif
+#ifdef CONFIG_PROCESS_RECLAIM
+	"pgscan_process",
+	"pgsteal_process",
+#endif
+#ifdef CONFIG_CMA
+	"cma_alloc_success",
+	"cma_alloc_fail",
+	"cma_migrate_fail",
+#endif
 
 #endif 
 };
@@ -0,0 +1,245 @@
+/*
+ * mm/workingset.c
+ *
+ * Workingset detection: tell page cache thrashing apart from a simple
+ * one-time use of a page by remembering when evicted pages were evicted.
+ *
+ * Every zone keeps an inactive_age counter that is bumped whenever a file
+ * page is evicted from, or activated off, its inactive list.  When a page
+ * is reclaimed, the counter value is stored in the slot the page occupied
+ * in the page cache radix tree, as an exceptional "shadow" entry.  When
+ * the page is read back in, the difference between the current counter
+ * and the shadow is the refault distance: the number of slots the
+ * inactive list would have needed in addition to its current size to
+ * keep the page cached.
+ *
+ * Growing the inactive list by that much can only come out of the active
+ * list, so if the refault distance is no bigger than the active list the
+ * page would have been kept with a better balance between the two.  Such
+ * a page is part of the workingset and is put straight on the active
+ * list, where it competes with the existing active pages, instead of
+ * being evicted again before it can be referenced twice.
+ */
+
+#include <linux/mm.h>
+#include <linux/mmzone.h>
+#include <linux/swap.h>
+#include <linux/fs.h>
+#include <linux/pagemap.h>
+#include <linux/radix-tree.h>
+#include <linux/pagevec.h>
+#include <linux/vmstat.h>
+#include <linux/atomic.h>
+#include <linux/mutex.h>
+#include <linux/jiffies.h>
+#include <linux/shrinker.h>
+#include <linux/init.h>
+
+#define EVICTION_SHIFT	(RADIX_TREE_EXCEPTIONAL_SHIFT + \
+			 ZONES_SHIFT + NODES_SHIFT)
+#define EVICTION_MASK	(~0UL >> EVICTION_SHIFT)
+
+/*
+ * Shadow entries keep radix tree nodes alive after the pages are gone.
+ * Under memory pressure a shrinker drops the ones that have aged past
+ * the point where their refault could still activate the page.  On top
+ * of that the number of shadows is capped: a refault distance bigger
+ * than memory can never activate a page, so there is no point in
+ * tracking more evictions than there are pages.
+ */
+static atomic_long_t nr_shadow_entries = ATOMIC_LONG_INIT(0);
+
+/* Entries looked at per tree_lock hold when pruning a mapping. */
+#define SHADOW_SCAN_BATCH	256
+
+static void *pack_shadow(unsigned long eviction, struct zone *zone)
+{
+	eviction = (eviction << NODES_SHIFT) | zone_to_nid(zone);
+	eviction = (eviction << ZONES_SHIFT) | zone_idx(zone);
+	eviction = (eviction << RADIX_TREE_EXCEPTIONAL_SHIFT);
+
+	return (void *)(eviction | RADIX_TREE_EXCEPTIONAL_ENTRY);
+}
+
+static void unpack_shadow(void *shadow, struct zone **zone,
+			  unsigned long *evictionp)
+{
+	unsigned long entry = (unsigned long)shadow;
+	int zid, nid;
+
+	entry >>= RADIX_TREE_EXCEPTIONAL_SHIFT;
+	zid = entry & ((1UL << ZONES_SHIFT) - 1);
+	entry >>= ZONES_SHIFT;
+	nid = entry & ((1UL << NODES_SHIFT) - 1);
+	entry >>= NODES_SHIFT;
+
+	*zone = NODE_DATA(nid)->node_zones + zid;
+	*evictionp = entry;
+}
+
+/**
+ * workingset_eviction - note the eviction of a page from memory
+ * @mapping: address space the page was backing
+ * @page: the page being evicted
+ *
+ * Returns a shadow entry to be stored in @mapping->page_tree in place
+ * of the evicted @page so that a later refault can be detected, or
+ * %NULL if none should be stored.
+ */
+void *workingset_eviction(struct address_space *mapping, struct page *page)
+{
+	struct zone *zone = page_zone(page);
+	unsigned long eviction;
+
+	if (atomic_long_read(&nr_shadow_entries) >= totalram_pages)
+		return NULL;
+
+	eviction = atomic_long_inc_return(&zone->inactive_age);
+	return pack_shadow(eviction, zone);
+}
+
+static unsigned long refault_distance(void *shadow, struct zone **zonep)
+{
+	unsigned long eviction;
+	unsigned long refault;
+
+	unpack_shadow(shadow, zonep, &eviction);
+	refault = atomic_long_read(&(*zonep)->inactive_age);
+	return (refault - eviction) & EVICTION_MASK;
+}
+
+static bool shadow_is_stale(void *shadow)
+{
+	struct zone *zone;
+
+	return refault_distance(shadow, &zone) >
+		zone_page_state(zone, NR_ACTIVE_FILE);
+}
+
+/**
+ * workingset_refault - evaluate the refault of a previously evicted page
+ * @shadow: shadow entry of the evicted page
+ *
+ * Calculates the refault distance of the page that @shadow belonged to
+ * and accounts the refault.  Returns %true if the page should be
+ * activated, %false otherwise.
+ */
+bool workingset_refault(void *shadow)
+{
+	unsigned long distance;
+	struct zone *zone;
+
+	distance = refault_distance(shadow, &zone);
+
+	inc_zone_state(zone, WORKINGSET_REFAULT);
+
+	if (distance <= zone_page_state(zone, NR_ACTIVE_FILE)) {
+		inc_zone_state(zone, WORKINGSET_ACTIVATE);
+		return true;
+	}
+	return false;
+}
+
+/**
+ * workingset_activation - note a page activation
+ * @page: page that is being activated
+ */
+void workingset_activation(struct page *page)
+{
+	atomic_long_inc(&page_zone(page)->inactive_age);
+}
+
+void workingset_shadow_added(void)
+{
+	atomic_long_inc(&nr_shadow_entries);
+}
+
+void workingset_shadow_removed(unsigned long nr)
+{
+	atomic_long_sub(nr, &nr_shadow_entries);
+}
+
+/**
+ * workingset_prune_mapping - drop stale shadow entries from a mapping
+ * @mapping: address space to prune
+ *
+ * Removes the shadow entries in @mapping whose refault could no longer
+ * activate the page, i.e. whose refault distance already exceeds the
+ * active file list of their zone.  tree_lock is dropped every
+ * %SHADOW_SCAN_BATCH slots so large files do not hold it for long.
+ */
+void workingset_prune_mapping(struct address_space *mapping)
+{
+	pgoff_t indices[PAGEVEC_SIZE];
+	struct radix_tree_iter iter;
+	pgoff_t start = 0;
+	void **slot;
+	bool more;
+	int i, nr, scanned;
+
+	do {
+		nr = 0;
+		scanned = 0;
+		more = false;
+		spin_lock_irq(&mapping->tree_lock);
+		radix_tree_for_each_slot(slot, &mapping->page_tree, &iter,
+					 start) {
+			void *entry;
+
+			entry = radix_tree_deref_slot_protected(slot,
+						&mapping->tree_lock);
+			start = iter.index + 1;
+			if (radix_tree_exceptional_entry(entry) &&
+			    shadow_is_stale(entry))
+				indices[nr++] = iter.index;
+			if (nr == PAGEVEC_SIZE ||
+			    ++scanned == SHADOW_SCAN_BATCH) {
+				more = true;
+				break;
+			}
+		}
+		for (i = 0; i < nr; i++)
+			radix_tree_delete(&mapping->page_tree, indices[i]);
+		mapping->nrshadows -= nr;
+		spin_unlock_irq(&mapping->tree_lock);
+		workingset_shadow_removed(nr);
+		cond_resched();
+	} while (more && start);
+}
+
+/*
+ * There is no per-node LRU for shadow entries, so a scan walks every
+ * inode with shadows.  Sweep at most once a second and let concurrent
+ * reclaimers skip rather than queue up behind the sweep.
+ */
+static DEFINE_MUTEX(shadow_sweep_mutex);
+static unsigned long next_shadow_sweep;
+
+static int shrink_shadows(struct shrinker *shrink, struct shrink_control *sc)
+{
+	if (sc->nr_to_scan) {
+		if (!(sc->gfp_mask & __GFP_FS))
+			return -1;
+		if (!mutex_trylock(&shadow_sweep_mutex))
+			return -1;
+		if (time_after_eq(jiffies, next_shadow_sweep)) {
+			prune_icache_shadows();
+			next_shadow_sweep = jiffies + HZ;
+		}
+		mutex_unlock(&shadow_sweep_mutex);
+	}
+
+	return min_t(long, atomic_long_read(&nr_shadow_entries), INT_MAX);
+}
+
+static struct shrinker shadow_shrinker = {
+	.shrink = shrink_shadows,
+	.seeks = DEFAULT_SEEKS,
+};
+
+static int __init workingset_init(void)
+{
+	register_shrinker(&shadow_shrinker);
+	return 0;
+}
+module_init(workingset_init);
@@ -0,0 +1,115 @@
+/*
+ * Measure how long ION_IOC_FREE blocks the caller.
+ *
+ * Buffers are allocated and freed back to back from the given heap mask
+ * and the latency of each free is reported.  With deferred freeing the
+ * free only queues the buffer, so its cost should not grow with the
+ * buffer size.
+ *
+ * usage: ion_free_latency [size_kb] [iterations] [heap_mask] [cached]
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+/* From include/linux/ion.h and include/linux/msm_ion.h. */
+struct ion_allocation_data {
+	size_t len;
+	size_t align;
+	unsigned int flags;
+	void *handle;
+};
+
+struct ion_handle_data {
+	void *handle;
+};
+
+#define ION_IOC_MAGIC		'I'
+#define ION_IOC_ALLOC		_IOWR(ION_IOC_MAGIC, 0, \
+				      struct ion_allocation_data)
+#define ION_IOC_FREE		_IOWR(ION_IOC_MAGIC, 1, struct ion_handle_data)
+
+#define ION_IOMMU_HEAP_ID	25
+#define ION_SYSTEM_HEAP_ID	30
+#define ION_HEAP(bit)		(1U << (bit))
+
+static long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int cmp_ll(const void *a, const void *b)
+{
+	long long x = *(const long long *)a, y = *(const long long *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+int main(int argc, char **argv)
+{
+	size_t size = (argc > 1 ? strtoul(argv[1], NULL, 0) : 8192) * 1024;
+	int iterations = argc > 2 ? atoi(argv[2]) : 100;
+	unsigned int heap_mask = argc > 3 ? strtoul(argv[3], NULL, 0) :
+		ION_HEAP(ION_SYSTEM_HEAP_ID) | ION_HEAP(ION_IOMMU_HEAP_ID);
+	unsigned int cached = argc > 4 ? atoi(argv[4]) : 1;
+	long long *lat, total = 0;
+	int fd, i;
+
+	if (iterations <= 0)
+		iterations = 1;
+
+	fd = open("/dev/ion", O_RDONLY);
+	if (fd < 0) {
+		perror("open /dev/ion");
+		return 1;
+	}
+
+	lat = calloc(iterations, sizeof(*lat));
+	if (!lat)
+		return 1;
+
+	for (i = 0; i < iterations; i++) {
+		struct ion_allocation_data alloc = {
+			.len = size,
+			.align = 4096,
+			.flags = heap_mask | !!cached,
+		};
+		struct ion_handle_data data;
+		long long start;
+
+		if (ioctl(fd, ION_IOC_ALLOC, &alloc) < 0) {
+			fprintf(stderr, "ION_IOC_ALLOC of %zu bytes failed: %s\n",
+				size, strerror(errno));
+			return 1;
+		}
+
+		data.handle = alloc.handle;
+		start = now_ns();
+		if (ioctl(fd, ION_IOC_FREE, &data) < 0) {
+			perror("ION_IOC_FREE");
+			return 1;
+		}
+		lat[i] = now_ns() - start;
+		total += lat[i];
+	}
+
+	qsort(lat, iterations, sizeof(*lat), cmp_ll);
+	printf("ION_IOC_FREE of %zu KB x %d (heap mask 0x%x, %s): "
+	       "avg %lld us, p50 %lld us, p99 %lld us, max %lld us\n",
+	       size / 1024, iterations, heap_mask,
+	       cached ? "cached" : "uncached",
+	       total / iterations / 1000, lat[iterations / 2] / 1000,
+	       lat[iterations * 99 / 100] / 1000, lat[iterations - 1] / 1000);
+
+	free(lat);
+	close(fd);
+	return 0;
+}